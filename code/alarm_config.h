@@ -0,0 +1,123 @@
+/*
+ * Alarm configuration shared by the GRAVE Controller modules.
+ * Stored field by field in NVS (see ConfigStore).
+ */
+#pragma once
+
+#include <Arduino.h>
+#include "board.h"
+
+#define MAX_PERIODS ((int)Board::max_periods) // Schedule entries, across all weekdays and exceptions
+#define MAX_ZONES ((int)Board::zones)          // Independent outputs, each with its own track
+
+// One bit per zone (bit 0 = zone 1)
+typedef uint8_t ZoneMask;
+
+// Weekday bits follow the RTC numbering: bit 0 = Sunday ... bit 6 = Saturday
+#define ALL_WEEKDAYS 0x7F
+
+// Period flags
+#define PERIOD_EXCEPTION 0x01 // Forces the output OFF (holidays, closures)
+#define PERIOD_PLAYLIST_SHIFT 1 // Bits 1-3: playlist number (0 = the zone's track)
+#define PERIOD_PLAYLIST_MASK 0x0E
+#define PERIOD_ZONE_SHIFT 4   // Upper nibble: zone index (0 = first zone)
+
+// Packs a day of the year as (month << 5) | day, so packed dates compare in
+// calendar order. 0 means "no date limit".
+inline uint16_t packMonthDay(int month, int day) { return (uint16_t)((month << 5) | day); }
+inline int packedMonth(uint16_t md) { return md >> 5; }
+inline int packedDay(uint16_t md) { return md & 0x1F; }
+
+// One schedule entry (10 bytes).
+// start < end is a same-day period, start > end passes midnight and
+// start == end is ignored, except for exceptions where it covers the whole day.
+struct Period {
+  uint16_t start = 0;   // Start minute of the day (0-1439)
+  uint16_t end = 0;     // End minute of the day (0-1439)
+  uint8_t weekdays = ALL_WEEKDAYS; // Days on which the period starts
+  uint8_t flags = 0;
+  uint16_t from = 0;    // Optional yearly date range, packed month/day
+  uint16_t to = 0;      // (inclusive, may wrap over New Year)
+};
+
+// Periods saved before zones existed have a zero upper nibble, i.e. zone 1
+inline int periodZone(const Period& p) { return p.flags >> PERIOD_ZONE_SHIFT; }
+inline void setPeriodZone(Period& p, int zone) {
+    p.flags = (uint8_t)((p.flags & ((1 << PERIOD_ZONE_SHIFT) - 1)) | (zone << PERIOD_ZONE_SHIFT));
+}
+
+// Periods saved before playlists existed have these bits clear
+inline int periodPlaylist(const Period& p) { return (p.flags & PERIOD_PLAYLIST_MASK) >> PERIOD_PLAYLIST_SHIFT; }
+inline void setPeriodPlaylist(Period& p, int playlist) {
+    p.flags = (uint8_t)((p.flags & ~PERIOD_PLAYLIST_MASK) | ((playlist << PERIOD_PLAYLIST_SHIFT) & PERIOD_PLAYLIST_MASK));
+}
+
+#define ZONE_VOLUME_MAIN 0xFF // Zone plays at AlarmData::volume
+
+// What a zone plays while it is active
+struct ZoneSettings {
+  uint8_t track = 1;                 // MP3 track number (looped)
+  uint8_t volume = ZONE_VOLUME_MAIN; // 0-30, or ZONE_VOLUME_MAIN
+};
+
+#define MAX_PLAYLISTS 7   // Numbers 1-7 fit the period's playlist bits
+#define PLAYLIST_LENGTH 8
+#define MAX_FADE_SECONDS 30
+
+struct PlaylistEntry {
+  uint8_t track = 1;
+  uint8_t volume = ZONE_VOLUME_MAIN; // 0-30, or ZONE_VOLUME_MAIN for the zone's volume
+};
+
+// Tracks played in order, each once, starting over after the last one.
+// The volume is ramped up when the playlist starts and down before its
+// period ends.
+struct Playlist {
+  uint8_t length = 0; // 0 = not defined: periods using it play the zone's track
+  uint8_t fade_in_seconds = 0;
+  uint8_t fade_out_seconds = 0;
+  PlaylistEntry entries[PLAYLIST_LENGTH];
+};
+
+// Struct to hold all alarm configuration data
+struct AlarmData {
+  uint16_t num_periods = 0;
+  Period periods[MAX_PERIODS]; // Kept sorted by start minute
+  int volume = 15; // Volume level (0-30). Default: 15 (medium)
+  uint8_t selftest_seconds = 10; // Relay/MP3 self-test at boot (0 = skipped)
+  ZoneSettings zones[MAX_ZONES];
+  Playlist playlists[MAX_PLAYLISTS]; // Selected per period, numbered from 1
+};
+
+#define MAX_SELFTEST_SECONDS 60
+
+// Layouts written to EEPROM by earlier firmware; still recognised at boot
+// so existing units keep their schedule when moving to NVS.
+#define EEPROM_SIGNATURE 0x47525632 // "GRV2"
+#define EEPROM_MAX_PERIODS 64
+
+struct EepromAlarmData {
+  uint16_t num_periods;
+  Period periods[EEPROM_MAX_PERIODS];
+  int volume;
+  uint32_t signature;
+};
+
+// Firmware that only supported 3 daily periods
+#define LEGACY_MAX_PERIODS 3
+
+struct LegacyPeriod {
+  int start_h;
+  int start_m;
+  int end_h;
+  int end_m;
+};
+
+struct LegacyAlarmData {
+  int num_periods;
+  LegacyPeriod periods[LEGACY_MAX_PERIODS];
+  int volume;
+  int signature; // 0xAABBCCDD
+};
+
+#define LEGACY_SIGNATURE 0xAABBCCDD
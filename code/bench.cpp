@@ -0,0 +1,790 @@
+/*
+ * On-device benchmarks for the GRAVE Controller (BENCH_ENABLED builds only).
+ */
+#include "bench.h"
+
+#if BENCH_ENABLED
+#include <esp_heap_caps.h>
+#include <initializer_list>
+#include "config_codec.h"
+#include "crc32.h"
+#include "http_server.h"
+#include "json_writer.h"
+#include "pages.h"
+#include "schedule.h"
+#include "soft_clock.h"
+
+#define BENCH_CHECKSUM_ROUNDS 100
+#define BENCH_CODEC_ROUNDS 100
+#define BENCH_JSON_SIZE 8192
+
+static void report(const char* name, unsigned long value, const char* unit) {
+    Serial.printf("[BENCH] %s %lu %s\n", name, value, unit);
+}
+
+void benchBuildConfig(AlarmData& config, int num_periods) {
+    uint32_t seed = 12345;
+    auto next = [&seed](uint32_t range) {
+        seed = seed * 1103515245 + 12345;
+        return (seed >> 16) % range;
+    };
+
+    config.num_periods = min(num_periods, MAX_PERIODS);
+    for (int i = 0; i < config.num_periods; i++) {
+        Period& p = config.periods[i];
+        p = Period();
+        p.start = next(MINUTES_PER_DAY);
+        p.end = (p.start + 15 + next(240)) % MINUTES_PER_DAY; // Some pass midnight
+        p.weekdays = 1 + next(ALL_WEEKDAYS);
+        if (i % 4 == 0) {
+            p.from = packMonthDay(1 + next(12), 1 + next(28));
+            p.to = packMonthDay(1 + next(12), 1 + next(28)); // May wrap over New Year
+        }
+        if (i % 8 == 0) p.flags |= PERIOD_EXCEPTION;
+        setPeriodZone(p, i % MAX_ZONES);
+    }
+    sortPeriods(config);
+}
+
+void benchSchedule(const AlarmData& config) {
+    ScheduleEngine engine;
+    engine.load(config);
+
+    ScheduleDate date;
+    date.year = 2025;
+    unsigned long compile_us = 0;
+    unsigned long tick_us = 0;
+    unsigned long transitions = 0;
+    ZoneMask active = 0;
+
+    for (int day = 0; day < 365; day++) {
+        unsigned long started = micros();
+        engine.update(date); // Compiles the new day
+        compile_us += micros() - started;
+
+        started = micros();
+        for (int minute = 0; minute < MINUTES_PER_DAY; minute++) {
+            engine.update(date); // Same day: only the check a tick pays
+            ZoneMask now = engine.activeZones(minute);
+            transitions += __builtin_popcount(now ^ active); // Zone edges
+            active = now;
+        }
+        tick_us += micros() - started;
+        date = nextDay(date);
+    }
+
+    report("schedule_periods", config.num_periods, "periods");
+    report("schedule_day_compile", compile_us / 365, "us/day");
+    report("schedule_tick", tick_us * 1000 / (365UL * MINUTES_PER_DAY), "ns/tick");
+    report("schedule_year", compile_us + tick_us, "us");
+    report("schedule_transitions", transitions, "per_year");
+    report("schedule_zones", MAX_ZONES, "zones");
+}
+
+void benchPage(const char* name, PageStream& page) {
+    static char buffer[PAGE_PIECE_SIZE];
+    multi_heap_info_t before;
+    multi_heap_info_t after;
+    char label[48];
+
+    heap_caps_get_info(&before, MALLOC_CAP_8BIT);
+    size_t min_free = before.total_free_bytes;
+    unsigned long bytes = 0;
+    unsigned long reads = 0;
+    unsigned long started = micros();
+    size_t n;
+    while ((n = page.read(buffer, sizeof(buffer))) > 0) {
+        bytes += n;
+        reads++;
+        min_free = min(min_free, heap_caps_get_free_size(MALLOC_CAP_8BIT));
+    }
+    unsigned long elapsed = micros() - started;
+    heap_caps_get_info(&after, MALLOC_CAP_8BIT);
+
+    snprintf(label, sizeof(label), "%s_render", name);
+    report(label, elapsed, "us");
+    snprintf(label, sizeof(label), "%s_bytes", name);
+    report(label, bytes, "bytes");
+    snprintf(label, sizeof(label), "%s_reads", name);
+    report(label, reads, "reads");
+    // Net blocks left allocated, and the heap used at the worst point
+    snprintf(label, sizeof(label), "%s_heap_blocks", name);
+    report(label, after.allocated_blocks - before.allocated_blocks, "blocks");
+    snprintf(label, sizeof(label), "%s_heap_peak", name);
+    report(label, before.total_free_bytes - min_free, "bytes");
+}
+
+void benchConfigChecksum(const AlarmData& config) {
+    size_t len = sizeof(Period) * config.num_periods;
+    uint32_t crc = 0;
+    unsigned long started = micros();
+    for (int i = 0; i < BENCH_CHECKSUM_ROUNDS; i++) crc ^= crc32(config.periods, len);
+    unsigned long elapsed = micros() - started;
+
+    report("config_checksum_bytes", len, "bytes");
+    report("config_checksum", elapsed / BENCH_CHECKSUM_ROUNDS, "us");
+    volatile uint32_t sink = crc; // Keeps the loop from being optimized out
+    (void)sink;
+}
+
+void benchConfigCodec(const AlarmData& config) {
+    static uint8_t encoded[CONFIG_CODEC_MAX_SIZE];
+    static AlarmData decoded;
+    size_t len = 0;
+    unsigned long started = micros();
+    for (int i = 0; i < BENCH_CODEC_ROUNDS; i++) len = configEncode(config, CONFIG_FIELD_ALL, encoded, sizeof(encoded));
+    unsigned long encode_us = micros() - started;
+
+    uint8_t fields = 0;
+    started = micros();
+    for (int i = 0; i < BENCH_CODEC_ROUNDS; i++) {
+        decoded = config;
+        fields = configDecode(encoded, len, decoded);
+    }
+    unsigned long decode_us = micros() - started;
+
+    report("config_export_bytes", len, "bytes");
+    report("config_export", encode_us / BENCH_CODEC_ROUNDS, "us");
+    report("config_import", decode_us / BENCH_CODEC_ROUNDS, "us");
+    report("config_import_fields", fields, "mask");
+}
+
+void benchJson(const AlarmData& config) {
+    static char buffer[BENCH_JSON_SIZE];
+    bool ok = false;
+    size_t len = 0;
+    unsigned long started = micros();
+    for (int i = 0; i < BENCH_CODEC_ROUNDS; i++) {
+        JsonWriter json(buffer, sizeof(buffer));
+        json.beginArray();
+        for (int j = 0; j < config.num_periods; j++) {
+            const Period& p = config.periods[j];
+            json.beginObject();
+            json.addNumber("start", p.start);
+            json.addNumber("end", p.end);
+            json.addNumber("weekdays", p.weekdays);
+            json.addNumber("zone", periodZone(p) + 1);
+            json.addBool("exception", p.flags & PERIOD_EXCEPTION);
+            json.endObject();
+        }
+        json.endArray();
+        ok = json.ok();
+        len = json.length();
+    }
+    unsigned long elapsed = micros() - started;
+
+    report("json_periods", elapsed / BENCH_CODEC_ROUNDS, "us");
+    report("json_periods_bytes", ok ? len : 0, "bytes");
+}
+
+void benchPages(const HttpServer& server, const ScheduleDate& today) {
+    pageSchedule.load(alarmConfig);
+    pageSchedule.update(today);
+    pageCache.invalidate();
+    {
+        RootPage page(-1);
+        benchPage("root", page);
+    }
+    {
+        RootPage sections(-1, true);
+        unsigned long started = micros();
+        pageCache.fill(sections, configSnapshot.version());
+        report("root_cache_fill", micros() - started, "us");
+        RootPage page(-1);
+        benchPage(pageCache.length() ? "root_cached" : "root_uncacheable", page);
+    }
+    {
+        RootPage page(0);
+        benchPage("root_edit", page);
+    }
+    {
+        ConfigJson page;
+        benchPage("api_config", page);
+    }
+    {
+        MetricsPage page(server);
+        benchPage("metrics", page);
+    }
+    pageCache.invalidate();
+}
+
+// --- REPLAY ---
+// Virtual time is in microseconds since 2000-01-01 00:00 local time, as in
+// SoftClock.
+
+#define DAY_US 86400000000LL
+#define MINUTE_US 60000000LL
+
+struct BenchRandom {
+  uint32_t seed;
+
+  uint32_t next(uint32_t range) {
+      seed = seed * 1664525 + 1013904223;
+      return (uint32_t)(((uint64_t)seed * range) >> 32);
+  }
+};
+
+// Plain calendar arithmetic for the reference, independent of schedule.cpp
+// and soft_clock.cpp
+struct RefDate {
+  int year;
+  int month;
+  int day;
+  int weekday; // 0 = Sunday
+};
+
+static RefDate refDate(int32_t days) {
+    int32_t z = days + 10957 + 719468; // Days since 0000-03-01
+    int32_t era = z / 146097;
+    int32_t doe = z - era * 146097;
+    int32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int32_t mp = (5 * doy + 2) / 153;
+    RefDate d;
+    d.day = doy - (153 * mp + 2) / 5 + 1;
+    d.month = mp < 10 ? mp + 3 : mp - 9;
+    d.year = yoe + era * 400 + (d.month <= 2 ? 1 : 0);
+    d.weekday = (days + 6) % 7; // 2000-01-01 was a Saturday
+    return d;
+}
+
+static int32_t refDays(int year, int month, int day) {
+    year -= month <= 2 ? 1 : 0;
+    int32_t era = year / 400;
+    int32_t yoe = year - era * 400;
+    int32_t doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    return era * 146097 + yoe * 365 + yoe / 4 - yoe / 100 + doy - 719468 - 10957;
+}
+
+static int32_t lastSunday(int year, int month) {
+    int32_t last = refDays(year, month + 1, 1) - 1; // March and October only
+    return last - refDate(last).weekday;
+}
+
+static bool refStarts(const Period& p, const RefDate& d) {
+    if (!(p.weekdays & (1 << d.weekday))) return false;
+    int md = d.month * 32 + d.day;
+    int from = p.from ? packedMonth(p.from) * 32 + packedDay(p.from) : 1 * 32 + 1;
+    int to = p.to ? packedMonth(p.to) * 32 + packedDay(p.to) : 12 * 32 + 31;
+    return from <= to ? md >= from && md <= to : md >= from || md <= to;
+}
+
+// Zones on at `minute` of day `days`, from every period in turn, the way
+// checkAlarmState() decided before the engine
+static ZoneMask referenceZones(const AlarmData& config, int32_t days, int minute) {
+    RefDate today = refDate(days);
+    RefDate yesterday = refDate(days - 1);
+    ZoneMask on = 0;
+    ZoneMask off = 0;
+    for (int i = 0; i < config.num_periods; i++) {
+        const Period& p = config.periods[i];
+        bool exception = p.flags & PERIOD_EXCEPTION;
+        bool covers;
+        if (p.start < p.end) {
+            covers = minute >= p.start && minute < p.end && refStarts(p, today);
+        } else if (p.start > p.end) {
+            covers = (minute >= p.start && refStarts(p, today)) || (minute < p.end && refStarts(p, yesterday));
+        } else {
+            covers = exception && refStarts(p, today); // Whole day
+        }
+        if (covers && exception) off |= 1 << periodZone(p);
+        if (covers && !exception) on |= 1 << periodZone(p);
+    }
+    return on & ~off;
+}
+
+static Period randomPeriod(BenchRandom& random) {
+    Period p;
+    p.start = random.next(MINUTES_PER_DAY);
+    p.end = random.next(8) == 0 ? p.start : random.next(MINUTES_PER_DAY); // About half pass midnight
+    p.weekdays = random.next(4) == 0 ? ALL_WEEKDAYS : 1 + random.next(ALL_WEEKDAYS);
+    if (random.next(3) == 0) {
+        // Either end may be open, ranges may wrap, 29 February included
+        if (random.next(4)) p.from = packMonthDay(1 + random.next(12), 1 + random.next(29));
+        if (random.next(4)) p.to = packMonthDay(1 + random.next(12), 1 + random.next(29));
+    }
+    if (random.next(6) == 0) p.flags |= PERIOD_EXCEPTION;
+    setPeriodZone(p, random.next(MAX_ZONES));
+    return p;
+}
+
+enum ReplayEventType : uint8_t {
+  REPLAY_SET_CLOCK, // Clock moved by `arg` (handleSetTime(), NTP, DST)
+  REPLAY_POWER_CUT, // Nothing runs for `arg`; the engine starts from scratch
+  REPLAY_EDIT,      // One period added, changed or removed from the page
+  REPLAY_SELF_TEST  // A self-test of `arg` starts
+};
+
+struct ReplayEvent {
+  int64_t at_us; // Clock time
+  ReplayEventType type;
+  int64_t arg_us;
+};
+
+struct ReplayStats {
+  uint32_t wakes;
+  uint32_t edges;      // Zone changes that fell while the scheduler slept
+  uint32_t diffs;      // Wake-ups whose zones differ from the reference
+  uint32_t late_edges; // Changes woken up for later than the margin, or missed
+  uint32_t unprepared; // Changes that needed the player ahead of time and did not get it
+  uint32_t late_selftests; // Self-tests that ended later than the margin
+  int64_t worst_latency_us;
+  uint32_t tick_max_us;
+  uint64_t tick_sum_us;
+  int64_t simulated_us;
+};
+
+// Player lead of the replay, as transitionLead(): waking the player before
+// playback from silence, fading out before silence
+#define REPLAY_PREARM_MS 1500
+#define REPLAY_FADE_MS 8000
+
+static uint32_t replayLeadMs(ZoneMask from, ZoneMask to) {
+    if (from == to) return 0;
+    if (from == 0) return REPLAY_PREARM_MS;
+    return to == 0 ? REPLAY_FADE_MS : 0;
+}
+
+// The scheduler task on a virtual clock: wakes where planWake() says, the
+// timer running at the clock's corrected rate, evaluates the engine and
+// checks it against the reference. Every change that needed the player
+// ahead of time must have been prepared by then.
+class Replay {
+public:
+    Replay(AlarmData& config, ReplayStats& stats, const char* name, int32_t rate_ppb = 0)
+        : config_(config), stats_(stats), name_(name), rate_ppb_(rate_ppb) {}
+
+    // Replays `duration_us` of simulated time from `start_us`, with the
+    // events of `script` (in clock order), or with generated ones
+    void play(int64_t start_us, int64_t duration_us, const ReplayEvent* script, int script_len);
+    void fuzz(int64_t start_us, int64_t duration_us, uint32_t seed);
+
+private:
+    void run(int64_t start_us, int64_t duration_us);
+    ZoneMask wake(int64_t now_us, int64_t& next_us);
+    void checkSleep(int64_t from_us, int64_t to_us, ZoneMask held);
+    bool nextEvent(int64_t now_us, ReplayEvent& event);
+    int64_t apply(const ReplayEvent& event, int64_t& simulated_us);
+    void restart(int64_t now_us);
+    void buildEdges();
+    static uint32_t lead(int minute);
+    void report(const char* what, int64_t at_us, const char* format, ...) __attribute__((format(printf, 4, 5)));
+
+    AlarmData& config_;
+    ReplayStats& stats_;
+    const char* name_;
+    int32_t rate_ppb_;
+    ScheduleEngine engine_;
+    int64_t last_resync_us_ = 0;
+    ZoneMask zones_ = 0;           // At the last wake-up
+    uint32_t prepared_ = 0;        // As player_prepared
+    int64_t selftest_end_us_ = -1; // Clock time, -1 with no self-test running
+    static Replay* planning_;      // For lead()
+    uint16_t edges_[2 * MAX_PERIODS + 1]; // Minutes at which the reference can change
+    int num_edges_ = 0;
+    bool generated_ = false;
+    const ReplayEvent* script_ = nullptr;
+    int script_len_ = 0;
+    int script_pos_ = 0;
+    BenchRandom random_ = { 1 };
+    int32_t dst_day_ = -1; // Last DST change applied
+    int reports_ = 0;
+};
+
+void Replay::report(const char* what, int64_t at_us, const char* format, ...) {
+    if (reports_++ >= BENCH_REPLAY_REPORTS) return;
+    RefDate d = refDate(at_us / DAY_US);
+    int minute = (at_us % DAY_US) / MINUTE_US;
+    char details[64];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(details, sizeof(details), format, args);
+    va_end(args);
+    Serial.printf("[BENCH] replay_%s %s %04d-%02d-%02d %02d:%02d %s\n", what, name_,
+                  d.year, d.month, d.day, minute / 60, minute % 60, details);
+}
+
+void Replay::buildEdges() {
+    num_edges_ = 0;
+    edges_[num_edges_++] = 0; // Midnight: new weekday and date
+    for (int i = 0; i < config_.num_periods; i++) {
+        edges_[num_edges_++] = config_.periods[i].start;
+        edges_[num_edges_++] = config_.periods[i].end;
+    }
+    // Sorted, without duplicates
+    for (int i = 1; i < num_edges_; i++) {
+        uint16_t e = edges_[i];
+        int j = i - 1;
+        while (j >= 0 && edges_[j] > e) {
+            edges_[j + 1] = edges_[j];
+            j--;
+        }
+        edges_[j + 1] = e;
+    }
+    int unique = 1;
+    for (int i = 1; i < num_edges_; i++) {
+        if (edges_[i] != edges_[unique - 1]) edges_[unique++] = edges_[i];
+    }
+    num_edges_ = unique;
+}
+
+// Boot, or clock anchored again: the resync interval starts over
+void Replay::restart(int64_t now_us) {
+    last_resync_us_ = now_us;
+    prepared_ = 0;
+}
+
+Replay* Replay::planning_ = nullptr;
+
+uint32_t Replay::lead(int minute) {
+    return replayLeadMs(planning_->zones_, planning_->engine_.activeZones(minute));
+}
+
+ZoneMask Replay::wake(int64_t now_us, int64_t& next_us) {
+    rtc_time_type time;
+    rtc_date_type date;
+    clockToRtc(now_us / 1000000, time, date);
+    ScheduleDate today;
+    today.year = date.Year;
+    today.month = date.Month;
+    today.day = date.Date;
+    int64_t us_of_day = now_us % DAY_US;
+    int minute = us_of_day / MINUTE_US;
+
+    if (now_us - last_resync_us_ >= (int64_t)CLOCK_RESYNC_INTERVAL_MS * 1000) last_resync_us_ = now_us;
+    if (selftest_end_us_ >= 0 && now_us >= selftest_end_us_) {
+        if (now_us - selftest_end_us_ > TRANSITION_MARGIN_US) {
+            stats_.late_selftests++;
+            report("selftest_late", now_us, "%lld us", (long long)(now_us - selftest_end_us_));
+        }
+        selftest_end_us_ = -1;
+    }
+
+    unsigned long started = micros();
+    engine_.update(today);
+    ZoneMask zones = engine_.activeZones(minute);
+    zones_ = zones;
+    WakeInputs inputs;
+    inputs.resync_at_us = last_resync_us_ + (int64_t)CLOCK_RESYNC_INTERVAL_MS * 1000;
+    inputs.rate_ppb = rate_ppb_;
+    inputs.lead = selftest_end_us_ >= 0 ? nullptr : lead;
+    inputs.prepared = prepared_;
+    inputs.selftest_us = selftest_end_us_ >= 0 ? selftest_end_us_ - now_us : -1;
+    planning_ = this;
+    WakePlan plan = planWake(engine_, now_us, inputs);
+    uint32_t took = micros() - started;
+    stats_.wakes++;
+    stats_.tick_sum_us += took;
+    stats_.tick_max_us = max(stats_.tick_max_us, took);
+    if (plan.prepare) prepared_ = plan.prepare;
+
+    ZoneMask expected = referenceZones(config_, now_us / DAY_US, minute);
+    if (zones != expected) {
+        stats_.diffs++;
+        report("diff", now_us, "engine 0x%02x reference 0x%02x", zones, expected);
+    }
+
+    // The timer runs plan.timer_us, over which the clock advances at its rate
+    next_us = now_us + plan.timer_us + plan.timer_us * rate_ppb_ / 1000000000LL;
+    return zones;
+}
+
+// Every minute at which the reference changes between two wake-ups is an
+// edge the scheduler handled late: at the next wake-up
+void Replay::checkSleep(int64_t from_us, int64_t to_us, ZoneMask held) {
+    ZoneMask state = held;
+    for (int32_t day = from_us / DAY_US; (int64_t)day * DAY_US < to_us; day++) {
+        for (int i = 0; i < num_edges_; i++) {
+            int64_t at = (int64_t)day * DAY_US + edges_[i] * MINUTE_US;
+            if (at <= from_us) continue;
+            if (at >= to_us) break;
+            ZoneMask expected = referenceZones(config_, day, edges_[i]);
+            if (expected == state) continue;
+            stats_.edges++;
+            if (state == held && selftest_end_us_ < 0 && replayLeadMs(held, expected) &&
+                prepared_ != at / MINUTE_US) {
+                stats_.unprepared++;
+                report("unprepared", at, "0x%02x to 0x%02x", state, expected);
+            }
+            int64_t latency = to_us - at;
+            stats_.worst_latency_us = max(stats_.worst_latency_us, latency);
+            if (latency > TRANSITION_MARGIN_US) {
+                stats_.late_edges++;
+                report("late", at, "0x%02x to 0x%02x, %lld us", state, expected, (long long)latency);
+            }
+            state = expected;
+        }
+    }
+}
+
+// The next scripted event; generated: a DST change when one is due, else
+// every few days a clock setting, a power cut, an edit or a self-test
+bool Replay::nextEvent(int64_t now_us, ReplayEvent& event) {
+    if (!generated_) {
+        if (script_pos_ >= script_len_) return false;
+        event = script_[script_pos_++];
+        return true;
+    }
+
+    event.at_us = now_us + MINUTE_US * (60 + random_.next(10 * MINUTES_PER_DAY)) + random_.next(60000000);
+    switch (random_.next(4)) {
+        case 0:
+            event.type = REPLAY_SET_CLOCK;
+            event.arg_us = ((int64_t)random_.next(3 * 86400) - 3 * 43200) * 1000000 + random_.next(1000000);
+            break;
+        case 1:
+            event.type = REPLAY_POWER_CUT;
+            event.arg_us = (int64_t)(random_.next(2) ? 1 + random_.next(120) : 1 + random_.next(2 * 86400)) * 1000000;
+            break;
+        case 2:
+            event.type = REPLAY_EDIT;
+            event.arg_us = 0;
+            break;
+        default:
+            event.type = REPLAY_SELF_TEST;
+            event.arg_us = (int64_t)(10 + random_.next(590)) * 1000000 + random_.next(1000000);
+            break;
+    }
+
+    // Western European DST: 01:00 to 02:00 in March, 02:00 to 01:00 in October
+    int year = refDate(now_us / DAY_US).year;
+    int32_t days[3] = { lastSunday(year, 3), lastSunday(year, 10), lastSunday(year + 1, 3) };
+    for (int32_t day : days) {
+        bool spring = refDate(day).month == 3;
+        int64_t at = (int64_t)day * DAY_US + (spring ? 60 : 120) * MINUTE_US;
+        if (at <= now_us || at >= event.at_us || day == dst_day_) continue;
+        event.at_us = at;
+        event.type = REPLAY_SET_CLOCK;
+        event.arg_us = spring ? 3600000000LL : -3600000000LL;
+        dst_day_ = day;
+    }
+    return true;
+}
+
+// Returns the clock time after the event
+int64_t Replay::apply(const ReplayEvent& event, int64_t& simulated_us) {
+    switch (event.type) {
+        case REPLAY_SET_CLOCK:
+            // CMD_SET_CLOCK: the clock is anchored again and the periods evaluated right away.
+            // The self-test runs on the tick, so it ends at the same time on the new clock.
+            restart(event.at_us + event.arg_us);
+            if (selftest_end_us_ >= 0) selftest_end_us_ += event.arg_us;
+            return event.at_us + event.arg_us;
+
+        case REPLAY_POWER_CUT:
+            simulated_us += event.arg_us;
+            engine_ = ScheduleEngine();
+            engine_.load(config_);
+            restart(event.at_us + event.arg_us);
+            selftest_end_us_ = -1;
+            return event.at_us + event.arg_us;
+
+        case REPLAY_SELF_TEST:
+            selftest_end_us_ = event.at_us + event.arg_us;
+            break;
+
+        case REPLAY_EDIT:
+            if (config_.num_periods < MAX_PERIODS && (config_.num_periods == 0 || random_.next(2))) {
+                config_.periods[config_.num_periods++] = randomPeriod(random_);
+            } else if (random_.next(4) == 0) {
+                int removed = random_.next(config_.num_periods);
+                config_.periods[removed] = config_.periods[--config_.num_periods];
+            } else {
+                config_.periods[random_.next(config_.num_periods)] = randomPeriod(random_);
+            }
+            sortPeriods(config_);
+            engine_.load(config_); // CMD_CONFIG_CHANGED
+            prepared_ = 0;
+            buildEdges();
+            break;
+    }
+    return event.at_us;
+}
+
+void Replay::play(int64_t start_us, int64_t duration_us, const ReplayEvent* script, int script_len) {
+    generated_ = false;
+    script_ = script;
+    script_len_ = script_len;
+    script_pos_ = 0;
+    run(start_us, duration_us);
+}
+
+void Replay::fuzz(int64_t start_us, int64_t duration_us, uint32_t seed) {
+    generated_ = true;
+    random_.seed = seed;
+    rate_ppb_ = (int32_t)random_.next(100001) - 50000; // Up to 50 ppm either way
+    run(start_us, duration_us);
+}
+
+void Replay::run(int64_t start_us, int64_t duration_us) {
+    engine_ = ScheduleEngine();
+    engine_.load(config_);
+    buildEdges();
+    restart(start_us);
+    selftest_end_us_ = -1;
+
+    int64_t now = start_us;
+    int64_t simulated = 0;
+    ReplayEvent event;
+    bool pending = nextEvent(now, event);
+    while (simulated < duration_us) {
+        int64_t next;
+        ZoneMask held = wake(now, next);
+        if (pending && event.at_us <= next) {
+            int64_t at = max(event.at_us, now);
+            checkSleep(now, at, held);
+            simulated += at - now;
+            ReplayEvent due = event;
+            due.at_us = at;
+            now = max(apply(due, simulated), (int64_t)0);
+            pending = nextEvent(now, event);
+            continue;
+        }
+        checkSleep(now, next, held);
+        simulated += next - now;
+        now = next;
+    }
+    stats_.simulated_us += simulated;
+}
+
+static Period benchPeriod(int start, int end, uint8_t weekdays, uint8_t flags = 0, uint16_t from = 0, uint16_t to = 0) {
+    Period p;
+    p.start = start;
+    p.end = end;
+    p.weekdays = weekdays;
+    p.flags = flags;
+    p.from = from;
+    p.to = to;
+    return p;
+}
+
+static int64_t clockAt(int year, int month, int day, int hour, int minute, int second = 0) {
+    return ((int64_t)refDays(year, month, day) * 86400 + hour * 3600 + minute * 60 + second) * 1000000;
+}
+
+static void addStats(ReplayStats& total, const ReplayStats& stats) {
+    total.wakes += stats.wakes;
+    total.edges += stats.edges;
+    total.diffs += stats.diffs;
+    total.late_edges += stats.late_edges;
+    total.unprepared += stats.unprepared;
+    total.late_selftests += stats.late_selftests;
+    total.worst_latency_us = max(total.worst_latency_us, stats.worst_latency_us);
+    total.tick_max_us = max(total.tick_max_us, stats.tick_max_us);
+    total.tick_sum_us += stats.tick_sum_us;
+    total.simulated_us += stats.simulated_us;
+}
+
+static void replayScript(const char* name, int32_t rate_ppb, ReplayStats& total, int64_t start_us, int days,
+                         std::initializer_list<Period> periods, std::initializer_list<ReplayEvent> events) {
+    static AlarmData config;
+    config = AlarmData();
+    for (const Period& p : periods) config.periods[config.num_periods++] = p;
+    sortPeriods(config);
+
+    ReplayStats stats = {};
+    Replay replay(config, stats, name, rate_ppb);
+    replay.play(start_us, days * DAY_US, events.begin(), events.size());
+
+    char label[48];
+    snprintf(label, sizeof(label), "replay_%s_diffs", name);
+    report(label, stats.diffs, "wakes");
+    snprintf(label, sizeof(label), "replay_%s_late", name);
+    report(label, stats.late_edges, "edges");
+    snprintf(label, sizeof(label), "replay_%s_unprepared", name);
+    report(label, stats.unprepared, "edges");
+
+    addStats(total, stats);
+}
+
+uint32_t benchReplay() {
+    const uint8_t FRI_SAT = 1 << 5 | 1 << 6;
+    ReplayStats total = {};
+    unsigned long started = micros();
+
+    // Overnight periods (start > end) within a date range over New Year
+    replayScript("overnight", 0, total, clockAt(2025, 12, 15, 12, 0), 40,
+                 { benchPeriod(22 * 60, 6 * 60, FRI_SAT, 0, packMonthDay(12, 20), packMonthDay(1, 10)),
+                   benchPeriod(23 * 60 + 59, 1, ALL_WEEKDAYS) },
+                 {});
+
+    // Clock set from the page: over an edge, back before it, onto a boundary
+    replayScript("set_clock", -35000, total, clockAt(2025, 6, 2, 6, 0), 5,
+                 { benchPeriod(8 * 60, 18 * 60, ALL_WEEKDAYS), benchPeriod(20 * 60, 2 * 60, ALL_WEEKDAYS) },
+                 { { clockAt(2025, 6, 2, 7, 59, 30), REPLAY_SET_CLOCK, 4 * 3600000000LL },
+                   { clockAt(2025, 6, 2, 13, 0), REPLAY_SET_CLOCK, -6 * 3600000000LL },
+                   { clockAt(2025, 6, 3, 19, 59, 59), REPLAY_SET_CLOCK, 1000000 },
+                   { clockAt(2025, 6, 4, 1, 0), REPLAY_SET_CLOCK, -2 * 86400000000LL } });
+
+    // DST: an hour skipped in March, repeated in October
+    replayScript("dst", 20000, total, clockAt(2025, 3, 25, 0, 0), 220,
+                 { benchPeriod(30, 150, ALL_WEEKDAYS), benchPeriod(90, 180, ALL_WEEKDAYS, (1 % MAX_ZONES) << PERIOD_ZONE_SHIFT) },
+                 { { clockAt(2025, 3, 30, 1, 0), REPLAY_SET_CLOCK, 3600000000LL },
+                   { clockAt(2025, 10, 26, 2, 0), REPLAY_SET_CLOCK, -3600000000LL } });
+
+    // Power cuts inside periods, across an edge and over days, with a holiday
+    replayScript("power_cut", 0, total, clockAt(2025, 12, 20, 12, 0), 10,
+                 { benchPeriod(20 * 60, 4 * 60, ALL_WEEKDAYS),
+                   benchPeriod(0, 0, ALL_WEEKDAYS, PERIOD_EXCEPTION, packMonthDay(12, 24), packMonthDay(12, 24)) },
+                 { { clockAt(2025, 12, 20, 21, 0), REPLAY_POWER_CUT, 30 * MINUTE_US },
+                   { clockAt(2025, 12, 21, 3, 59, 59), REPLAY_POWER_CUT, 2000000 },
+                   { clockAt(2025, 12, 22, 10, 0), REPLAY_POWER_CUT, 3 * DAY_US } });
+
+    // Self-tests over a transition, ending on one, cut by a clock setting
+    replayScript("self_test", 50000, total, clockAt(2025, 5, 5, 7, 0), 3,
+                 { benchPeriod(8 * 60, 9 * 60, ALL_WEEKDAYS), benchPeriod(9 * 60 + 30, 10 * 60, ALL_WEEKDAYS) },
+                 { { clockAt(2025, 5, 5, 7, 58), REPLAY_SELF_TEST, 5 * MINUTE_US },
+                   { clockAt(2025, 5, 5, 8, 59, 30), REPLAY_SELF_TEST, 30000000 },
+                   { clockAt(2025, 5, 6, 9, 25), REPLAY_SELF_TEST, 10 * MINUTE_US },
+                   { clockAt(2025, 5, 6, 9, 27), REPLAY_SELF_TEST, 0 },
+                   { clockAt(2025, 5, 7, 7, 55), REPLAY_SELF_TEST, 10 * MINUTE_US },
+                   { clockAt(2025, 5, 7, 7, 57), REPLAY_SET_CLOCK, 3600000000LL } });
+
+    // Generated: random period sets and events
+    static AlarmData config;
+    for (int seed = 1; seed <= BENCH_REPLAY_SEEDS; seed++) {
+        BenchRandom random = { (uint32_t)seed * 7919 };
+        config = AlarmData();
+        config.num_periods = random.next(MAX_PERIODS + 1);
+        for (int i = 0; i < config.num_periods; i++) config.periods[i] = randomPeriod(random);
+        sortPeriods(config);
+
+        int64_t start = clockAt(2025, 1, 1, 0, 0) + random.next(365) * DAY_US + random.next(86400) * 1000000LL;
+        ReplayStats stats = {};
+        char name[16];
+        snprintf(name, sizeof(name), "seed%d", seed);
+        Replay replay(config, stats, name);
+        replay.fuzz(start, BENCH_REPLAY_DAYS * DAY_US, random.seed);
+
+        addStats(total, stats);
+        vTaskDelay(1); // Lets the idle task run between scenarios
+    }
+    unsigned long elapsed = micros() - started;
+
+    unsigned long days = total.simulated_us / DAY_US;
+    report("replay_days", days, "days");
+    report("replay_speed", elapsed ? (unsigned long)((uint64_t)days * 1000000 / elapsed) : 0, "days/s");
+    report("replay_wakes", total.wakes, "wakes");
+    report("replay_edges", total.edges, "edges");
+    report("replay_diffs", total.diffs, "wakes");
+    report("replay_late_edges", total.late_edges, "edges");
+    report("replay_unprepared", total.unprepared, "edges");
+    report("replay_late_selftests", total.late_selftests, "tests");
+    report("replay_worst_latency", total.worst_latency_us, "us");
+    report("replay_tick_max", total.tick_max_us, "us");
+    report("replay_tick_avg", total.wakes ? total.tick_sum_us * 1000 / total.wakes : 0, "ns");
+    return total.diffs + total.late_edges + total.unprepared + total.late_selftests;
+}
+
+uint32_t benchCore(AlarmData& config) {
+    benchBuildConfig(config, MAX_PERIODS);
+    benchSchedule(config);
+    uint32_t failures = benchReplay();
+    benchConfigChecksum(config);
+    benchConfigCodec(config);
+    benchJson(config);
+    report("bench_failures", failures, "failures");
+    return failures;
+}
+
+#endif
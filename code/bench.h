@@ -0,0 +1,73 @@
+/*
+ * On-device benchmarks for the GRAVE Controller (BENCH_ENABLED builds only).
+ *
+ * Runs once at boot, before the tasks start, and prints one line per
+ * measurement on Serial as "[BENCH] <name> <value> <unit>", so runs can be
+ * compared from a serial log. Measured: the schedule engine over a year of
+ * minute ticks with a full synthetic period set, page renders (time, bytes
+ * and heap blocks allocated), the configuration checksum, export encoding
+ * and JSON.
+ *
+ * None of them needs the hardware: host/Makefile builds them with these
+ * modules against small shims and runs them on a computer too.
+ *
+ * The replay bench runs the scheduler's wake-up logic on a virtual clock:
+ * scripted scenarios and generated ones (random period sets, clock
+ * settings, DST jumps, power cuts, edits, self-tests, clock rate
+ * corrections) are played through ScheduleEngine as fast as it goes,
+ * waking where planWake() says, as the scheduler task does. Every wake-up
+ * and every minute at which a zone should have changed in between is
+ * checked against a plain per-period evaluation, written for the bench and
+ * sharing no code with the engine. It reports the differences, the edges
+ * that fired later than TRANSITION_MARGIN_US or without the player
+ * prepared, self-tests that ended late, and the worst time an evaluation
+ * took.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include "alarm_config.h"
+#include "html_stream.h"
+#include "schedule.h"
+
+class HttpServer;
+
+#ifndef BENCH_ENABLED
+#define BENCH_ENABLED 0 // The host build (host/Makefile) sets it to 1
+#endif
+#define BENCH_REPLAY_SEEDS 20  // Generated scenarios...
+#define BENCH_REPLAY_DAYS 365  // ...of this many days each
+#define BENCH_REPLAY_REPORTS 5 // Differences printed in full
+
+// Deterministic set of num_periods periods: mixed weekdays, overnight
+// periods, yearly date ranges and exceptions
+void benchBuildConfig(AlarmData& config, int num_periods);
+
+// Every minute of a year (from 2025-01-01) through ScheduleEngine
+void benchSchedule(const AlarmData& config);
+
+// Reads a page to the end in PAGE_PIECE_SIZE reads
+void benchPage(const char* name, PageStream& page);
+
+// CRC32 of the periods blob, as written by ConfigStore
+void benchConfigChecksum(const AlarmData& config);
+
+// Export encoding and import of the whole configuration (config_codec.h)
+void benchConfigCodec(const AlarmData& config);
+
+// The periods as a JSON array with JsonWriter
+void benchJson(const AlarmData& config);
+
+// The main page (rendered, then with its configuration sections from
+// pageCache, then with a period in the editor), /api/config and /metrics,
+// on alarmConfig (see pages.h). Leaves pageSchedule loaded for today and
+// pageCache empty.
+void benchPages(const HttpServer& server, const ScheduleDate& today);
+
+// Scripted scenarios, then BENCH_REPLAY_SEEDS generated ones. Returns the
+// failures: differences, late or unprepared edges and late self-tests.
+uint32_t benchReplay();
+
+// Loads the synthetic configuration into config and runs everything above
+// but the pages. Returns the failures of benchReplay().
+uint32_t benchCore(AlarmData& config);
@@ -0,0 +1,128 @@
+/*
+ * Board profiles for the GRAVE Controller.
+ *
+ * Everything that differs between hardware variants (bus pins, the zone
+ * outputs and their polarity, the MP3 UART, the schedule size) is a template
+ * argument of BoardProfile, and `Board` selects the profile the firmware is
+ * built for. Outputs are typed objects: the pin and polarity are constants,
+ * so set() compiles down to a single GPIO set/clear register write, and it
+ * only writes when the state actually changes.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <soc/gpio_reg.h>
+#include <driver/gpio.h>
+
+// Push-pull GPIO output; ACTIVE_LOW outputs are on when the pin is LOW
+template <uint8_t PIN, bool ACTIVE_LOW>
+class GpioOutput {
+public:
+    static_assert(PIN < 49, "Not an ESP32-S3 GPIO");
+
+    void begin() {
+        pinMode(PIN, OUTPUT);
+        gpio_sleep_sel_dis((gpio_num_t)PIN); // Keeps its level through light sleep (see power.h)
+        write(false);
+        on_ = false;
+    }
+
+    void set(bool on) {
+        if (on == on_) return;
+        on_ = on;
+        write(on);
+    }
+
+    bool isOn() const { return on_; }
+
+private:
+    static void write(bool on) {
+        bool high = on != ACTIVE_LOW;
+        if (PIN < 32) {
+            REG_WRITE(high ? GPIO_OUT_W1TS_REG : GPIO_OUT_W1TC_REG, 1UL << (PIN & 31));
+        } else {
+            REG_WRITE(high ? GPIO_OUT1_W1TS_REG : GPIO_OUT1_W1TC_REG, 1UL << (PIN & 31));
+        }
+    }
+
+    bool on_ = false;
+};
+
+// A list of outputs: set(on) switches all of them, setAt(i, on) only the
+// i-th one. Elements may themselves be groups (several relays for one zone).
+template <typename... Outputs>
+class OutputGroup;
+
+template <>
+class OutputGroup<> {
+public:
+    static const int count = 0;
+
+    void begin() {}
+    void set(bool) {}
+    void setAt(int, bool) {}
+};
+
+template <typename First, typename... Rest>
+class OutputGroup<First, Rest...> {
+public:
+    static const int count = 1 + OutputGroup<Rest...>::count;
+
+    void begin() {
+        first_.begin();
+        rest_.begin();
+    }
+
+    void set(bool on) {
+        first_.set(on);
+        rest_.set(on);
+    }
+
+    void setAt(int index, bool on) {
+        if (index == 0) {
+            first_.set(on);
+        } else {
+            rest_.setAt(index - 1, on);
+        }
+    }
+
+    bool isOn() const { return first_.isOn(); }
+
+private:
+    First first_;
+    OutputGroup<Rest...> rest_;
+};
+
+template <uint8_t I2C_SDA, uint8_t I2C_SCL, typename ZONES,
+          uint8_t MP3_UART, uint8_t MP3_RX, uint8_t MP3_TX, uint8_t BUTTON, uint16_t MAX_PERIODS_>
+struct BoardProfile {
+    static constexpr uint8_t i2c_sda = I2C_SDA;
+    static constexpr uint8_t i2c_scl = I2C_SCL;
+
+    // One output per zone (an OutputGroup), switched on while one of the
+    // zone's periods is active
+    typedef ZONES Zones;
+    static constexpr uint8_t zones = ZONES::count;
+    static_assert(ZONES::count >= 1 && ZONES::count <= 8, "1 to 8 zones (ZoneMask is 8 bits)");
+
+    // MP3 module: UART number and the ESP32 pins (RX goes to the module's TX)
+    static constexpr uint8_t mp3_uart = MP3_UART;
+    static constexpr uint8_t mp3_rx = MP3_RX;
+    static constexpr uint8_t mp3_tx = MP3_TX;
+    static HardwareSerial& mp3Serial() { return MP3_UART == 2 ? Serial2 : Serial1; }
+
+    // Push button, active LOW (wakes the access point in power saving)
+    static constexpr uint8_t button = BUTTON;
+
+    // Schedule entries, across all weekdays and exceptions
+    static constexpr uint16_t max_periods = MAX_PERIODS_;
+};
+
+// ATOM S3 Lite on the Atomic Port ABC base: RTC on port A, relay unit
+// (active LOW) on port B, YX5300 on port C, the screen button on GPIO 41
+typedef BoardProfile<38, 39, OutputGroup<GpioOutput<7, true>>, 1, 5, 6, 41, 64> AtomS3LiteBoard;
+
+// Same, with a second relay (active LOW) on GPIO 8 as zone 2
+typedef BoardProfile<38, 39, OutputGroup<GpioOutput<7, true>, GpioOutput<8, true>>, 1, 5, 6, 41, 64> AtomS3LiteTwoZoneBoard;
+
+typedef AtomS3LiteBoard Board;
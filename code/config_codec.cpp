@@ -0,0 +1,278 @@
+/*
+ * Compact, versioned binary form of the configuration.
+ */
+#include "config_codec.h"
+#include "crc32.h"
+
+#define CODEC_MAGIC_0 'G'
+#define CODEC_MAGIC_1 'C'
+
+// Period record, in bits (least significant first)
+#define BITS_MINUTE 11    // start, end
+#define BITS_WEEKDAYS 7
+#define BITS_PLAYLIST 3
+#define BITS_ZONE 3       // At most 8 zones (see board.h)
+#define BITS_MONTH_DAY 9  // packMonthDay() of 12/31 is 415
+
+// --- WRITING ---
+
+struct CodecWriter {
+    uint8_t* out;
+    size_t len;
+    size_t pos = 0;
+    bool ok = true;
+    uint32_t bits = 0; // Pending bits of a bit-packed run
+    int num_bits = 0;
+
+    CodecWriter(uint8_t* out, size_t len) : out(out), len(len) {}
+
+    void byte(uint8_t value) {
+        if (pos >= len) {
+            ok = false;
+            return;
+        }
+        out[pos++] = value;
+    }
+
+    void varint(uint32_t value) {
+        while (value >= 0x80) {
+            byte((uint8_t)(value | 0x80));
+            value >>= 7;
+        }
+        byte((uint8_t)value);
+    }
+
+    void put(uint32_t value, int count) {
+        bits |= (value & ((1UL << count) - 1)) << num_bits;
+        num_bits += count;
+        while (num_bits >= 8) {
+            byte((uint8_t)bits);
+            bits >>= 8;
+            num_bits -= 8;
+        }
+    }
+
+    // Ends a bit-packed run on a byte boundary
+    void align() {
+        if (num_bits > 0) byte((uint8_t)bits);
+        bits = 0;
+        num_bits = 0;
+    }
+};
+
+static void writePeriods(CodecWriter& w, const AlarmData& config) {
+    w.varint(config.num_periods);
+    for (int i = 0; i < config.num_periods; i++) {
+        const Period& p = config.periods[i];
+        w.put(p.start, BITS_MINUTE);
+        w.put(p.end, BITS_MINUTE);
+        w.put(p.weekdays, BITS_WEEKDAYS);
+        w.put(p.flags & PERIOD_EXCEPTION, 1);
+        w.put(periodPlaylist(p), BITS_PLAYLIST);
+        w.put(periodZone(p), BITS_ZONE);
+        bool dated = p.from || p.to;
+        w.put(dated, 1);
+        if (dated) {
+            w.put(p.from, BITS_MONTH_DAY);
+            w.put(p.to, BITS_MONTH_DAY);
+        }
+    }
+    w.align();
+}
+
+static void writeZones(CodecWriter& w, const AlarmData& config) {
+    w.varint(MAX_ZONES);
+    for (const ZoneSettings& zone : config.zones) {
+        w.varint(zone.track);
+        w.byte(zone.volume);
+    }
+}
+
+// Only the playlists in use: a mask of them, then each one in order
+static void writePlaylists(CodecWriter& w, const AlarmData& config) {
+    uint8_t defined = 0;
+    for (int i = 0; i < MAX_PLAYLISTS; i++) {
+        if (config.playlists[i].length) defined |= 1 << i;
+    }
+    w.byte(defined);
+    for (const Playlist& list : config.playlists) {
+        if (!list.length) continue;
+        w.byte(list.length);
+        w.byte(list.fade_in_seconds);
+        w.byte(list.fade_out_seconds);
+        for (int e = 0; e < list.length; e++) {
+            w.varint(list.entries[e].track);
+            w.byte(list.entries[e].volume);
+        }
+    }
+}
+
+size_t configEncode(const AlarmData& config, uint8_t fields, uint8_t* out, size_t len) {
+    CodecWriter w(out, len);
+    w.byte(CODEC_MAGIC_0);
+    w.byte(CODEC_MAGIC_1);
+    w.byte(CONFIG_CODEC_VERSION);
+
+    for (int bit = 0; bit < CONFIG_FIELD_COUNT; bit++) {
+        uint8_t field = 1 << bit;
+        if (!(fields & field)) continue;
+        w.byte(bit);
+        // Two-byte varint, filled in once the payload is written
+        size_t length_at = w.pos;
+        w.byte(0x80);
+        w.byte(0);
+        size_t start = w.pos;
+
+        switch (field) {
+            case CONFIG_FIELD_VOLUME: w.byte(config.volume); break;
+            case CONFIG_FIELD_PERIODS: writePeriods(w, config); break;
+            case CONFIG_FIELD_SELFTEST: w.byte(config.selftest_seconds); break;
+            case CONFIG_FIELD_ZONES: writeZones(w, config); break;
+            case CONFIG_FIELD_PLAYLISTS: writePlaylists(w, config); break;
+        }
+        if (!w.ok) return 0;
+        size_t payload = w.pos - start;
+        out[length_at] = (uint8_t)(payload | 0x80);
+        out[length_at + 1] = (uint8_t)(payload >> 7);
+    }
+
+    uint32_t crc = crc32(out, w.pos);
+    for (int i = 0; i < 4; i++) w.byte((uint8_t)(crc >> (8 * i)));
+    return w.ok ? w.pos : 0;
+}
+
+// --- READING ---
+
+struct CodecReader {
+    const uint8_t* data;
+    size_t len;
+    size_t pos = 0;
+    bool ok = true;
+    uint32_t bits = 0;
+    int num_bits = 0;
+
+    CodecReader(const uint8_t* data, size_t len) : data(data), len(len) {}
+
+    bool done() const { return pos >= len; }
+
+    uint8_t byte() {
+        if (pos >= len) {
+            ok = false;
+            return 0;
+        }
+        return data[pos++];
+    }
+
+    uint32_t varint() {
+        uint32_t value = 0;
+        for (int shift = 0; shift < 32; shift += 7) {
+            uint8_t b = byte();
+            value |= (uint32_t)(b & 0x7F) << shift;
+            if (!(b & 0x80)) return value;
+        }
+        ok = false;
+        return 0;
+    }
+
+    uint32_t get(int count) {
+        while (num_bits < count) {
+            bits |= (uint32_t)byte() << num_bits;
+            num_bits += 8;
+        }
+        uint32_t value = bits & ((1UL << count) - 1);
+        bits >>= count;
+        num_bits -= count;
+        return value;
+    }
+};
+
+static bool readPeriods(CodecReader& r, AlarmData& config) {
+    uint32_t count = r.varint();
+    if (count > MAX_PERIODS) return false; // Dropping some would silently change the schedule
+    config.num_periods = count;
+    for (uint32_t i = 0; i < count; i++) {
+        Period p;
+        p.start = r.get(BITS_MINUTE);
+        p.end = r.get(BITS_MINUTE);
+        p.weekdays = r.get(BITS_WEEKDAYS);
+        p.flags = r.get(1) ? PERIOD_EXCEPTION : 0;
+        setPeriodPlaylist(p, r.get(BITS_PLAYLIST));
+        setPeriodZone(p, r.get(BITS_ZONE));
+        if (r.get(1)) {
+            p.from = r.get(BITS_MONTH_DAY);
+            p.to = r.get(BITS_MONTH_DAY);
+        }
+        config.periods[i] = p;
+    }
+    return r.ok;
+}
+
+// From a board with a different number of zones, the common ones are taken
+static bool readZones(CodecReader& r, AlarmData& config) {
+    uint32_t count = r.varint();
+    for (uint32_t z = 0; z < count && r.ok; z++) {
+        ZoneSettings zone;
+        zone.track = r.varint();
+        zone.volume = r.byte();
+        if (z < (uint32_t)MAX_ZONES) config.zones[z] = zone;
+    }
+    return r.ok;
+}
+
+static bool readPlaylists(CodecReader& r, AlarmData& config) {
+    uint8_t defined = r.byte();
+    for (int i = 0; i < MAX_PLAYLISTS; i++) {
+        Playlist& list = config.playlists[i];
+        list = Playlist();
+        if (!(defined & (1 << i))) continue;
+        list.length = r.byte();
+        list.fade_in_seconds = r.byte();
+        list.fade_out_seconds = r.byte();
+        if (list.length > PLAYLIST_LENGTH) return false;
+        for (int e = 0; e < list.length; e++) {
+            list.entries[e].track = r.varint();
+            list.entries[e].volume = r.byte();
+        }
+    }
+    return r.ok;
+}
+
+uint8_t configDecode(const uint8_t* data, size_t len, AlarmData& config) {
+    static AlarmData decoded; // Only copied to config once the whole encoding checks out
+    if (len < 3 + 4 || data[0] != CODEC_MAGIC_0 || data[1] != CODEC_MAGIC_1) return 0;
+    if (data[2] == 0 || data[2] > CONFIG_CODEC_VERSION) return 0;
+
+    size_t body = len - 4;
+    uint32_t crc = 0;
+    for (int i = 0; i < 4; i++) crc |= (uint32_t)data[body + i] << (8 * i);
+    if (crc32(data, body) != crc) return 0;
+
+    decoded = config;
+    uint8_t fields = 0;
+    CodecReader sections(data + 3, body - 3);
+    while (!sections.done()) {
+        uint8_t id = sections.byte();
+        uint32_t length = sections.varint();
+        if (!sections.ok || length > sections.len - sections.pos) return 0;
+        CodecReader r(sections.data + sections.pos, length);
+        sections.pos += length;
+
+        if (id >= CONFIG_FIELD_COUNT) continue; // Written by newer firmware
+
+        uint8_t field = 1 << id;
+        bool ok = true;
+        switch (field) {
+            case CONFIG_FIELD_VOLUME: decoded.volume = r.byte(); ok = r.ok; break;
+            case CONFIG_FIELD_PERIODS: ok = readPeriods(r, decoded); break;
+            case CONFIG_FIELD_SELFTEST: decoded.selftest_seconds = r.byte(); ok = r.ok; break;
+            case CONFIG_FIELD_ZONES: ok = readZones(r, decoded); break;
+            case CONFIG_FIELD_PLAYLISTS: ok = readPlaylists(r, decoded); break;
+        }
+        if (!ok) return 0;
+        fields |= field;
+    }
+
+    validateConfig(decoded);
+    config = decoded;
+    return fields;
+}
@@ -0,0 +1,43 @@
+/*
+ * Compact, versioned binary form of the configuration, for export and
+ * import (GET /api/config/export, POST /api/config/import).
+ *
+ * NVS holds each field in its in-memory layout (see ConfigStore), which is
+ * fast to load but tied to the firmware's structs. This format is not:
+ *
+ *   'G' 'C' | version | sections ... | CRC-32 (uint32, little-endian)
+ *
+ * Each section is a field (CONFIG_FIELD_* bit number, one byte), its length
+ * as a varint and its payload. Readers skip the sections they do not know
+ * and keep their current value for the fields that are absent, so a field
+ * added later only needs a new section number; the version only changes
+ * when an existing section changes meaning. Periods are bit-packed (37 bits,
+ * 55 with a date range, instead of 10 bytes) and counts and track numbers
+ * are varints, so a full 64-period configuration is well under 1 KB.
+ *
+ * Exports do not depend on the board's zone count: an import takes the
+ * zones the board has and drops the periods of the others, as when loading.
+ * One with more periods than the board holds is refused.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include "alarm_config.h"
+#include "config_store.h"
+
+#define CONFIG_CODEC_VERSION 1
+
+// Largest encoding for this board: header, CRC, the section headers, the
+// periods with date ranges, and every zone and playlist entry
+#define CONFIG_CODEC_MAX_SIZE (3 + 4 + CONFIG_FIELD_COUNT * 3 + 3 + (MAX_PERIODS * 55 + 7) / 8 + \
+                               1 + MAX_ZONES * 3 + 1 + MAX_PLAYLISTS * (3 + PLAYLIST_LENGTH * 3) + 2)
+
+// Writes the selected fields (CONFIG_FIELD_*). Returns the length, 0 if
+// `len` is too small.
+size_t configEncode(const AlarmData& config, uint8_t fields, uint8_t* out, size_t len);
+
+// Reads an encoding into config, which should hold the current
+// configuration; it is only changed if the whole encoding checks out, and
+// is then validated as if loaded from NVS. Returns the fields read, 0 if the
+// data is malformed, fails its CRC or comes from a newer format version.
+uint8_t configDecode(const uint8_t* data, size_t len, AlarmData& config);
@@ -0,0 +1,239 @@
+/*
+ * Persistent configuration store (NVS).
+ */
+#include "config_store.h"
+#include <EEPROM.h>
+#include "crc32.h"
+#include "trace.h"
+#include "schedule.h"
+
+#define CONFIG_NAMESPACE "grave"
+#define KEY_VOLUME "vol"
+#define KEY_PERIODS "periods"
+#define KEY_SELFTEST "selftest"
+#define KEY_ZONES "zones"
+#define KEY_PLAYLISTS "playlists"
+
+// Previous storage: the whole struct written to emulated EEPROM
+#define EEPROM_SIZE 1024
+#define EEPROM_CONFIG_ADDRESS 0
+
+// Largest field payload, plus its CRC trailer
+static uint8_t field_buffer[sizeof(Period) * MAX_PERIODS + sizeof(uint32_t)];
+
+static int fieldIndex(uint8_t field) {
+    return __builtin_ctz(field);
+}
+
+// Ensures the values are within limits
+void validateConfig(AlarmData& config) {
+    config.volume = constrain(config.volume, 0, 30);
+    config.selftest_seconds = min(config.selftest_seconds, (uint8_t)MAX_SELFTEST_SECONDS);
+    for (int z = 0; z < MAX_ZONES; z++) {
+        ZoneSettings& zone = config.zones[z];
+        if (zone.track == 0) zone.track = 1;
+        if (zone.volume > 30 && zone.volume != ZONE_VOLUME_MAIN) zone.volume = ZONE_VOLUME_MAIN;
+    }
+    for (Playlist& list : config.playlists) {
+        list.length = min(list.length, (uint8_t)PLAYLIST_LENGTH);
+        list.fade_in_seconds = min(list.fade_in_seconds, (uint8_t)MAX_FADE_SECONDS);
+        list.fade_out_seconds = min(list.fade_out_seconds, (uint8_t)MAX_FADE_SECONDS);
+        for (PlaylistEntry& entry : list.entries) {
+            if (entry.track == 0) entry.track = 1;
+            if (entry.volume > 30 && entry.volume != ZONE_VOLUME_MAIN) entry.volume = ZONE_VOLUME_MAIN;
+        }
+    }
+    config.num_periods = min(config.num_periods, (uint16_t)MAX_PERIODS);
+    int valid = 0;
+    for (int i = 0; i < config.num_periods; i++) {
+        const Period& p = config.periods[i];
+        // Periods of zones this board does not have are dropped
+        if (p.start < MINUTES_PER_DAY && p.end < MINUTES_PER_DAY && periodZone(p) < MAX_ZONES) {
+            config.periods[valid++] = p;
+        }
+    }
+    config.num_periods = valid;
+    sortPeriods(config);
+}
+
+bool ConfigStore::begin() {
+    return prefs_.begin(CONFIG_NAMESPACE, false);
+}
+
+bool ConfigStore::readField(const char* key, void* data, size_t len, size_t* out_len) {
+    size_t stored = prefs_.getBytesLength(key);
+    if (stored < sizeof(uint32_t) || stored > len + sizeof(uint32_t)) return false;
+
+    prefs_.getBytes(key, field_buffer, stored);
+    size_t payload = stored - sizeof(uint32_t);
+    uint32_t crc;
+    memcpy(&crc, field_buffer + payload, sizeof(crc));
+    if (crc32(field_buffer, payload) != crc) return false;
+
+    memcpy(data, field_buffer, payload);
+    *out_len = payload;
+    return true;
+}
+
+void ConfigStore::writeField(uint8_t field, const char* key, const void* data, size_t len) {
+    uint32_t crc = crc32(data, len);
+    if (crc == saved_crc_[fieldIndex(field)] && prefs_.isKey(key)) return; // Unchanged
+
+    memcpy(field_buffer, data, len);
+    memcpy(field_buffer + len, &crc, sizeof(crc));
+    if (prefs_.putBytes(key, field_buffer, len + sizeof(crc)) == len + sizeof(crc)) {
+        saved_crc_[fieldIndex(field)] = crc;
+        writes_++;
+        TRACE(TRACE_NVS_SAVED, field, len + sizeof(crc));
+    } else {
+        TRACE(TRACE_NVS_ERROR, field);
+    }
+}
+
+// Converts a configuration saved to EEPROM by earlier firmware
+bool ConfigStore::importFromEeprom(AlarmData& config) {
+    if (!EEPROM.begin(EEPROM_SIZE)) return false;
+
+    bool imported = false;
+    EepromAlarmData stored;
+    EEPROM.get(EEPROM_CONFIG_ADDRESS, stored);
+
+    if (stored.signature == EEPROM_SIGNATURE) {
+        AlarmData converted;
+        converted.num_periods = min(min(stored.num_periods, (uint16_t)EEPROM_MAX_PERIODS), (uint16_t)MAX_PERIODS);
+        memcpy(converted.periods, stored.periods, sizeof(Period) * converted.num_periods);
+        converted.volume = stored.volume;
+        config = converted;
+        Serial.println("[NVS] Imported configuration from EEPROM.");
+        imported = true;
+    } else {
+        // Layout of the 3-period firmware
+        LegacyAlarmData legacy;
+        EEPROM.get(EEPROM_CONFIG_ADDRESS, legacy);
+        if ((uint32_t)legacy.signature == LEGACY_SIGNATURE) {
+            AlarmData converted;
+            int count = constrain(legacy.num_periods, 0, LEGACY_MAX_PERIODS);
+            for (int i = 0; i < count; i++) {
+                const LegacyPeriod& lp = legacy.periods[i];
+                Period& p = converted.periods[converted.num_periods++];
+                p.start = constrain(lp.start_h, 0, 23) * 60 + constrain(lp.start_m, 0, 59);
+                p.end = constrain(lp.end_h, 0, 23) * 60 + constrain(lp.end_m, 0, 59);
+            }
+            converted.volume = legacy.volume;
+            config = converted;
+            Serial.println("[NVS] Imported configuration from the 3-period EEPROM layout.");
+            imported = true;
+        }
+    }
+
+    EEPROM.end();
+    return imported;
+}
+
+void ConfigStore::load(AlarmData& config) {
+    AlarmData loaded;
+
+    if (!prefs_.isKey(KEY_VOLUME) && !prefs_.isKey(KEY_PERIODS)) {
+        // First boot with NVS storage
+        if (!importFromEeprom(loaded)) {
+            Serial.println("[NVS] Invalid data/First run. Using defaults.");
+        }
+        dirty_ = CONFIG_FIELD_ALL; // Saved below, once validated
+    } else {
+        uint8_t volume;
+        size_t len;
+        if (readField(KEY_VOLUME, &volume, sizeof(volume), &len) && len == sizeof(volume)) {
+            loaded.volume = volume;
+            saved_crc_[fieldIndex(CONFIG_FIELD_VOLUME)] = crc32(&volume, len);
+        } else {
+            Serial.println("[NVS] Volume missing or corrupted. Using default.");
+            dirty_ |= CONFIG_FIELD_VOLUME;
+        }
+
+        if (readField(KEY_PERIODS, loaded.periods, sizeof(loaded.periods), &len) && len % sizeof(Period) == 0) {
+            loaded.num_periods = len / sizeof(Period);
+            saved_crc_[fieldIndex(CONFIG_FIELD_PERIODS)] = crc32(loaded.periods, len);
+        } else {
+            Serial.println("[NVS] Periods missing or corrupted. Starting without periods.");
+            loaded.num_periods = 0;
+            dirty_ |= CONFIG_FIELD_PERIODS;
+        }
+
+        // Added after the first NVS firmware: a missing entry is not an error
+        uint8_t selftest;
+        if (readField(KEY_SELFTEST, &selftest, sizeof(selftest), &len) && len == sizeof(selftest)) {
+            loaded.selftest_seconds = selftest;
+            saved_crc_[fieldIndex(CONFIG_FIELD_SELFTEST)] = crc32(&selftest, len);
+        }
+
+        // Same; stored for as many zones as the board had when it was saved
+        ZoneSettings zones[8];
+        if (readField(KEY_ZONES, zones, sizeof(zones), &len) && len % sizeof(ZoneSettings) == 0) {
+            int stored = len / sizeof(ZoneSettings);
+            memcpy(loaded.zones, zones, sizeof(ZoneSettings) * min(stored, MAX_ZONES));
+            if (stored == MAX_ZONES) {
+                saved_crc_[fieldIndex(CONFIG_FIELD_ZONES)] = crc32(zones, len);
+            } else {
+                dirty_ |= CONFIG_FIELD_ZONES;
+            }
+        }
+
+        if (readField(KEY_PLAYLISTS, loaded.playlists, sizeof(loaded.playlists), &len)) {
+            if (len == sizeof(loaded.playlists)) {
+                saved_crc_[fieldIndex(CONFIG_FIELD_PLAYLISTS)] = crc32(loaded.playlists, len);
+            } else {
+                Serial.println("[NVS] Playlists corrupted. Using defaults.");
+                for (Playlist& list : loaded.playlists) list = Playlist();
+                dirty_ |= CONFIG_FIELD_PLAYLISTS;
+            }
+        }
+    }
+
+    validateConfig(loaded);
+
+    config = loaded;
+    if (dirty_) flush(config);
+
+    Serial.printf("[NVS] %d periods and volume %d loaded.\n", config.num_periods, config.volume);
+}
+
+void ConfigStore::markDirty(uint8_t fields) {
+    unsigned long now = millis();
+    if (dirty_ == 0) first_change_ms_ = now;
+    last_change_ms_ = now;
+    dirty_ |= fields;
+}
+
+void ConfigStore::poll(const AlarmData& config) {
+    if (dirty_ == 0) return;
+
+    unsigned long now = millis();
+    if (flushed_ && now - last_flush_ms_ < CONFIG_SAVE_INTERVAL_MS) return;
+    if (now - last_change_ms_ >= CONFIG_SAVE_DELAY_MS || now - first_change_ms_ >= CONFIG_SAVE_MAX_DELAY_MS) {
+        flush(config);
+    }
+}
+
+void ConfigStore::flush(const AlarmData& config) {
+    uint8_t fields = dirty_;
+    dirty_ = 0;
+    last_flush_ms_ = millis();
+    flushed_ = true;
+
+    if (fields & CONFIG_FIELD_VOLUME) {
+        uint8_t volume = config.volume;
+        writeField(CONFIG_FIELD_VOLUME, KEY_VOLUME, &volume, sizeof(volume));
+    }
+    if (fields & CONFIG_FIELD_PERIODS) {
+        writeField(CONFIG_FIELD_PERIODS, KEY_PERIODS, config.periods, config.num_periods * sizeof(Period));
+    }
+    if (fields & CONFIG_FIELD_SELFTEST) {
+        writeField(CONFIG_FIELD_SELFTEST, KEY_SELFTEST, &config.selftest_seconds, sizeof(config.selftest_seconds));
+    }
+    if (fields & CONFIG_FIELD_ZONES) {
+        writeField(CONFIG_FIELD_ZONES, KEY_ZONES, config.zones, sizeof(config.zones));
+    }
+    if (fields & CONFIG_FIELD_PLAYLISTS) {
+        writeField(CONFIG_FIELD_PLAYLISTS, KEY_PLAYLISTS, config.playlists, sizeof(config.playlists));
+    }
+}
@@ -0,0 +1,72 @@
+/*
+ * Persistent configuration store (NVS).
+ *
+ * Each configuration field is its own NVS entry followed by a CRC-32. NVS is
+ * an append-only, wear-levelled log, so saving a field appends one small
+ * entry instead of rewriting a whole flash sector. Only the fields marked
+ * dirty are written, only if their content changed, and changes are
+ * coalesced: a burst of edits (e.g. dragging the volume slider) results in
+ * one write once the edits settle.
+ *
+ * Configurations from the old EEPROM layouts are imported on first boot.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "alarm_config.h"
+
+// Configuration fields, combined as a bit mask
+#define CONFIG_FIELD_VOLUME   0x01
+#define CONFIG_FIELD_PERIODS  0x02
+#define CONFIG_FIELD_SELFTEST 0x04
+#define CONFIG_FIELD_ZONES    0x08
+#define CONFIG_FIELD_PLAYLISTS 0x10
+#define CONFIG_FIELD_ALL      0x1F
+#define CONFIG_FIELD_COUNT    5
+
+#define CONFIG_SAVE_DELAY_MS 3000      // Write after this long without further changes...
+#define CONFIG_SAVE_MAX_DELAY_MS 15000 // ...but never later than this after the first one
+#define CONFIG_SAVE_INTERVAL_MS 15000  // and never sooner than this after the previous write:
+                                       // at most 4 writes a minute, however often it is edited
+
+// Clamps a configuration to valid values (as done on load) and drops the
+// periods this board cannot run
+void validateConfig(AlarmData& config);
+
+class ConfigStore {
+public:
+    // Opens the NVS namespace. Returns false if NVS is unusable.
+    bool begin();
+
+    // Loads the stored configuration (or imports/creates it). Fields that
+    // are missing or fail their CRC fall back to defaults.
+    void load(AlarmData& config);
+
+    // Records that fields of the configuration changed
+    void markDirty(uint8_t fields);
+
+    // Writes pending changes once they are due (call regularly, same task
+    // that edits the configuration)
+    void poll(const AlarmData& config);
+
+    // Writes pending changes now
+    void flush(const AlarmData& config);
+
+    bool hasPendingChanges() const { return dirty_ != 0; }
+    uint32_t writeCount() const { return writes_; }
+
+private:
+    bool readField(const char* key, void* data, size_t len, size_t* out_len);
+    void writeField(uint8_t field, const char* key, const void* data, size_t len);
+    bool importFromEeprom(AlarmData& config);
+
+    Preferences prefs_;
+    uint8_t dirty_ = 0;
+    unsigned long first_change_ms_ = 0;
+    unsigned long last_change_ms_ = 0;
+    unsigned long last_flush_ms_ = 0;
+    bool flushed_ = false;
+    uint32_t saved_crc_[CONFIG_FIELD_COUNT] = {}; // CRC of what is in flash, per field
+    uint32_t writes_ = 0;
+};
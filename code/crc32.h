@@ -0,0 +1,9 @@
+/*
+ * CRC-32 (IEEE 802.3, as used by zlib) for stored and transmitted data.
+ */
+#pragma once
+
+#include <Arduino.h>
+
+// Pass the previous result as `crc` to checksum data in several parts.
+uint32_t crc32(const void* data, size_t len, uint32_t crc = 0);
@@ -0,0 +1,316 @@
+/*
+ * Fleet protocol: discovery, status beacons and configuration push.
+ */
+#include "fleet.h"
+#include <lwip/sockets.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <mbedtls/md.h>
+#include <Preferences.h>
+#include "config_store.h"
+#include "crc32.h"
+#include "trace.h"
+
+// FleetLink::poll() reject reasons, as logged
+#define REJECT_FORMAT 1 // Not a fleet datagram of this version, or inconsistent lengths
+#define REJECT_TAG 2    // Wrong key, or altered on the way
+#define REJECT_REPLAY 3 // Sequence number not newer than the sender's last
+
+// The whole configuration fits in one datagram to the group
+#define CONFIG_PAYLOAD_SIZE (1 + CONFIG_FIELD_COUNT * 2 + 1 + sizeof(Period) * MAX_PERIODS + 1 + \
+                             sizeof(ZoneSettings) * MAX_ZONES + sizeof(Playlist) * MAX_PLAYLISTS)
+static_assert(CONFIG_PAYLOAD_SIZE <= FLEET_DATAGRAM_SIZE - sizeof(FleetHeader) - FLEET_TAG_SIZE,
+              "Configuration too large for one fleet datagram");
+
+static uint8_t tx_buffer[FLEET_DATAGRAM_SIZE]; // Network task only
+
+// --- LINK ---
+
+// The NVS counter holds the block of sequence numbers in use, so that the
+// next boot starts above it. Without NVS every boot starts at block 1, and
+// the other units drop this one's datagrams until it passes its old numbers.
+static uint32_t storedSeqBlock() {
+    Preferences prefs;
+    if (!prefs.begin("fleet", false)) return 0;
+    uint32_t block = prefs.getUInt("seq_block", 0);
+    prefs.end();
+    return block;
+}
+
+static void storeSeqBlock(uint32_t block) {
+    Preferences prefs;
+    if (!prefs.begin("fleet", false)) return;
+    prefs.putUInt("seq_block", block);
+    prefs.end();
+}
+
+bool FleetLink::begin(uint32_t unit_id, const char* key, uint32_t interface_address) {
+    end();
+    unit_id_ = unit_id;
+    key_ = key;
+    interface_address_ = interface_address;
+    if (!seq_started_) { // Once per boot: reconnecting keeps counting
+        seq_ = (storedSeqBlock() + 1) * FLEET_SEQ_BLOCK;
+        storeSeqBlock(seq_ / FLEET_SEQ_BLOCK);
+        seq_started_ = true;
+    }
+
+    fd_ = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (fd_ < 0) return false;
+
+    int reuse = 1;
+    setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in local = {};
+    local.sin_family = AF_INET;
+    local.sin_port = htons(FLEET_PORT);
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    // Joined and sent on the station interface only, never on the soft-AP
+    ip_mreq membership = {};
+    membership.imr_multiaddr.s_addr = htonl(FLEET_GROUP_ADDRESS);
+    membership.imr_interface.s_addr = interface_address;
+    in_addr interface = {};
+    interface.s_addr = interface_address;
+    uint8_t ttl = 1; // Site network only
+    uint8_t loop = 0;
+
+    if (bind(fd_, (sockaddr*)&local, sizeof(local)) < 0 ||
+        setsockopt(fd_, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) < 0 ||
+        setsockopt(fd_, IPPROTO_IP, IP_MULTICAST_IF, &interface, sizeof(interface)) < 0) {
+        end();
+        return false;
+    }
+    setsockopt(fd_, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+    setsockopt(fd_, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+    fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL, 0) | O_NONBLOCK);
+    return true;
+}
+
+void FleetLink::end() {
+    if (fd_ < 0) return;
+    close(fd_);
+    fd_ = -1;
+}
+
+bool FleetLink::isNewer(uint32_t sender, uint32_t seq) {
+    uint32_t now = millis();
+    int slot = -1;
+    int oldest = 0;
+    for (int i = 0; i < num_senders_ && slot < 0; i++) {
+        if (senders_[i].id == sender) slot = i;
+        else if (now - senders_[i].heard_ms > now - senders_[oldest].heard_ms) oldest = i;
+    }
+    if (slot >= 0) {
+        // Serial number comparison: the counters wrap
+        if ((int32_t)(seq - senders_[slot].last_seq) <= 0) return false;
+    } else {
+        slot = num_senders_ < FLEET_MAX_SENDERS ? num_senders_++ : oldest;
+        senders_[slot].id = sender;
+    }
+    senders_[slot].last_seq = seq;
+    senders_[slot].heard_ms = now;
+    return true;
+}
+
+void FleetLink::tag(const uint8_t* data, size_t len, uint8_t* out) const {
+    uint8_t mac[32];
+    mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), (const unsigned char*)key_, strlen(key_),
+                    data, len, mac);
+    memcpy(out, mac, FLEET_TAG_SIZE);
+}
+
+void FleetLink::poll(FleetHandler handler) {
+    if (fd_ < 0) return;
+
+    for (;;) {
+        sockaddr_in from = {};
+        socklen_t from_len = sizeof(from);
+        int n = recvfrom(fd_, buffer_, sizeof(buffer_), 0, (sockaddr*)&from, &from_len);
+        if (n < 0) return; // Nothing left (EWOULDBLOCK)
+
+        FleetHeader header;
+        if ((size_t)n < sizeof(header) + FLEET_TAG_SIZE) {
+            rejected_++;
+            TRACE(TRACE_FLEET_REJECTED, n, REJECT_FORMAT);
+            continue;
+        }
+        memcpy(&header, buffer_, sizeof(header));
+        size_t targets_len = header.targets * sizeof(uint32_t);
+        if (header.magic != FLEET_MAGIC || header.version != FLEET_VERSION ||
+            sizeof(header) + targets_len + header.length + FLEET_TAG_SIZE != (size_t)n) {
+            rejected_++;
+            TRACE(TRACE_FLEET_REJECTED, n, REJECT_FORMAT);
+            continue;
+        }
+
+        // Constant-time comparison of the tag
+        uint8_t expected[FLEET_TAG_SIZE];
+        size_t signed_len = n - FLEET_TAG_SIZE;
+        tag(buffer_, signed_len, expected);
+        uint8_t diff = 0;
+        for (int i = 0; i < FLEET_TAG_SIZE; i++) diff |= expected[i] ^ buffer_[signed_len + i];
+        if (diff) {
+            rejected_++;
+            TRACE(TRACE_FLEET_REJECTED, n, REJECT_TAG);
+            continue;
+        }
+
+        if (header.sender == unit_id_) continue;
+        // Every verified datagram advances its sender's number, addressed
+        // to this unit or not
+        if (!isNewer(header.sender, header.seq)) {
+            rejected_++;
+            TRACE(TRACE_FLEET_REJECTED, n, REJECT_REPLAY);
+            continue;
+        }
+        bool addressed = header.targets == 0;
+        for (int i = 0; i < header.targets && !addressed; i++) {
+            uint32_t target;
+            memcpy(&target, buffer_ + sizeof(header) + i * sizeof(uint32_t), sizeof(target));
+            addressed = target == unit_id_;
+        }
+        if (!addressed) continue;
+
+        received_++;
+        FleetMessage message;
+        message.header = (const FleetHeader*)buffer_;
+        message.payload = buffer_ + sizeof(header) + targets_len;
+        message.length = header.length;
+        message.from_address = from.sin_addr.s_addr;
+        message.from_port = ntohs(from.sin_port);
+        handler(message);
+    }
+}
+
+uint32_t FleetLink::send(uint8_t type, const void* payload, size_t len) {
+    return sendTo(htonl(FLEET_GROUP_ADDRESS), FLEET_PORT, type, payload, len);
+}
+
+uint32_t FleetLink::sendTo(uint32_t address, uint16_t port, uint8_t type, const void* payload, size_t len) {
+    if (fd_ < 0 || sizeof(FleetHeader) + len + FLEET_TAG_SIZE > sizeof(tx_buffer)) return 0;
+
+    FleetHeader header = {};
+    header.magic = FLEET_MAGIC;
+    header.version = FLEET_VERSION;
+    header.type = type;
+    header.sender = unit_id_;
+    header.seq = ++seq_;
+    if (seq_ % FLEET_SEQ_BLOCK == 0) storeSeqBlock(seq_ / FLEET_SEQ_BLOCK);
+    header.length = len;
+    memcpy(tx_buffer, &header, sizeof(header));
+    if (len) memcpy(tx_buffer + sizeof(header), payload, len);
+    size_t signed_len = sizeof(header) + len;
+    tag(tx_buffer, signed_len, tx_buffer + signed_len);
+
+    sockaddr_in to = {};
+    to.sin_family = AF_INET;
+    to.sin_port = htons(port);
+    to.sin_addr.s_addr = address;
+    int sent = sendto(fd_, tx_buffer, signed_len + FLEET_TAG_SIZE, 0, (sockaddr*)&to, sizeof(to));
+    return sent < 0 ? 0 : header.seq;
+}
+
+// --- CONFIGURATION PAYLOAD ---
+
+// Bytes of one field, as stored in NVS
+static size_t fieldBytes(const AlarmData& config, uint8_t field, const void** data, uint8_t* scratch) {
+    switch (field) {
+        case CONFIG_FIELD_VOLUME:
+            *scratch = config.volume;
+            *data = scratch;
+            return 1;
+        case CONFIG_FIELD_PERIODS:
+            *data = config.periods;
+            return config.num_periods * sizeof(Period);
+        case CONFIG_FIELD_SELFTEST:
+            *data = &config.selftest_seconds;
+            return sizeof(config.selftest_seconds);
+        case CONFIG_FIELD_ZONES:
+            *data = config.zones;
+            return sizeof(config.zones);
+        case CONFIG_FIELD_PLAYLISTS:
+            *data = config.playlists;
+            return sizeof(config.playlists);
+        default:
+            return 0;
+    }
+}
+
+size_t fleetEncodeConfig(const AlarmData& config, uint8_t fields, uint8_t* out, size_t len) {
+    fields &= CONFIG_FIELD_ALL;
+    if (len < 1) return 0;
+    out[0] = fields;
+    size_t pos = 1;
+    for (int bit = 0; bit < CONFIG_FIELD_COUNT; bit++) {
+        uint8_t field = 1 << bit;
+        if (!(fields & field)) continue;
+        const void* data;
+        uint8_t scratch;
+        uint16_t field_len = fieldBytes(config, field, &data, &scratch);
+        if (pos + sizeof(field_len) + field_len > len) return 0;
+        memcpy(out + pos, &field_len, sizeof(field_len));
+        memcpy(out + pos + sizeof(field_len), data, field_len);
+        pos += sizeof(field_len) + field_len;
+    }
+    return pos;
+}
+
+uint8_t fleetDecodeConfig(const uint8_t* data, size_t len, AlarmData& config) {
+    static AlarmData decoded; // Only copied to config once the whole payload checks out
+    if (len < 1) return 0;
+    decoded = config;
+    uint8_t fields = data[0];
+    uint8_t applied = 0;
+    size_t pos = 1;
+
+    for (int bit = 0; bit < 8; bit++) {
+        uint8_t field = 1 << bit;
+        if (!(fields & field)) continue;
+        uint16_t field_len;
+        if (pos + sizeof(field_len) > len) return 0;
+        memcpy(&field_len, data + pos, sizeof(field_len));
+        pos += sizeof(field_len);
+        if (pos + field_len > len) return 0;
+        const uint8_t* bytes = data + pos;
+        pos += field_len;
+
+        switch (field) {
+            case CONFIG_FIELD_VOLUME:
+                if (field_len != 1) return 0;
+                decoded.volume = bytes[0];
+                break;
+            case CONFIG_FIELD_PERIODS:
+                if (field_len % sizeof(Period) != 0 || field_len / sizeof(Period) > (size_t)MAX_PERIODS) return 0;
+                decoded.num_periods = field_len / sizeof(Period);
+                memcpy(decoded.periods, bytes, field_len);
+                break;
+            case CONFIG_FIELD_SELFTEST:
+                if (field_len != 1) return 0;
+                decoded.selftest_seconds = bytes[0];
+                break;
+            case CONFIG_FIELD_ZONES:
+                // Sent by a board with a different number of zones: the common ones are taken
+                if (field_len % sizeof(ZoneSettings) != 0) return 0;
+                memcpy(decoded.zones, bytes, min((size_t)field_len, sizeof(decoded.zones)));
+                break;
+            case CONFIG_FIELD_PLAYLISTS:
+                if (field_len != sizeof(decoded.playlists)) return 0;
+                memcpy(decoded.playlists, bytes, field_len);
+                break;
+            default:
+                continue; // Field of newer firmware: skipped
+        }
+        applied |= field;
+    }
+    if (pos != len) return 0;
+
+    validateConfig(decoded);
+    config = decoded;
+    return applied;
+}
+
+uint32_t fleetConfigCrc(const AlarmData& config) {
+    static uint8_t payload[CONFIG_PAYLOAD_SIZE];
+    size_t len = fleetEncodeConfig(config, CONFIG_FIELD_ALL, payload, sizeof(payload));
+    return crc32(payload, len);
+}
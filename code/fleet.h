@@ -0,0 +1,182 @@
+/*
+ * Fleet protocol: discovery, status beacons and configuration push between
+ * GRAVE Controllers on a site network.
+ *
+ * When the controllers join the site's Wi-Fi as stations, they listen on a
+ * UDP multicast group. Every datagram is a small binary message:
+ *
+ *   FleetHeader | target unit IDs (uint32 each) | payload | tag
+ *
+ * The target list selects the units that act on the message (none = every
+ * unit), so one datagram reaches the whole site or any subset of it. The tag
+ * is a truncated HMAC-SHA256 of everything before it, keyed with the site's
+ * fleet key; datagrams without a valid tag are dropped. All fields are
+ * little-endian. tools/fleet.py is the management side.
+ *
+ * Each sender numbers its datagrams, and a unit drops any datagram whose
+ * sequence number is not newer than the last one it accepted from that
+ * sender, so a recorded datagram cannot be played back. The units carry
+ * their counter across reboots: each boot starts a new block of
+ * FLEET_SEQ_BLOCK numbers, counted in NVS. The management tool numbers its
+ * datagrams from its clock.
+ *
+ * Configuration fields travel in the same layout as in NVS (see
+ * ConfigStore), each prefixed with its length, so a push carries any
+ * combination of fields and the whole configuration fits in one datagram.
+ *
+ * The same link carries the clock exchanges between the units and their
+ * time leader (see time_sync.h), unicast to the leader.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include "alarm_config.h"
+
+#define FLEET_PORT 4210
+#define FLEET_GROUP_ADDRESS 0xEF475256 // 239.71.82.86 ("GRV")
+#define FLEET_MAGIC 0x4647   // "GF"
+#define FLEET_VERSION 1
+#define FLEET_TAG_SIZE 16
+#define FLEET_MAX_TARGETS 64
+#define FLEET_DATAGRAM_SIZE 1472 // One Ethernet frame, no IP fragmentation
+#define FLEET_BEACON_MS 30000    // Status beacon interval (also sent on changes)
+#define FLEET_MAX_SENDERS 96     // Senders whose last sequence number is kept
+#define FLEET_SEQ_BLOCK 0x1000000 // Sequence numbers per boot
+
+enum FleetMessageType : uint8_t {
+  FLEET_DISCOVER = 1, // Every addressed unit answers with FLEET_STATUS
+  FLEET_STATUS = 2,   // FleetStatus: reply to DISCOVER, and multicast beacon
+  FLEET_CONFIG = 3,   // Configuration fields (see fleetEncodeConfig); acknowledged
+  FLEET_TIME = 4,     // FleetTime (UTC); acknowledged
+  FLEET_CLONE = 5,    // uint8 field mask: the addressed unit pushes those fields to every other unit
+  FLEET_ACK = 6,      // FleetAck, sent to the sender of a CONFIG, TIME or CLONE
+  FLEET_SYNC_REQUEST = 7, // FleetSync with t1: the addressed unit answers with its clock
+  FLEET_SYNC_REPLY = 8    // FleetSync with t1 echoed, t2 and t3 (see time_sync.h)
+};
+
+struct FleetHeader {
+  uint16_t magic;   // FLEET_MAGIC
+  uint8_t version;  // FLEET_VERSION
+  uint8_t type;     // FleetMessageType
+  uint32_t sender;  // Unit ID of the sender (0 for the management tool)
+  uint32_t seq;     // Sender's message counter, echoed in FleetAck
+  uint16_t length;  // Payload bytes
+  uint8_t targets;  // Unit IDs between the header and the payload
+  uint8_t reserved;
+} __attribute__((packed));
+
+// FleetStatus::flags
+#define FLEET_STATUS_SELFTEST 0x01     // Self-test running
+#define FLEET_STATUS_CLOCK_SYNCED 0x02 // Clock set by NTP or the fleet since boot
+#define FLEET_STATUS_UNSAVED 0x04      // Configuration changes not yet written to NVS
+#define FLEET_STATUS_NTP 0x08          // Clock from NTP: preferred as time leader
+#define FLEET_STATUS_LEADER 0x10       // Serves the fleet's time
+#define FLEET_STATUS_LOCKED 0x20       // Clock locked to the leader's
+
+struct FleetStatus {
+  uint32_t config_crc; // fleetConfigCrc() of the configuration in use
+  uint32_t clock;      // Local time, seconds since 2000-01-01 (see SoftClock)
+  uint32_t uptime_s;
+  uint16_t num_periods;
+  uint8_t zones_active;
+  uint8_t volume;
+  uint8_t flags;       // FLEET_STATUS_*
+} __attribute__((packed));
+
+struct FleetTime {
+  uint32_t unix_seconds; // UTC
+  uint32_t micros;       // Within the second
+} __attribute__((packed));
+
+// Clock times, microseconds since 2000-01-01 local time (see SoftClock)
+struct FleetSync {
+  int64_t t1; // Request sent (requester's clock)
+  int64_t t2; // Request received (answering unit's clock)
+  int64_t t3; // Reply sent (answering unit's clock)
+} __attribute__((packed));
+
+// FleetAck::result
+#define FLEET_OK 0
+#define FLEET_ERROR_MALFORMED 1
+#define FLEET_ERROR_BUSY 2
+
+struct FleetAck {
+  uint32_t seq;        // Of the message acknowledged
+  uint8_t type;        // Of the message acknowledged
+  uint8_t result;      // FLEET_OK or FLEET_ERROR_*
+  uint32_t config_crc; // After applying it
+} __attribute__((packed));
+
+// A verified datagram addressed to this unit
+struct FleetMessage {
+  const FleetHeader* header;
+  const uint8_t* payload;
+  size_t length;
+  uint32_t from_address; // Network byte order
+  uint16_t from_port;    // Host byte order
+};
+
+typedef void (*FleetHandler)(const FleetMessage& message);
+
+class FleetLink {
+public:
+    // Joins the group on the station interface (IPv4 address in network
+    // byte order). The key is kept by reference and must stay valid.
+    bool begin(uint32_t unit_id, const char* key, uint32_t interface_address);
+    void end();
+    bool isOpen() const { return fd_ >= 0; }
+    int fd() const { return fd_; } // -1 while closed
+    uint32_t interfaceAddress() const { return interface_address_; }
+
+    // Passes each verified datagram addressed to this unit to the handler;
+    // never blocks
+    void poll(FleetHandler handler);
+
+    // Sends a message to the group, or to one address (network byte order).
+    // Returns its sequence number, 0 if it could not be sent.
+    uint32_t send(uint8_t type, const void* payload, size_t len);
+    uint32_t sendTo(uint32_t address, uint16_t port, uint8_t type, const void* payload, size_t len);
+    uint32_t reply(const FleetMessage& to, uint8_t type, const void* payload, size_t len) {
+        return sendTo(to.from_address, to.from_port, type, payload, len);
+    }
+
+    uint32_t unitId() const { return unit_id_; }
+    uint32_t received() const { return received_; }
+    uint32_t rejected() const { return rejected_; }
+
+private:
+    struct Sender {
+      uint32_t id;
+      uint32_t last_seq; // Newest accepted
+      uint32_t heard_ms; // The slot of the least recently heard sender is reused
+    };
+
+    void tag(const uint8_t* data, size_t len, uint8_t* out) const;
+    bool isNewer(uint32_t sender, uint32_t seq);
+
+    int fd_ = -1;
+    uint32_t unit_id_ = 0;
+    const char* key_ = "";
+    uint32_t interface_address_ = 0;
+    uint32_t seq_ = 0;
+    bool seq_started_ = false;
+    Sender senders_[FLEET_MAX_SENDERS] = {};
+    int num_senders_ = 0;
+    uint32_t received_ = 0;
+    uint32_t rejected_ = 0;
+    uint8_t buffer_[FLEET_DATAGRAM_SIZE];
+};
+
+// Writes the selected configuration fields (CONFIG_FIELD_*) as a
+// FLEET_CONFIG payload: the field mask, then each field in bit order as a
+// uint16 length and its bytes. Returns the payload length (0 if too large).
+size_t fleetEncodeConfig(const AlarmData& config, uint8_t fields, uint8_t* out, size_t len);
+
+// Reads a FLEET_CONFIG payload into config, which should hold the current
+// configuration: fields that are absent keep their value. The result is
+// validated as if loaded from NVS. Returns the fields read, 0 if malformed.
+uint8_t fleetDecodeConfig(const uint8_t* data, size_t len, AlarmData& config);
+
+// CRC-32 of the whole encoded configuration, to tell units with the same
+// configuration apart from the others
+uint32_t fleetConfigCrc(const AlarmData& config);
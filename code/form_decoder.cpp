@@ -0,0 +1,60 @@
+/*
+ * Single-pass decoder for the web forms.
+ */
+#include "form_decoder.h"
+
+// FNV-1a
+static uint32_t hashName(const char* name) {
+    uint32_t hash = 2166136261UL;
+    while (*name) hash = (hash ^ (uint8_t)*name++) * 16777619UL;
+    return hash;
+}
+
+FormIndex::FormIndex(const FormKey* keys, uint8_t num_keys)
+    : keys_(keys), num_keys_(min<uint8_t>(num_keys, FORM_MAX_KEYS)) {}
+
+void FormIndex::build() {
+    for (int id = 0; id < num_keys_; id++) {
+        uint32_t slot = hashName(keys_[id].name) & (FORM_INDEX_SIZE - 1);
+        while (slots_[slot]) slot = (slot + 1) & (FORM_INDEX_SIZE - 1);
+        slots_[slot] = id + 1;
+    }
+    built_ = true;
+}
+
+int FormIndex::find(const char* name) {
+    if (!built_) build();
+    for (uint32_t slot = hashName(name) & (FORM_INDEX_SIZE - 1); slots_[slot];
+         slot = (slot + 1) & (FORM_INDEX_SIZE - 1)) {
+        int id = slots_[slot] - 1;
+        if (strcmp(keys_[id].name, name) == 0) return id;
+    }
+    return -1;
+}
+
+FormDecoder::FormDecoder(FormIndex& index) : index_(index) {
+    for (int id = 0; id < index_.size(); id++) values_[id] = constrain(0L, index_.key(id).min, index_.key(id).max);
+}
+
+// Leading sign and digits, like String::toInt(); anything else ends the number
+static long parseInteger(const char* text) {
+    bool negative = *text == '-';
+    if (*text == '-' || *text == '+') text++;
+    long value = 0;
+    while (*text >= '0' && *text <= '9') {
+        if (value < 100000000L) value = value * 10 + (*text - '0'); // Saturates well before overflow
+        text++;
+    }
+    return negative ? -value : value;
+}
+
+void FormDecoder::decode(const HttpRequest& request) {
+    for (int i = 0; i < request.args(); i++) {
+        int id = index_.find(request.argName(i));
+        if (id < 0 || has(id)) continue; // Unknown, or repeated: the first one counts
+        if (request.argValue(i)[0] == '\0') continue;
+        present_ |= 1UL << id;
+        const FormKey& key = index_.key(id);
+        values_[id] = constrain(parseInteger(request.argValue(i)), key.min, key.max);
+    }
+}
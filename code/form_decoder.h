@@ -0,0 +1,63 @@
+/*
+ * Single-pass decoder for the web forms.
+ *
+ * A handler describes the fields it reads in a FormKey table, whose index
+ * is the field's ID. A FormIndex next to the table hashes its names into a
+ * small open-addressed index the first time it is used; decode() walks the
+ * request's arguments once, finds each name's ID with one hash and one
+ * comparison, and parses integers in place, clamped to the field's bounds.
+ * The handler then reads fields by ID. No allocation, and the cost is
+ * linear in the number of arguments.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include "http_server.h"
+
+#define FORM_MAX_KEYS 24   // Fields per form (bits of present_)
+#define FORM_INDEX_SIZE 64 // Hash slots (power of two, well above FORM_MAX_KEYS)
+
+struct FormKey {
+  const char* name;
+  long min;
+  long max;
+};
+
+// Name index of one FormKey table, built on the first lookup. Declared once
+// per table, next to it; used by the network task only.
+class FormIndex {
+public:
+    FormIndex(const FormKey* keys, uint8_t num_keys);
+
+    uint8_t size() const { return num_keys_; }
+    const FormKey& key(uint8_t id) const { return keys_[id]; }
+
+    // Field ID of name, -1 if the table has none
+    int find(const char* name);
+
+private:
+    void build();
+
+    const FormKey* keys_;
+    uint8_t num_keys_;
+    bool built_ = false;
+    uint8_t slots_[FORM_INDEX_SIZE] = {}; // Field ID + 1 by name hash, 0 = free
+};
+
+class FormDecoder {
+public:
+    explicit FormDecoder(FormIndex& index);
+
+    void decode(const HttpRequest& request);
+
+    // A field left empty in the form counts as absent
+    bool has(uint8_t id) const { return present_ & (1UL << id); }
+    // Clamped value; a missing field reads as 0 (clamped)
+    long get(uint8_t id) const { return values_[id]; }
+    long get(uint8_t id, long fallback) const { return has(id) ? values_[id] : fallback; }
+
+private:
+    FormIndex& index_;
+    uint32_t present_ = 0;
+    long values_[FORM_MAX_KEYS];
+};
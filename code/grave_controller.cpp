@@ -4,10 +4,12 @@
  * Author: Mauricio Martins
  * License: MIT
  *
- * This code sets up an amplifier activation controller (Output Pin 7) and
- * an MP3 player (YX5300) based on time periods defined via RTC.
+ * This code sets up an amplifier activation controller (one relay output
+ * per zone) and an MP3 player (YX5300) based on time periods defined via RTC.
  * The configuration of periods and MP3 volume is managed through a
- * simple Web Server in Access Point (AP) mode.
+ * simple Web Server in Access Point (AP) mode. Optionally, the controllers
+ * of a site also join its Wi-Fi network, where they keep their clock by NTP
+ * and can be discovered and configured together (see fleet.h).
  */
 
 #include <Arduino.h> 
@@ -15,25 +17,45 @@
 #include "Unit_RTC.h" 
 #include <M5AtomS3.h> 
 #include <WiFi.h>
-#include <WebServer.h>
-#include <EEPROM.h> 
+#include <esp_sntp.h>
+#include <time.h>
+#include <esp_timer.h>
+#include "html_stream.h"
+#include "http_server.h"
+#include "form_decoder.h"
+#include "json_writer.h"
+#include "pages.h"
+#include "metrics.h"
+#include "trace.h"
+#include "bench.h"
+#include "ui_assets.h"
+#include "shared_state.h"
+#include "alarm_config.h"
+#include "schedule.h"
+#include "soft_clock.h"
+#include "config_store.h"
+#include "config_codec.h"
+#include "board.h"
+#include "fleet.h"
+#include "time_sync.h"
+#include "power.h"
+#include "ota.h"
+#include "history.h"
+#include "supervisor.h"
 
-// --- MP3 PLAYER LIBRARY ---
-#include <YX5300_ESP32.h>
+// --- MP3 PLAYER DRIVER ---
+#include "mp3_queue.h"
 // --------------------------
 
-// --- PINOUT CONFIGURATIONS FOR ATOMS3 ---
-const int I2C_SDA_PIN = 38; 
-const int I2C_SCL_PIN = 39; 
-const int OUTPUT_PIN = 7; // Pin to be activated by the alarm (Amplifier/Relay)
+// --- HARDWARE ---
+// Pins, relay polarity and the MP3 UART come from the board profile (board.h)
+Board::Zones zoneOutputs; // One relay (or relay group) per zone (scheduler task only)
 // ----------------------------------------
 
 // --- MP3 PLAYER (YX5300) CONFIGURATION ---
-// *Ensure RX on MP3 goes to TX (6) on ESP32, and TX on MP3 goes to RX (5) on ESP32
-#define MP3_RX_PIN 5 // Connected to the MP3 module's TX
-#define MP3_TX_PIN 6 // Connected to the MP3 module's RX
-// Track 1 is used for the file 'grave.mp3', assuming it's the first file in the root of the SD card.
-const uint8_t GRAVE_MP3_TRACK_NUM = 1; 
+// *Ensure RX on MP3 goes to TX on ESP32, and TX on MP3 goes to RX on ESP32
+// Each zone has its own track (default 1: 'grave.mp3', assuming it's the
+// first file in the root of the SD card) and, optionally, its own volume.
 // ------------------------------------------
 
 // --- ACCESS POINT CREDENTIALS (Fixed IP) ---
@@ -44,79 +66,185 @@ const IPAddress AP_GATEWAY(192, 168, 4, 1);
 const IPAddress AP_SUBNET(255, 255, 255, 0);
 // --------------------------------------------------
 
-// --- PERSISTENCE CONFIGURATIONS (EEPROM) ---
-#define EEPROM_SIZE 512 
-const int CONFIG_ADDRESS = 0;
-#define MAX_PERIODS 3 // Keeping the limit of 3 periods
-
-// Struct to hold individual alarm periods
-struct Period {
-  int start_h = 0;
-  int start_m = 0;
-  int end_h = 0;
-  int end_m = 0;
+// --- SITE NETWORK (optional fleet mode) ---
+// With sta_ssid set, the controller also joins the site's network as a
+// station, keeps its clock by NTP and takes part in the fleet protocol. The
+// access point stays up for on-site access. Empty = access point only.
+const char* sta_ssid = "";
+const char* sta_password = "";
+const char* fleet_key = "your_fleet_key"; // Same on every unit of the site and in tools/fleet.py
+const char* ntp_server = "pool.ntp.org";
+const char* time_zone = "WET0WEST,M3.5.0/1,M10.5.0"; // POSIX TZ of the local time kept in the RTC
+#define CLOCK_SET_RTC_MS 1000        // NTP/fleet changes this large also rewrite the RTC right away
+#define FLEET_RETRY_MS 5000          // After the fleet socket could not be opened
+#define SYNC_TRACE_STEP_US 5000      // Smaller clock steps from the time leader are not logged
+#define SYNC_RESCHEDULE_US 1000      // Smaller clock steps leave the scheduler's wake-up alone
+
+FleetLink fleet; // Network task only
+#if POWER_SAVE_ENABLED
+PowerManager power;
+volatile bool ap_up = true; // Access point currently on (set by the network task)
+#endif
+uint32_t fleetUnitId = 0; // Low 32 bits of the station MAC address
+uint32_t configCrc = 0;   // fleetConfigCrc() of the published configuration
+TimeSync timeSync;        // Network task only
+// --------------------------------------------------
+
+// --- PERSISTENCE CONFIGURATIONS (NVS) ---
+ConfigStore configStore; // Used by the network task only
+
+AlarmData alarmConfig; // Edited by the web handlers (network task)
+ScheduleEngine pageSchedule; // alarmConfig compiled for the page's day timeline
+// ------------------------------------------
+
+// --- TASKS AND SHARED STATE ---
+// The scheduler task (RTC read, period evaluation, relay/LED/MP3 output) runs
+// at high priority on the application core; the web server runs on the
+// protocol core next to the Wi-Fi stack, so HTTP traffic cannot delay it.
+#define SCHEDULER_CORE APP_CPU_NUM
+#define SCHEDULER_PRIORITY 5
+#define SCHEDULER_STACK_SIZE 4096
+#define NETWORK_CORE PRO_CPU_NUM
+#define NETWORK_PRIORITY 1
+#define NETWORK_STACK_SIZE 8192
+#define NETWORK_POLL_MS 20 // Longest sleep of the network task between event/config checks
+#define MP3_CORE APP_CPU_NUM // The MP3 task only wakes for commands and module reports
+#define MP3_PRIORITY 4
+#define MP3_STACK_SIZE 3072
+#define TRACE_CORE PRO_CPU_NUM // Prints the trace on Serial (see trace.h)
+#define TRACE_PRIORITY 1
+#define TRACE_STACK_SIZE 3072
+#define SUPERVISOR_CORE PRO_CPU_NUM // Above the network task, on its core (see supervisor.h)
+#define SUPERVISOR_PRIORITY (SCHEDULER_PRIORITY + 1)
+#define SUPERVISOR_STACK_SIZE 3072
+#define SCHEDULER_STALL_MS 3000 // Longest time each task may be busy before the supervisor restarts
+#define NETWORK_STALL_MS 15000  // (the network task writes flash: OTA, NVS, history)
+#define MP3_STALL_MS 3000
+#define I2C_TIMEOUT_MS 50
+#define SCHEDULER_QUEUE_LENGTH 8
+#define SCHEDULER_QUEUE_WAIT_MS 50 // Longest /settime waits for room in schedulerQueue (others do not wait)
+
+// Status published by the scheduler task for the web handlers
+struct ControllerStatus {
+  rtc_time_type time = {};
+  rtc_date_type date = {};
+  bool alarm_active = false; // Any zone active
+  ZoneMask zones_active = 0;
+  int volume = 0; // Volume currently applied to the MP3 player
+  bool selftest_active = false;
 };
 
-// Struct to hold all alarm configuration data
-struct AlarmData {
-  int num_periods = 0; 
-  Period periods[MAX_PERIODS]; 
-  int volume = 15; // Volume level (0-30). Default: 15 (medium)
-  int signature = 0xAABBCCDD; // Signature to validate EEPROM data
+// Requests sent from the web handlers to the scheduler task
+enum SchedulerCommandType : uint8_t {
+  CMD_CONFIG_CHANGED, // A new configuration was published
+  CMD_SET_CLOCK,      // Write time/date to the RTC
+  CMD_CLOCK_ADJUSTED, // The software clock was stepped (NTP or the fleet)
+  CMD_SELF_TEST,      // Run the amplifier/MP3 self-test
+  CMD_WAKE            // From the wake-up timer: a transition or resync is due
 };
 
-AlarmData alarmConfig; 
+struct SchedulerCommand {
+  SchedulerCommandType type;
+  rtc_time_type time;
+  rtc_date_type date;
+  uint32_t micros; // CMD_SET_CLOCK: within the second
+  bool external;   // CMD_SET_CLOCK: from NTP or the fleet, disciplines the clock
+  uint8_t seconds; // Self-test duration
+};
+
+Snapshot<AlarmData> configSnapshot; // Written by the network task
+Snapshot<ControllerStatus> statusSnapshot; // Written by the scheduler task
+QueueHandle_t schedulerQueue = nullptr;
+TaskHandle_t schedulerTaskHandle = nullptr;
+TaskHandle_t networkTaskHandle = nullptr;
 // ------------------------------------------
 
-// Time control and RTC variables
-unsigned long previousMillis = 0;
-const long interval = 1000; 
+// Time control and RTC variables (owned by the scheduler task)
+// The scheduler sleeps until the next period transition, computed from the
+// software clock and timed by a microsecond esp_timer rather than the tick,
+// so units whose clocks agree also switch together. The RTC (whose
+// interrupt line is not wired on Port A) is only read to resync the
+// software clock every CLOCK_RESYNC_INTERVAL_MS. The wake-ups are planned
+// by planWake() (see schedule.h).
+SoftClock softClock; // Read by both tasks, anchored/resynced by the scheduler
+esp_timer_handle_t wakeTimer = nullptr;
 
 Unit_RTC RTC;
 rtc_time_type RTCtime;
 rtc_date_type RTCdate;
-WebServer server(80);
+HttpServer server; // Port 80, served by the network task
+
+EventHistory history; // Queued by the tasks, written by the network task
 
 // --- MP3 OBJECTS ---
-YX5300_ESP32 mp3; 
+Mp3Queue mp3; // Commands are queued; its own task talks to the module
+
+// Scheduler task state
+AlarmData activeConfig; // Scheduler's copy of the published configuration
+uint32_t activeConfigVersion = 0;
+ScheduleEngine activeSchedule; // activeConfig compiled for today and tomorrow
+ZoneMask active_zones = 0; // Zones the periods want on
+bool is_alarm_active = false; // Any of them
 
-bool is_alarm_active = false; 
-char str_buffer[128];
+// The YX5300 plays one track at a time: the lowest-numbered active zone
+// owns it, at that zone's volume, and plays the playlist of the period that
+// switched it on (or the zone's track)
+#define PLAYER_PREARM_MS 1500 // The module is woken this long before playback starts
+
+struct PlayerProgram {
+  int8_t zone = -1;     // -1 = stopped
+  int8_t playlist = -1; // Index in playlists, -1 = the zone's track
+
+  bool operator==(const PlayerProgram& o) const { return zone == o.zone && playlist == o.playlist; }
+  bool operator!=(const PlayerProgram& o) const { return !(*this == o); }
+};
+
+PlayerProgram player_program;
+int player_volume = -1;         // Volume given to the module
+bool player_fading_out = false; // Ramping down ahead of the next transition
+uint32_t player_prepared = 0;   // Transition (minute count) already pre-armed or faded out
+
+// Self-test (owned by the scheduler task): the outputs are switched on for a
+// while, without blocking, and then handed back to the periods
+#define DEFAULT_SELFTEST_SECONDS 10 // Used on demand when the boot self-test is disabled
+bool selftest_running = false;
+TickType_t selftest_end = 0;
 
 // --- STATUS LED MANAGEMENT ---
+#define LED_ACTIVE 0x00FF00   // GREEN: any zone active
+#define LED_SELFTEST 0x0000FF // BLUE: self-test
+#if POWER_SAVE_ENABLED
+#define LED_IDLE 0x000000     // Off between periods
+#else
+#define LED_IDLE 0xFF0000     // RED: inactive
+#endif
+
 // Function to set the LED color of the AtomS3
-void setLEDColor(uint32_t color) { AtomS3.dis.drawpix(color); }
+// Only redraws when the colour changes; pushed out right away, as
+// AtomS3.update() may not run again until the next transition
+void setLEDColor(uint32_t color) {
+    static uint32_t shown = 0xFFFFFFFF; // Not a colour: the first call always draws
+    if (color == shown) return;
+    shown = color;
+    AtomS3.dis.drawpix(color);
+    AtomS3.dis.show();
+}
 
 
-// --- DATA PERSISTENCE (EEPROM) ---
-void loadAlarmConfig() {
-    EEPROM.get(CONFIG_ADDRESS, alarmConfig); 
-    
-    // Check if EEPROM data is valid
-    if (alarmConfig.signature != 0xAABBCCDD) {
-        Serial.println("[EEPROM] Invalid data/First run. Using defaults.");
-        AlarmData default_config; 
-        alarmConfig = default_config;
-        saveAlarmConfig(); // Save defaults immediately
-    }
-    
-    // Ensure the loaded volume is within limits
-    alarmConfig.volume = constrain(alarmConfig.volume, 0, 30);
-    
-    Serial.printf("[EEPROM] %d periods and volume %d loaded.\n", alarmConfig.num_periods, alarmConfig.volume);
-}
+// Hands the edited configuration over to the scheduler task
+void publishAlarmConfig() {
+    configSnapshot.publish(alarmConfig);
+    pageSchedule.load(alarmConfig);
+    configCrc = fleetConfigCrc(alarmConfig);
 
-void saveAlarmConfig() {
-    EEPROM.put(CONFIG_ADDRESS, alarmConfig);
-    if (EEPROM.commit()) {
-        Serial.println("[EEPROM] Alarm configuration saved successfully.");
-    } else {
-        Serial.println("[EEPROM] ERROR saving configuration.");
-    }
+    SchedulerCommand cmd = {};
+    cmd.type = CMD_CONFIG_CHANGED;
+    xQueueSend(schedulerQueue, &cmd, 0); // A full queue already guarantees a wake-up
 }
 
 
 // --- AP Mode Setup (NTP Removed) ---
+// Used without a site network
 void setupAPMode() {
     Serial.println("\n\n--- STARTING IN EXCLUSIVE ACCESS POINT (AP) MODE ---");
     
@@ -132,393 +260,1694 @@ void setupAPMode() {
     Serial.println("ATTENTION: RTC time must be configured manually via Web.");
 }
 
+// Set by the first NTP or fleet time; read by the network task
+volatile bool clock_synced = false;
+volatile bool ntp_synced = false;      // NTP answered at least once: a time leader candidate
+volatile bool fleet_following = false; // Clock locked to another unit (set by the network task)
+volatile uint32_t clock_sets = 0;      // Counts setClockFromUtc() calls
+
+// Sets the clock to a UTC time (NTP or fleet), as local time, and
+// disciplines it to that source. Changes of CLOCK_SET_RTC_MS or more are
+// written to the RTC by the scheduler right away; smaller ones step the
+// clock here, and the RTC follows at its next resync. Returns the change,
+// in milliseconds.
+int32_t setClockFromUtc(int64_t utc_us) {
+    if (!schedulerQueue) return 0; // Still in setup
+    time_t seconds = utc_us / 1000000;
+    struct tm local;
+    localtime_r(&seconds, &local);
+
+    SchedulerCommand cmd = {};
+    cmd.type = CMD_SET_CLOCK;
+    cmd.time.Hours = local.tm_hour;
+    cmd.time.Minutes = local.tm_min;
+    cmd.time.Seconds = local.tm_sec;
+    cmd.date.Date = local.tm_mday;
+    cmd.date.Month = local.tm_mon + 1;
+    cmd.date.Year = local.tm_year + 1900;
+    cmd.micros = utc_us % 1000000;
+    cmd.external = true;
+
+    int64_t change_us = (int64_t)clockSecondsOf(cmd.time, cmd.date) * 1000000 + cmd.micros - softClock.nowMicros();
+    clock_synced = true;
+    clock_sets = clock_sets + 1;
+    if (change_us > -(int64_t)CLOCK_SET_RTC_MS * 1000 && change_us < (int64_t)CLOCK_SET_RTC_MS * 1000) {
+        softClock.step(change_us);
+        cmd.type = CMD_CLOCK_ADJUSTED;
+    }
+    xQueueSend(schedulerQueue, &cmd, 0);
+    return constrain(change_us / 1000, (int64_t)INT32_MIN, (int64_t)INT32_MAX);
+}
+
+// Runs in the SNTP client's task. While the clock follows another unit's,
+// NTP only makes this unit a better time leader candidate.
+void onNtpSync(struct timeval* tv) {
+    ntp_synced = true;
+    if (fleet_following) return;
+    int32_t change = setClockFromUtc((int64_t)tv->tv_sec * 1000000 + tv->tv_usec);
+    TRACE(TRACE_NTP_SYNC, change);
+}
+
+// --- Station + AP Mode Setup (site network) ---
+// The station connects in the background (and reconnects on its own); the
+// network task opens the fleet link whenever it is up.
+void setupStationMode() {
+    Serial.println("\n\n--- STARTING ON THE SITE NETWORK (STATION + ACCESS POINT) ---");
+
+    WiFi.disconnect(true);
+    WiFi.mode(WIFI_AP_STA);
+
+    WiFi.softAPConfig(AP_IP, AP_GATEWAY, AP_SUBNET);
+    WiFi.softAP(ap_ssid, ap_password);
+    WiFi.setAutoReconnect(true);
+    WiFi.begin(sta_ssid, sta_password);
+
+    Serial.printf("Site network: %s (connecting)\n", sta_ssid);
+    Serial.printf("SSID: %s\n", ap_ssid);
+    Serial.printf("Fixed IP: %s\n", AP_IP.toString().c_str());
+
+    // Local time kept in the RTC follows time_zone
+    sntp_set_time_sync_notification_cb(onNtpSync);
+    configTzTime(time_zone, ntp_server);
+}
+
+
+ScheduleDate scheduleDateOf(const rtc_date_type& date) {
+    ScheduleDate d;
+    d.year = date.Year;
+    d.month = constrain(date.Month, 1, 12);
+    d.day = constrain(date.Date, 1, 31);
+    return d;
+}
+
+// Playlist of a program, if it has one with tracks
+const Playlist* programPlaylist(const PlayerProgram& program) {
+    if (program.playlist < 0) return nullptr;
+    const Playlist& list = activeConfig.playlists[program.playlist];
+    return list.length ? &list : nullptr;
+}
+
+int zoneVolume(int zone) {
+    uint8_t volume = activeConfig.zones[zone].volume;
+    return volume == ZONE_VOLUME_MAIN ? activeConfig.volume : volume;
+}
+
+// What the player should do when `zones` are active at `minute` (of today,
+// or of tomorrow + MINUTES_PER_DAY)
+PlayerProgram programFor(ZoneMask zones, int minute) {
+    PlayerProgram program;
+    if (!zones) return program;
+    program.zone = __builtin_ctz(zones);
+    int period = activeSchedule.periodAt(program.zone, minute);
+    if (period >= 0) program.playlist = periodPlaylist(activeConfig.periods[period]) - 1;
+    if (!programPlaylist(program)) program.playlist = -1;
+    return program;
+}
+
+// The self-test plays the first zone's track
+PlayerProgram selfTestProgram() {
+    PlayerProgram program;
+    program.zone = 0;
+    return program;
+}
+
+// Volume the program's first track starts at (after any fade-in)
+int programStartVolume(const PlayerProgram& program) {
+    const Playlist* list = programPlaylist(program);
+    if (list && list->entries[0].volume != ZONE_VOLUME_MAIN) return list->entries[0].volume;
+    return zoneVolume(program.zone);
+}
+
+// Hands the program to the MP3 queue, which only sends what changed
+void applyPlayer(const PlayerProgram& program) {
+    if (program != player_program) player_fading_out = false;
+    player_program = program;
+    if (program.zone < 0) {
+        player_volume = activeConfig.volume;
+        mp3.stop();
+        return;
+    }
+
+    player_volume = zoneVolume(program.zone);
+    if (!player_fading_out) mp3.setVolume(player_volume);
+
+    const Playlist* list = programPlaylist(program);
+    if (!list) {
+        mp3.playLoop(activeConfig.zones[program.zone].track);
+        return;
+    }
+    Mp3Track tracks[PLAYLIST_LENGTH];
+    for (int i = 0; i < list->length; i++) {
+        const PlaylistEntry& entry = list->entries[i];
+        tracks[i].track = entry.track;
+        tracks[i].volume = entry.volume == ZONE_VOLUME_MAIN ? MP3_VOLUME_DEFAULT : entry.volume;
+    }
+    mp3.playList(tracks, list->length, list->fade_in_seconds * 1000);
+}
+
+// How long before the change at `minute` the player needs attention: the
+// pre-arm time if playback starts from silence, the fade-out time if the
+// current playlist ends
+uint32_t transitionLead(int minute) {
+    PlayerProgram next = programFor(activeSchedule.activeZones(minute), minute);
+    if (next == player_program) return 0;
+    if (player_program.zone < 0) return PLAYER_PREARM_MS;
+    const Playlist* list = programPlaylist(player_program);
+    return list ? list->fade_out_seconds * 1000UL : 0;
+}
+
+void prepareTransition(int minute) {
+    if (player_program.zone < 0) {
+        PlayerProgram next = programFor(activeSchedule.activeZones(minute), minute);
+        const Playlist* list = programPlaylist(next);
+        mp3.prepare(list && list->fade_in_seconds ? 0 : programStartVolume(next));
+    } else {
+        const Playlist* list = programPlaylist(player_program);
+        player_fading_out = true;
+        mp3.setVolume(0, list->fade_out_seconds * 1000);
+    }
+}
+
+// A pre-arm or fade-out may no longer match the schedule
+void cancelPreparedTransition() {
+    player_prepared = 0;
+    player_fading_out = false;
+}
+
+// Adds a zone change to the event history, with what the zone plays
+void recordZone(int zone, bool on, int minute) {
+    int period = on ? activeSchedule.periodAt(zone, minute) : -1;
+    history.record(on ? HISTORY_ZONE_ON : HISTORY_ZONE_OFF, softClock.nowSeconds(), zone + 1, zoneVolume(zone),
+                   activeConfig.zones[zone].track, period >= 0 ? periodPlaylist(activeConfig.periods[period]) : 0);
+}
 
 // --- ALARM LOGIC AND LED CONTROL (GREEN/RED) ---
+// One pass over the compiled schedule gives the state of every zone; only
+// the zones whose state changed are switched and logged.
 void checkAlarmState() {
+    ScopedLatency timing(metricAlarmCheck);
     int now_in_minutes = RTCtime.Hours * 60 + RTCtime.Minutes;
-    bool should_be_active = false;
-
-    // Iterate through all configured periods
-    for (int i = 0; i < alarmConfig.num_periods; i++) {
-        Period p = alarmConfig.periods[i];
-        int start_in_minutes = p.start_h * 60 + p.start_m;
-        int end_in_minutes = p.end_h * 60 + p.end_m;
-
-        // Activation logic (including overnight periods)
-        if (start_in_minutes < end_in_minutes) {
-            // Period within the same day
-            if (now_in_minutes >= start_in_minutes && now_in_minutes < end_in_minutes) {
-                should_be_active = true;
-                break; 
+
+    // Periods are compiled into one bit per minute and zone of today (see ScheduleEngine)
+    activeSchedule.update(scheduleDateOf(RTCdate));
+    ZoneMask zones = activeSchedule.activeZones(now_in_minutes);
+    ZoneMask changed = zones ^ active_zones;
+    active_zones = zones;
+    is_alarm_active = zones != 0;
+    if (changed) supervisorSaveState(zones);
+
+    if (selftest_running) {
+        // The outputs belong to the self-test; finishSelfTest() applies this state
+        applyPlayer(selfTestProgram()); // Volume or track of the test zone may have been edited
+        return;
+    }
+
+    while (changed) {
+        int zone = __builtin_ctz(changed);
+        changed &= changed - 1;
+        bool on = zones & (1 << zone);
+        zoneOutputs.setAt(zone, on); // Relay ON/OFF
+        TRACE(on ? TRACE_ZONE_ON : TRACE_ZONE_OFF, zone + 1, RTCtime.Hours, RTCtime.Minutes);
+        recordZone(zone, on, now_in_minutes);
+    }
+    applyPlayer(programFor(zones, now_in_minutes));
+
+    // Only redrawn when it changes
+    setLEDColor(is_alarm_active ? LED_ACTIVE : LED_IDLE);
+}
+
+// --- SELF-TEST (Amplifier/MP3) ---
+void startSelfTest(uint8_t seconds) {
+    TRACE(TRACE_SELFTEST_START, seconds);
+    history.record(HISTORY_SELFTEST, softClock.nowSeconds(), 0, zoneVolume(0), activeConfig.zones[0].track);
+    selftest_running = true;
+    selftest_end = xTaskGetTickCount() + pdMS_TO_TICKS(seconds * 1000UL);
+
+    zoneOutputs.set(true); // Activate every Amplifier (Relays ON)
+    applyPlayer(selfTestProgram());
+    setLEDColor(LED_SELFTEST);
+}
+
+void finishSelfTest() {
+    selftest_running = false;
+
+    // Restore the outputs required by the periods
+    int minute = RTCtime.Hours * 60 + RTCtime.Minutes;
+    for (int zone = 0; zone < MAX_ZONES; zone++) {
+        bool on = active_zones & (1 << zone);
+        zoneOutputs.setAt(zone, on);
+        if (on) recordZone(zone, true, minute); // Their periods started before the self-test ended
+    }
+    applyPlayer(programFor(active_zones, minute));
+    setLEDColor(is_alarm_active ? LED_ACTIVE : LED_IDLE);
+
+    TRACE(TRACE_SELFTEST_END);
+}
+
+// Milliseconds left in the running self-test
+uint32_t selfTestRemainingMs() {
+    int32_t ticks = (int32_t)(selftest_end - xTaskGetTickCount());
+    return ticks > 0 ? ticks * portTICK_PERIOD_MS : 0;
+}
+
+
+// --- Web Server Functions (Handlers) ---
+
+uint32_t bootId = 0; // Keeps ETags from repeating across reboots
+
+// Sends the ETag of the response about to be sent. Returns true (after
+// answering 304) if the client already has this version.
+bool sendNotModified(HttpRequest& request, const char* etag) {
+    request.sendHeader("ETag", etag);
+    request.sendHeader("Cache-Control", "no-cache");
+    const char* cached = request.header("If-None-Match");
+    if (!cached || strcmp(cached, etag) != 0) return false;
+    request.send(304, "text/plain", "");
+    return true;
+}
+
+void handleRoot(HttpRequest& request) {
+    rtc_time_type time;
+    rtc_date_type date;
+    softClock.now(time, date); // No I2C: derived from the software clock
+
+    int edit_index = -1;
+    if (request.hasArg("edit")) {
+        edit_index = request.argInt("edit");
+        if (edit_index < 0 || edit_index >= alarmConfig.num_periods) edit_index = -1;
+    }
+
+    // The page depends on the configuration, today's timeline and the edited period
+    char etag[40];
+    snprintf(etag, sizeof(etag), "\"%08lx-%lu-%lu-%d\"", (unsigned long)bootId,
+             (unsigned long)configSnapshot.version(), (unsigned long)(softClock.nowSeconds() / 86400), edit_index);
+    if (sendNotModified(request, etag)) return;
+
+    // Timeline for the page is compiled for the current date
+    pageSchedule.update(scheduleDateOf(date));
+
+    // Configuration sections: rendered once per version, then replayed
+    uint32_t version = configSnapshot.version();
+    if (!pageCache.holds(version)) {
+        RootPage sections(-1, true);
+        pageCache.fill(sections, version);
+    }
+
+    // Streamed with chunked transfer: peak RAM stays flat regardless of the number of periods
+    request.sendStream<RootPage>(200, "text/html", edit_index);
+}
+
+// Static assets: gzipped in flash; their URLs change with their content
+void handleStaticAsset(HttpRequest& request) {
+    for (const StaticAsset& asset : STATIC_ASSETS) {
+        if (strcmp(asset.url, request.path()) != 0) continue;
+        request.sendHeader("Content-Encoding", "gzip");
+        request.sendHeader("Cache-Control", "public, max-age=31536000, immutable");
+        request.sendStatic(200, asset.content_type, asset.data, asset.length);
+        return;
+    }
+}
+
+// --- JSON API ---
+// Compact versions of the page's data for monitoring. /api/status is
+// serialized into a small buffer; /api/config is streamed one period at a
+// time and carries an ETag so unchanged configurations are answered with
+// 304 and no body.
+#define API_STATUS_SIZE 512
+
+void sendJson(HttpRequest& request, const JsonWriter& json) {
+    if (!json.ok()) {
+        request.send(500, "text/plain", "Response too large");
+        return;
+    }
+    request.send(200, "application/json", json.c_str(), json.length());
+}
+
+// Next transition of pageSchedule (which must be updated for today)
+void addNextChange(JsonWriter& json, const rtc_time_type& time) {
+    int now_in_minutes = time.Hours * 60 + time.Minutes;
+    int minutes = pageSchedule.minutesToNextTransition(now_in_minutes);
+    if (minutes < 0) {
+        json.addNull("next_change");
+        return;
+    }
+    int at = (now_in_minutes + minutes) % MINUTES_PER_DAY;
+    char text[8];
+    snprintf(text, sizeof(text), "%02d:%02d", at / 60, at % 60);
+    json.beginObject("next_change");
+    json.addString("at", text);
+    json.addBool("active", !pageSchedule.isActive(now_in_minutes));
+    json.endObject();
+}
+
+void handleApiStatus(HttpRequest& request) {
+    ControllerStatus status;
+    statusSnapshot.read(status);
+    softClock.now(status.time, status.date);
+    pageSchedule.update(scheduleDateOf(status.date));
+
+    char text[16];
+    char buffer[API_STATUS_SIZE];
+    JsonWriter json(buffer, sizeof(buffer));
+    json.beginObject();
+    snprintf(text, sizeof(text), "%02d:%02d:%02d", status.time.Hours, status.time.Minutes, status.time.Seconds);
+    json.addString("time", text);
+    snprintf(text, sizeof(text), "%04d-%02d-%02d", status.date.Year, status.date.Month, status.date.Date);
+    json.addString("date", text);
+    json.addBool("alarm_active", status.alarm_active);
+    json.addNumber("zones", status.zones_active);
+    json.addBool("selftest", status.selftest_active);
+    json.addNumber("volume", status.volume);
+
+    addNextChange(json, status.time);
+
+    json.beginObject("clock");
+    json.addNumber("since_sync_s", softClock.secondsSinceSync());
+    json.addNumber("correction_ms", softClock.lastCorrectionMs());
+    json.addBool("synced", clock_synced);
+    const char* source = "rtc";
+    if (fleet_following) source = "fleet";
+    else if (softClock.isDisciplined()) source = ntp_synced ? "ntp" : "fleet";
+    json.addString("source", source);
+    json.addNumber("rate_ppb", softClock.rate());
+    json.endObject();
+    json.addNumber("config_version", configSnapshot.version());
+    if (sta_ssid[0]) {
+        json.beginObject("fleet");
+        snprintf(text, sizeof(text), "%08lx", (unsigned long)fleetUnitId);
+        json.addString("unit", text);
+        json.addBool("connected", fleet.isOpen());
+        snprintf(text, sizeof(text), "%08lx", (unsigned long)timeSync.leader(millis()));
+        json.addString("leader", text);
+        json.addBool("locked", timeSync.isLocked());
+        json.addNumber("offset_us", timeSync.lastOffsetUs());
+        json.addNumber("delay_us", timeSync.lastDelayUs());
+        json.endObject();
+    }
+#if POWER_SAVE_ENABLED
+    json.beginObject("power");
+    json.addBool("light_sleep", power.lightSleep());
+    json.addBool("access_point", ap_up);
+    json.endObject();
+#endif
+    json.endObject();
+
+    request.sendHeader("Cache-Control", "no-store");
+    sendJson(request, json);
+}
+
+void handleApiConfig(HttpRequest& request) {
+    char etag[24];
+    snprintf(etag, sizeof(etag), "\"%08lx-%lu\"", (unsigned long)bootId, (unsigned long)configSnapshot.version());
+    if (sendNotModified(request, etag)) return;
+
+    request.sendStream<ConfigJson>(200, "application/json");
+}
+
+// Prometheus text format (see metrics.h)
+void handleMetrics(HttpRequest& request) {
+    request.sendHeader("Cache-Control", "no-store");
+    request.sendStream<MetricsPage>(200, "text/plain; version=0.0.4", server);
+}
+
+// Events held in the trace rings, including those of the previous boot
+void handleTrace(HttpRequest& request) {
+    request.sendHeader("Cache-Control", "no-store");
+    request.sendStream<TracePage>(200, "text/plain; charset=utf-8");
+}
+
+// --- EVENT HISTORY (see history.h) ---
+// GET /api/history pages through the events, oldest first:
+//   ?since=<seq>       from that record on (the "next" of the previous page)
+//   ?from=YYYY-MM-DD   from the first record of that day on
+//   &limit=<n>         records per page (HISTORY_PAGE_RECORDS by default)
+// Records are read from flash a few at a time as the response goes out.
+#define HISTORY_RECORDS_PER_PIECE 3
+
+uint32_t historyConfigWrites = 0;
+
+// Network task: configuration saves are recorded, then the queue written when due
+void pollHistory() {
+    if (configStore.writeCount() != historyConfigWrites) {
+        historyConfigWrites = configStore.writeCount();
+        history.record(HISTORY_CONFIG, softClock.nowSeconds(), 0, alarmConfig.volume);
+    }
+    history.poll();
+}
+
+class HistoryJson : public PageStream {
+public:
+    HistoryJson(uint32_t start, uint32_t end) : seq_(start), end_(end) {}
+
+protected:
+    bool renderNext() override;
+
+private:
+    uint32_t seq_;
+    uint32_t end_;
+    bool started_ = false;
+    bool any_ = false;
+    bool done_ = false;
+};
+
+bool HistoryJson::renderNext() {
+    if (!started_) {
+        emitf("{\"first\":%lu,\"records\":[", (unsigned long)history.first());
+        started_ = true;
+        return true;
+    }
+    if (done_) return false;
+    if (seq_ >= end_) {
+        emitf("],\"next\":%lu}", (unsigned long)end_);
+        done_ = true;
+        return true;
+    }
+
+    for (int n = 0; n < HISTORY_RECORDS_PER_PIECE && seq_ < end_; seq_++) {
+        HistoryRecord record;
+        if (!history.read(seq_, record)) continue; // Lost to a reset while being written
+        rtc_time_type time;
+        rtc_date_type date;
+        clockToRtc(record.time, time, date);
+        emitf("%s{\"seq\":%lu,\"time\":\"%04d-%02d-%02d %02d:%02d:%02d\",\"event\":\"%s\"",
+              any_ ? "," : "", (unsigned long)record.seq, date.Year, date.Month, date.Date,
+              time.Hours, time.Minutes, time.Seconds, historyEventName(record.type));
+        if (record.zone) emitf(",\"zone\":%d,\"track\":%d", record.zone, record.track);
+        if (record.playlist) emitf(",\"playlist\":%d", record.playlist);
+        if (record.type != HISTORY_BOOT && record.type != HISTORY_CLOCK_SET) emitf(",\"volume\":%d", record.volume);
+        emit("}");
+        any_ = true;
+        n++;
+    }
+    return true;
+}
+
+void handleApiHistory(HttpRequest& request) {
+    if (!history.isAvailable()) {
+        request.send(503, "text/plain", "Event history unavailable (no data partition)");
+        return;
+    }
+
+    uint32_t start = history.first();
+    if (request.hasArg("since")) {
+        start = max(start, (uint32_t)strtoul(request.arg("since"), nullptr, 10));
+    } else if (request.hasArg("from")) {
+        rtc_time_type time = {};
+        rtc_date_type date = {};
+        int year, month, day;
+        if (sscanf(request.arg("from"), "%d-%d-%d", &year, &month, &day) != 3 ||
+            year < 2000 || month < 1 || month > 12 || day < 1 || day > 31) {
+            request.send(400, "text/plain", "from must be YYYY-MM-DD");
+            return;
+        }
+        date.Year = year;
+        date.Month = month;
+        date.Date = day;
+        start = history.seek(clockSecondsOf(time, date));
+    }
+
+    long limit = request.hasArg("limit") ? request.argInt("limit") : HISTORY_PAGE_RECORDS;
+    limit = constrain(limit, 1L, (long)HISTORY_MAX_PAGE);
+    uint32_t end = history.next();
+    if (start > end) start = end;
+    end = min(end, start + (uint32_t)limit);
+
+    request.sendHeader("Cache-Control", "no-store");
+    request.sendStream<HistoryJson>(200, "application/json", start, end);
+}
+
+// --- LIVE EVENTS (/events) ---
+// Pushes the output state when it changes, the config version when it
+// changes and the clock once a second, as Server-Sent Events.
+bool eventsResend = false; // A client joined: send the full state again
+ControllerStatus eventStatus; // State last sent
+uint32_t eventStatusVersion = 0;
+uint32_t eventConfigVersion = 0;
+uint32_t eventSecond = 0;
+
+void handleEvents(HttpRequest& request) {
+    request.beginEvents();
+    eventsResend = true;
+}
+
+void pollEvents() {
+    if (server.eventClients() == 0) return;
+
+    char data[160];
+    uint32_t config_version = configSnapshot.version();
+    bool config_changed = config_version != eventConfigVersion;
+
+    if (eventsResend || config_changed) {
+        JsonWriter json(data, sizeof(data));
+        json.beginObject();
+        json.addNumber("version", config_version);
+        json.endObject();
+        server.broadcastEvent("config", data);
+        eventConfigVersion = config_version;
+    }
+
+    // Only the fields shown on the page; the scheduler republishes every tick
+    if (eventsResend || config_changed || statusSnapshot.version() != eventStatusVersion) {
+        ControllerStatus status;
+        eventStatusVersion = statusSnapshot.read(status);
+        if (eventsResend || config_changed || status.zones_active != eventStatus.zones_active ||
+            status.selftest_active != eventStatus.selftest_active || status.volume != eventStatus.volume) {
+            softClock.now(status.time, status.date);
+            pageSchedule.update(scheduleDateOf(status.date));
+
+            JsonWriter json(data, sizeof(data));
+            json.beginObject();
+            json.addBool("alarm_active", status.alarm_active);
+            json.addNumber("zones", status.zones_active);
+            json.addBool("selftest", status.selftest_active);
+            json.addNumber("volume", status.volume);
+            addNextChange(json, status.time);
+            json.endObject();
+            server.broadcastEvent("status", data);
+            eventStatus = status;
+        }
+    }
+
+    uint32_t second = softClock.nowSeconds();
+    if (eventsResend || second != eventSecond) {
+        rtc_time_type time;
+        rtc_date_type date;
+        clockToRtc(second, time, date);
+        snprintf(data, sizeof(data), "{\"time\":\"%02d:%02d:%02d\",\"date\":\"%04d-%02d-%02d\"}",
+                 time.Hours, time.Minutes, time.Seconds, date.Year, date.Month, date.Date);
+        server.broadcastEvent("time", data);
+        eventSecond = second;
+    }
+
+    eventsResend = false;
+}
+
+// Form handlers answer fetch() submissions with 204 and the new config
+// version (the page picks up the rest over /events); plain form posts are
+// redirected back to the page.
+void sendUpdated(HttpRequest& request) {
+    const char* requested_with = request.header("X-Requested-With");
+    if (requested_with && strcmp(requested_with, "fetch") == 0) {
+        char version[12];
+        snprintf(version, sizeof(version), "%lu", (unsigned long)configSnapshot.version());
+        request.sendHeader("X-Config-Version", version);
+        request.send(204, "text/plain", "");
+        return;
+    }
+    request.sendHeader("Location", "/");
+    request.send(302, "text/plain", "");
+}
+
+// --- FLEET (site network) ---
+// The fleet link is open while the station is connected. Other units and
+// tools/fleet.py reach this unit through it (see fleet.h); it also sends a
+// status beacon to the group every FLEET_BEACON_MS and when the zones or
+// the configuration change.
+unsigned long fleetRetryAt = 0;
+unsigned long fleetBeaconAt = 0;
+uint32_t fleetStatusVersion = 0;
+ZoneMask fleetBeaconZones = 0;
+uint32_t fleetBeaconConfig = 0;
+uint32_t fleetClockSets = 0;
+
+FleetStatus fleetStatus() {
+    ControllerStatus status;
+    statusSnapshot.read(status);
+
+    FleetStatus out = {};
+    out.config_crc = configCrc;
+    out.clock = softClock.nowSeconds();
+    out.uptime_s = millis() / 1000;
+    out.num_periods = alarmConfig.num_periods;
+    out.zones_active = status.zones_active;
+    out.volume = status.volume;
+    if (status.selftest_active) out.flags |= FLEET_STATUS_SELFTEST;
+    if (clock_synced) out.flags |= FLEET_STATUS_CLOCK_SYNCED;
+    if (configStore.hasPendingChanges()) out.flags |= FLEET_STATUS_UNSAVED;
+    if (ntp_synced) out.flags |= FLEET_STATUS_NTP;
+    if (timeSync.isLeader(millis())) out.flags |= FLEET_STATUS_LEADER;
+    else if (timeSync.isLocked()) out.flags |= FLEET_STATUS_LOCKED;
+    return out;
+}
+
+void sendFleetAck(const FleetMessage& message, uint8_t result) {
+    FleetAck ack = {};
+    ack.seq = message.header->seq;
+    ack.type = message.header->type;
+    ack.result = result;
+    ack.config_crc = configCrc;
+    fleet.reply(message, FLEET_ACK, &ack, sizeof(ack));
+}
+
+// Sends fields of this unit's configuration to every other unit, in one datagram
+bool fleetPushConfig(uint8_t fields) {
+    static uint8_t payload[FLEET_DATAGRAM_SIZE - sizeof(FleetHeader) - FLEET_TAG_SIZE];
+    size_t len = fleetEncodeConfig(alarmConfig, fields, payload, sizeof(payload));
+    TRACE(TRACE_FLEET_CLONE, fields, len);
+    return len && fleet.send(FLEET_CONFIG, payload, len);
+}
+
+// Applies what a window of exchanges with the time leader found
+void applySyncCorrection(const SyncCorrection& correction) {
+    int64_t offset = correction.offset_us;
+    softClock.step(offset);
+    if (correction.rate_changed) {
+        softClock.setRate(correction.rate_ppb);
+        TRACE(TRACE_SYNC_RATE, correction.rate_ppb);
+    }
+    if (!fleet_following || offset <= -SYNC_TRACE_STEP_US || offset >= SYNC_TRACE_STEP_US) {
+        TRACE(TRACE_SYNC_STEP, timeSync.leader(millis()), constrain(offset, (int64_t)INT32_MIN, (int64_t)INT32_MAX),
+              timeSync.lastDelayUs());
+    }
+    fleet_following = true;
+    clock_synced = true;
+    if (offset <= -SYNC_RESCHEDULE_US || offset >= SYNC_RESCHEDULE_US) {
+        SchedulerCommand cmd = {};
+        cmd.type = CMD_CLOCK_ADJUSTED;
+        xQueueSend(schedulerQueue, &cmd, 0);
+    }
+}
+
+void handleFleetMessage(const FleetMessage& message) {
+    uint32_t sender = message.header->sender;
+    switch (message.header->type) {
+        case FLEET_DISCOVER: {
+            FleetStatus status = fleetStatus();
+            fleet.reply(message, FLEET_STATUS, &status, sizeof(status));
+            break;
+        }
+
+        case FLEET_CONFIG: {
+            uint32_t before = configCrc;
+            uint8_t fields = fleetDecodeConfig(message.payload, message.length, alarmConfig);
+            if (!fields) {
+                sendFleetAck(message, FLEET_ERROR_MALFORMED);
+                break;
             }
-        } else if (start_in_minutes > end_in_minutes) {
-            // Overnight period (passes midnight)
-            if (now_in_minutes >= start_in_minutes || now_in_minutes < end_in_minutes) {
-                should_be_active = true;
-                break; 
+            bool changed = fleetConfigCrc(alarmConfig) != before;
+            if (changed) {
+                configStore.markDirty(fields);
+                publishAlarmConfig();
             }
+            TRACE(TRACE_FLEET_CONFIG, fields, sender, changed);
+            sendFleetAck(message, FLEET_OK);
+            break;
         }
-    } 
-    
-    
-    if (should_be_active && !is_alarm_active) {
-        // Alarm is just ACTIVATING
-        digitalWrite(OUTPUT_PIN, LOW); // Activates output pin (Relay ON)
-        is_alarm_active = true;
-        setLEDColor(0x00FF00); // GREEN: ACTIVE
-        Serial.printf("[ALARM] ACTIVATED: %02d:%02d (GREEN LED / G7 LOW)\n", RTCtime.Hours, RTCtime.Minutes);
-        
-        // Plays the file 'grave.mp3' (track 1) in LOOP
-        Serial.println("[MP3] Playing 'grave.mp3' (Track 1) in LOOP.");
-        mp3.playTrackInLoop(GRAVE_MP3_TRACK_NUM); 
-        
-    } else if (!should_be_active && is_alarm_active) {
-        // Alarm is just DEACTIVATING
-        digitalWrite(OUTPUT_PIN, HIGH); // Deactivates output pin (Relay OFF)
-        is_alarm_active = false;
-        setLEDColor(0xFF0000); // RED: INACTIVE
-        Serial.printf("[ALARM] DEACTIVATED: %02d:%02d (RED LED / G7 HIGH)\n", RTCtime.Hours, RTCtime.Minutes);
-        
-        // Stops playback
-        Serial.println("[MP3] Stopping playback.");
-        mp3.stop();
-        
-    } else if (should_be_active) {
-        // Keeps GREEN
-        setLEDColor(0x00FF00); 
-    } else {
-        // Keeps RED (Inactive State)
-        setLEDColor(0xFF0000); 
+
+        case FLEET_TIME: {
+            FleetTime time;
+            if (message.length != sizeof(time)) {
+                sendFleetAck(message, FLEET_ERROR_MALFORMED);
+                break;
+            }
+            memcpy(&time, message.payload, sizeof(time));
+            int32_t change = setClockFromUtc((int64_t)time.unix_seconds * 1000000 + time.micros);
+            TRACE(TRACE_FLEET_TIME, sender, change);
+            sendFleetAck(message, FLEET_OK);
+            break;
+        }
+
+        case FLEET_CLONE: {
+            uint8_t fields = message.length == 1 ? message.payload[0] : CONFIG_FIELD_ALL;
+            sendFleetAck(message, fleetPushConfig(fields) ? FLEET_OK : FLEET_ERROR_BUSY);
+            break;
+        }
+
+        case FLEET_ACK: {
+            FleetAck ack;
+            if (message.length != sizeof(ack)) break;
+            memcpy(&ack, message.payload, sizeof(ack));
+            TRACE(TRACE_FLEET_ACK, sender, ack.seq, ack.result);
+            break;
+        }
+
+        case FLEET_STATUS: {
+            // Beacons (and answers to our DISCOVER) elect the time leader
+            FleetStatus status;
+            if (!sender || message.length != sizeof(status)) break;
+            memcpy(&status, message.payload, sizeof(status));
+            timeSync.heard(sender, status.flags & FLEET_STATUS_NTP, message.from_address, millis());
+            break;
+        }
+
+        case FLEET_SYNC_REQUEST: {
+            int64_t t2 = softClock.nowMicros();
+            FleetSync sync;
+            if (message.length != sizeof(sync)) break;
+            memcpy(&sync, message.payload, sizeof(sync));
+            sync.t2 = t2;
+            sync.t3 = softClock.nowMicros();
+            fleet.reply(message, FLEET_SYNC_REPLY, &sync, sizeof(sync));
+            break;
+        }
+
+        case FLEET_SYNC_REPLY: {
+            int64_t t4 = softClock.nowMicros();
+            FleetSync sync;
+            if (message.length != sizeof(sync) || sender != timeSync.leader(millis())) break;
+            memcpy(&sync, message.payload, sizeof(sync));
+            SyncCorrection correction;
+            if (timeSync.reply(sync.t1, sync.t2, sync.t3, t4, millis(), correction)) {
+                applySyncCorrection(correction);
+            }
+            break;
+        }
+
+        default:
+            break;
     }
 }
 
+// Polls the time leader, when it is another unit
+void pollTimeSync() {
+    timeSync.setNtp(ntp_synced);
+    if (clock_sets != fleetClockSets) {
+        // Set from NTP or the management tool: earlier exchanges no longer count
+        fleetClockSets = clock_sets;
+        timeSync.restart();
+    }
 
-// --- Web Server Functions (Handlers) ---
-
-void handleRoot() {
-    // HTML optimized (CSS and Structure) - Strings remain in Portuguese for UI consistency
-    String html = "<!DOCTYPE html><html><head><title>GRAVE Controller</title><meta charset='UTF-8'><meta name='viewport' content='width=device-width, initial-scale=1'><style>body { font-family: sans-serif; background: #f0f0f0; max-width: 400px; margin: 0 auto; padding: 10px; }div { background: #fff; border-radius: 5px; padding: 20px; margin-bottom: 10px; }h1 { color: #333; } p { color: #555; }form { display: grid; grid-template-columns: 1fr 1fr; gap: 10px; }label { font-weight: bold; }input[type='number'], select { width: 90%; padding: 5px; }input[type='submit'] { grid-column: 1 / -1; padding: 10px; background: #007bff; color: white; border: none; border-radius: 5px; font-size: 1em; } h3 { grid-column: 1 / -1; margin-top: 5px; margin-bottom: 5px; border-bottom: 1px solid #ccc; padding-bottom: 5px; }</style></head><body><h1>GRAVE Controller</h1>";
-    
-    
-    // Div: Current Status and AP Information
-    html += "<div><h2>Estado Atual</h2>";
-    
-    RTC.getTime(&RTCtime); 
-    RTC.getDate(&RTCdate);
-    
-    // Display current RTC time/date in Portuguese
-    sprintf(str_buffer, "<p>Hora RTC: <strong>%02d:%02d:%02d</strong> (Hora Local)</strong></p>",
-             RTCtime.Hours, RTCtime.Minutes, RTCtime.Seconds);
-    html += str_buffer;
-    sprintf(str_buffer, "<p>Data RTC: <strong>%02d/%02d/%04d</strong></p>",
-             RTCdate.Date, RTCdate.Month, RTCdate.Year);
-    html += str_buffer;
-    
-    // Display Amplifier/MP3 state in Portuguese
-    sprintf(str_buffer, "<p>AMP / MP3 Player: <strong>%s</strong> (Volume: %d)</p>",
-             is_alarm_active ? "ON / Play" : "OFF / Stop", alarmConfig.volume);
-    html += str_buffer;
-    
-    html += "</div>";
+    uint32_t now_ms = millis();
+    int64_t t1 = softClock.nowMicros();
+    if (timeSync.requestDue(now_ms, t1)) {
+        FleetSync sync = {};
+        sync.t1 = t1;
+        fleet.sendTo(timeSync.leaderAddress(), FLEET_PORT, FLEET_SYNC_REQUEST, &sync, sizeof(sync));
+    }
 
-    // --- NEW DIV: MP3 VOLUME CONTROL ---
-    html += "<div><h2>Controle de Volume do MP3</h2>";
-    html += "<p>Ajuste o volume (0-30). O volume atual é: <strong>" + String(alarmConfig.volume) + "</strong>.</p>";
-    html += "<form action='/setvolume' method='POST' style='grid-template-columns: 1fr;'>";
-    
-    html += "<label for='volume'>Nível de Volume:</label>";
-    html += "<input type='range' id='volume' name='v' min='0' max='30' value='" + String(alarmConfig.volume) + "' style='width: 95%; margin-top: 5px; margin-bottom: 15px;'>";
-    html += "<input type='submit' value='Salvar Volume' style='grid-column: 1 / -1; margin-top: 0;'>";
-    html += "</form></div>";
-    // ----------------------------------------
+    bool following = timeSync.isLocked() && !timeSync.isLeader(now_ms);
+    if (fleet_following && !following) TRACE(TRACE_SYNC_LOST);
+    fleet_following = following;
+}
 
+void pollFleet() {
+    if (!sta_ssid[0]) return;
 
-    // Div: Define Alarm (for multiple periods)
-    html += "<div><h2>Definir Períodos de Ativação</h2>";
-    
-    if (alarmConfig.num_periods == 0) {
-        html += "<p style='color:red;'>Nenhum período de alarme ativo.</p>";
-    } else {
-        html += "<p>O dispositivo será ativado durante os seguintes períodos:</p><ul>"; 
-        for (int i = 0; i < alarmConfig.num_periods; i++) {
-            Period p = alarmConfig.periods[i];
-            sprintf(str_buffer, "<li>Período %d: <strong>%02d:%02d</strong> a <strong>%02d:%02d</strong></li>", 
-                    i + 1, (int)p.start_h, (int)p.start_m, (int)p.end_h, (int)p.end_m);
-            html += str_buffer;
+    if (WiFi.status() != WL_CONNECTED) {
+        if (fleet.isOpen()) {
+            fleet.end();
+            fleet_following = false; // Holdover on the corrected rate, then the RTC
+            TRACE(TRACE_WIFI_DOWN);
         }
-        html += "</ul>";
-    
+        return;
+    }
+    uint32_t address = WiFi.localIP();
+    if (!fleet.isOpen() || fleet.interfaceAddress() != address) {
+        if (!fleet.isOpen() && (long)(millis() - fleetRetryAt) < 0) return;
+        bool open = fleet.begin(fleetUnitId, fleet_key, address);
+        TRACE(TRACE_WIFI_UP, open);
+        if (!open) {
+            fleetRetryAt = millis() + FLEET_RETRY_MS;
+            return;
+        }
+        fleetBeaconAt = millis(); // Announce right away
+        fleet.send(FLEET_DISCOVER, nullptr, 0); // and hear from the others without waiting for their beacons
+    }
 
+    fleet.poll(handleFleetMessage);
+    pollTimeSync();
+
+    bool changed = configSnapshot.version() != fleetBeaconConfig;
+    if (statusSnapshot.version() != fleetStatusVersion) {
+        ControllerStatus status;
+        fleetStatusVersion = statusSnapshot.read(status);
+        changed |= status.zones_active != fleetBeaconZones;
     }
-    
-    html += "<form action='/set' method='POST'>";
-    
-    // Loop to generate the 3 field sets (MAX_PERIODS = 3)
-    for (int i = 0; i < MAX_PERIODS; i++) {
-        Period p = (i < alarmConfig.num_periods) ? alarmConfig.periods[i] : Period();
-        
-        html += "<h3>Período " + String(i + 1) + "</h3>";
-        
-        html += "<label>Hora Início:</label><label>Minuto Início:</label>";
-        sprintf(str_buffer, "<input type='number' name='start_h_%d' min='0' max='23' value='%d'>", i, (int)p.start_h);
-        html += str_buffer;
-        sprintf(str_buffer, "<input type='number' name='start_m_%d' min='0' max='59' value='%d'>", i, (int)p.start_m);
-        html += str_buffer;
-
-        html += "<label>Hora Fim:</label><label>Minuto Fim:</label>";
-        sprintf(str_buffer, "<input type='number' name='end_h_%d' min='0' max='23' value='%d'>", i, (int)p.end_h);
-        html += str_buffer;
-        sprintf(str_buffer, "<input type='number' name='end_m_%d' min='0' max='59' value='%d'>", i, (int)p.end_m);
-        html += str_buffer;
+    if (changed || (long)(millis() - fleetBeaconAt) >= 0) {
+        FleetStatus status = fleetStatus();
+        fleet.send(FLEET_STATUS, &status, sizeof(status));
+        fleetBeaconZones = status.zones_active;
+        fleetBeaconConfig = configSnapshot.version();
+        fleetBeaconAt = millis() + FLEET_BEACON_MS;
     }
-    
-    html += "<p style='grid-column: 1 / -1; font-size: 0.85em;'>* Períodos definidos como 00:00 a 00:00 serão ignorados.</p>";
+}
 
-    html += "<input type='submit' value='Salvar Definições'>";
+// Sends this unit's configuration to the rest of the fleet
+void handleFleetPush(HttpRequest& request) {
+    if (request.method() == HTTP_POST) {
+        if (!fleet.isOpen()) {
+            request.send(409, "text/plain", "Not connected to the site network");
+            return;
+        }
+        if (!fleetPushConfig(CONFIG_FIELD_ALL)) {
+            request.send(503, "text/plain", "Configuration could not be sent");
+            return;
+        }
+        sendUpdated(request);
+    } else {
+        request.send(405, "text/plain", "Method not allowed");
+    }
+}
 
+// Fields of the period editor (/set), indexed by PeriodField
+enum PeriodField : uint8_t {
+    PF_INDEX, PF_START_H, PF_START_M, PF_END_H, PF_END_M,
+    PF_W0, PF_W1, PF_W2, PF_W3, PF_W4, PF_W5, PF_W6,
+    PF_FROM_D, PF_FROM_M, PF_TO_D, PF_TO_M, PF_EXCEPTION, PF_ZONE, PF_PLAYLIST, PF_DELETE,
+    PF_COUNT
+};
 
-    html += "</form></div>";
+const FormKey PERIOD_FORM[PF_COUNT] = {
+    { "i", -1, MAX_PERIODS },
+    { "start_h", 0, 23 }, { "start_m", 0, 59 },
+    { "end_h", 0, 23 }, { "end_m", 0, 59 },
+    { "w0", 0, 1 }, { "w1", 0, 1 }, { "w2", 0, 1 }, { "w3", 0, 1 },
+    { "w4", 0, 1 }, { "w5", 0, 1 }, { "w6", 0, 1 },
+    { "fd", 0, 31 }, { "fm", 0, 12 }, { "td", 0, 31 }, { "tm", 0, 12 },
+    { "x", 0, 255 }, { "z", 0, MAX_ZONES - 1 }, { "pl", 0, MAX_PLAYLISTS },
+    { "del", 0, 1 },
+};
+FormIndex periodFormIndex(PERIOD_FORM, PF_COUNT);
 
-    // --- NEW DIV: MANUAL RTC SYNCHRONIZATION ---
-    html += "<div><h2>Ajustar Hora Local</h2>";
-    html += "<form action='/settime' method='POST' style='grid-template-columns: 1fr 1fr 1fr; gap: 10px;'>";
-    
-    html += "<h3>Hora</h3>";
-    html += "<label>Hora</label><label>Minuto</label><label>Segundo</label>";
-    sprintf(str_buffer, "<input type='number' name='h' min='0' max='23' value='%d'>", (int)RTCtime.Hours);
-    html += str_buffer;
-    sprintf(str_buffer, "<input type='number' name='m' min='0' max='59' value='%d'>", (int)RTCtime.Minutes);
-    html += str_buffer;
-    sprintf(str_buffer, "<input type='number' name='s' min='0' max='59' value='%d'>", (int)RTCtime.Seconds);
-    html += str_buffer;
-
-    html += "<h3>Data</h3>";
-    html += "<label>Dia</label><label>Mês</label><label>Ano</label>";
-    sprintf(str_buffer, "<input type='number' name='d' min='1' max='31' value='%d'>", (int)RTCdate.Date);
-    html += str_buffer;
-    sprintf(str_buffer, "<input type='number' name='mon' min='1' max='12' value='%d'>", (int)RTCdate.Month);
-    html += str_buffer;
-    sprintf(str_buffer, "<input type='number' name='y' min='2024' max='2100' value='%d'>", (int)RTCdate.Year);
-    html += str_buffer;
-
-    html += "<input type='submit' value='Definir Hora e Data' style='margin-top: 10px;'>";
-    html += "</form></div>";
-    // ---------------------------------------------
-    
-    html += "</body></html>";
-    
-    server.send(200, "text/html", html); 
+// Reads a day/month pair from the period form; 0 when left empty or invalid
+uint16_t readMonthDay(const FormDecoder& form, uint8_t day_id, uint8_t month_id) {
+    int day = form.get(day_id);
+    int month = form.get(month_id);
+    if (day < 1 || month < 1) return 0;
+    return packMonthDay(constrain(month, 1, 12), constrain(day, 1, 31));
 }
 
-void handleSet() {
-    // Handler to process the alarm period form submission
-    if (server.method() == HTTP_POST) {
+void handleSet(HttpRequest& request) {
+    // Handler to process the period editor: creates, updates or deletes one period
+    if (request.method() == HTTP_POST) {
         
+        FormDecoder form(periodFormIndex); // Constraint checks are in PERIOD_FORM
+        form.decode(request);
+
         AlarmData newConfig = alarmConfig; // Copy current config, including volume
-        int periods_count = 0;
-
-        for (int i = 0; i < MAX_PERIODS; i++) {
-            
-            String start_h_name = "start_h_" + String(i);
-            String start_m_name = "start_m_" + String(i);
-            String end_h_name = "end_h_" + String(i);
-            String end_m_name = "end_m_" + String(i);
-            
-            int start_h = server.arg(start_h_name).toInt();
-            int start_m = server.arg(start_m_name).toInt();
-            int end_h = server.arg(end_h_name).toInt();
-            int end_m = server.arg(end_m_name).toInt();
-
-            // Constraint checks
-            start_h = constrain(start_h, 0, 23);
-            start_m = constrain(start_m, 0, 59);
-            end_h = constrain(end_h, 0, 23);
-            end_m = constrain(end_m, 0, 59);
-
-            // Only save if any time component is non-zero
-            if (start_h != 0 || start_m != 0 || end_h != 0 || end_m != 0) {
-                newConfig.periods[periods_count].start_h = start_h;
-                newConfig.periods[periods_count].start_m = start_m;
-                newConfig.periods[periods_count].end_h = end_h;
-                newConfig.periods[periods_count].end_m = end_m;
-                periods_count++;
+        int index = form.get(PF_INDEX, -1);
+        if (index >= newConfig.num_periods) index = -1;
+
+        Period p;
+        p.start = form.get(PF_START_H) * 60 + form.get(PF_START_M);
+        p.end = form.get(PF_END_H) * 60 + form.get(PF_END_M);
+        p.weekdays = 0;
+        for (int d = 0; d < 7; d++) {
+            if (form.has(PF_W0 + d)) p.weekdays |= 1 << d;
+        }
+        p.from = readMonthDay(form, PF_FROM_D, PF_FROM_M);
+        p.to = readMonthDay(form, PF_TO_D, PF_TO_M);
+        if (form.get(PF_EXCEPTION) == 1) p.flags |= PERIOD_EXCEPTION;
+        setPeriodZone(p, form.get(PF_ZONE));
+        setPeriodPlaylist(p, form.get(PF_PLAYLIST));
+
+        // 00:00 to 00:00 (except for whole-day exceptions) or no weekday deletes the period
+        bool is_empty = (p.start == p.end && !(p.flags & PERIOD_EXCEPTION)) || p.weekdays == 0;
+        bool remove = form.has(PF_DELETE) || is_empty;
+
+        if (remove) {
+            if (index >= 0) {
+                for (int i = index; i < newConfig.num_periods - 1; i++) {
+                    newConfig.periods[i] = newConfig.periods[i + 1];
+                }
+                newConfig.num_periods--;
             }
+        } else if (index >= 0) {
+            newConfig.periods[index] = p;
+        } else if (newConfig.num_periods < MAX_PERIODS) {
+            newConfig.periods[newConfig.num_periods++] = p;
+        } else {
+            request.send(409, "text/plain", "Maximum number of periods reached");
+            return;
         }
-        
-        newConfig.num_periods = periods_count;
+
+        sortPeriods(newConfig);
         alarmConfig = newConfig; 
-        saveAlarmConfig();       
+        configStore.markDirty(CONFIG_FIELD_PERIODS);
+        publishAlarmConfig();
 
-        Serial.printf("[Web Server] %d active periods defined.\n", alarmConfig.num_periods);
+        TRACE(TRACE_WEB_PERIODS, alarmConfig.num_periods);
         
-        server.sendHeader("Location", "/", true);
-        server.send(302, "text/plain", "");
+        sendUpdated(request);
     } else {
-        server.send(405, "text/plain", "Method not allowed");
+        request.send(405, "text/plain", "Method not allowed");
     }
 }
 
 // --- HANDLER TO SET VOLUME ---
-void handleSetVolume() {
-    if (server.method() == HTTP_POST) {
+const FormKey VOLUME_FORM[] = { { "v", 0, 30 } };
+FormIndex volumeFormIndex(VOLUME_FORM, 1);
+
+void handleSetVolume(HttpRequest& request) {
+    if (request.method() == HTTP_POST) {
         
-        int new_volume = server.arg("v").toInt();
-        new_volume = constrain(new_volume, 0, 30); 
+        FormDecoder form(volumeFormIndex);
+        form.decode(request);
+        int new_volume = form.get(0);
         
         if (alarmConfig.volume != new_volume) {
             alarmConfig.volume = new_volume;
-            mp3.setVolume(new_volume);
-            saveAlarmConfig(); 
-            Serial.printf("[Web Server] MP3 volume adjusted to: %d\n", new_volume);
+            configStore.markDirty(CONFIG_FIELD_VOLUME); // Saved once the slider settles
+            publishAlarmConfig(); // The scheduler task applies it to the MP3 player
+            TRACE(TRACE_WEB_VOLUME, new_volume);
+        }
+
+        sendUpdated(request);
+    } else {
+        request.send(405, "text/plain", "Method not allowed");
+    }
+}
+// ----------------------------------------
+
+// --- HANDLER TO SET A ZONE'S TRACK AND VOLUME ---
+enum ZoneField : uint8_t { ZF_ZONE, ZF_TRACK, ZF_VOLUME, ZF_COUNT };
+
+const FormKey ZONE_FORM[ZF_COUNT] = { { "z", 0, MAX_ZONES - 1 }, { "t", 1, 255 }, { "v", 0, 30 } };
+FormIndex zoneFormIndex(ZONE_FORM, ZF_COUNT);
+
+void handleSetZone(HttpRequest& request) {
+    if (request.method() == HTTP_POST) {
+        FormDecoder form(zoneFormIndex);
+        form.decode(request);
+        if (!form.has(ZF_ZONE) || !form.has(ZF_TRACK)) {
+            request.send(400, "text/plain", "Missing zone or track");
+            return;
+        }
+        ZoneSettings& zone = alarmConfig.zones[form.get(ZF_ZONE)];
+        uint8_t track = form.get(ZF_TRACK);
+        uint8_t volume = form.get(ZF_VOLUME, ZONE_VOLUME_MAIN); // Left empty: main volume
+
+        if (zone.track != track || zone.volume != volume) {
+            zone.track = track;
+            zone.volume = volume;
+            configStore.markDirty(CONFIG_FIELD_ZONES);
+            publishAlarmConfig(); // The scheduler task applies it to the MP3 player
+            TRACE(TRACE_WEB_ZONE, form.get(ZF_ZONE) + 1, track, volume);
+        }
+
+        sendUpdated(request);
+    } else {
+        request.send(405, "text/plain", "Method not allowed");
+    }
+}
+// ----------------------------------------
+
+// --- HANDLER TO SET A PLAYLIST ---
+enum PlaylistField : uint8_t { LF_INDEX, LF_FADE_IN, LF_FADE_OUT, LF_COUNT };
+
+const FormKey PLAYLIST_FORM[LF_COUNT] = {
+    { "i", 0, MAX_PLAYLISTS - 1 }, { "fi", 0, MAX_FADE_SECONDS }, { "fo", 0, MAX_FADE_SECONDS },
+};
+FormIndex playlistFormIndex(PLAYLIST_FORM, LF_COUNT);
+
+void handleSetPlaylist(HttpRequest& request) {
+    if (request.method() == HTTP_POST) {
+        FormDecoder form(playlistFormIndex);
+        form.decode(request);
+        const char* tracks = request.arg("l");
+        Playlist list;
+        if (!form.has(LF_INDEX) || !parsePlaylist(tracks ? tracks : "", list)) {
+            request.send(400, "text/plain", "Invalid playlist (track[:volume], ...)");
+            return;
         }
+        list.fade_in_seconds = form.get(LF_FADE_IN);
+        list.fade_out_seconds = form.get(LF_FADE_OUT);
 
-        server.sendHeader("Location", "/", true);
-        server.send(302, "text/plain", "");
+        Playlist& stored = alarmConfig.playlists[form.get(LF_INDEX)];
+        if (memcmp(&stored, &list, sizeof(list)) != 0) {
+            stored = list;
+            configStore.markDirty(CONFIG_FIELD_PLAYLISTS);
+            publishAlarmConfig();
+            TRACE(TRACE_WEB_PLAYLIST, form.get(LF_INDEX) + 1, list.length);
+        }
+
+        sendUpdated(request);
     } else {
-        server.send(405, "text/plain", "Method not allowed");
+        request.send(405, "text/plain", "Method not allowed");
     }
 }
 // ----------------------------------------
 
-void handleSetTime() {
+// --- SELF-TEST HANDLERS ---
+const FormKey SELFTEST_RUN_FORM[] = { { "s", 1, MAX_SELFTEST_SECONDS } };
+const FormKey SELFTEST_SET_FORM[] = { { "s", 0, MAX_SELFTEST_SECONDS } };
+FormIndex selftestRunFormIndex(SELFTEST_RUN_FORM, 1);
+FormIndex selftestSetFormIndex(SELFTEST_SET_FORM, 1);
+
+// Runs the self-test now, for "s" seconds or the configured duration
+void handleSelfTest(HttpRequest& request) {
+    if (request.method() == HTTP_POST) {
+        FormDecoder form(selftestRunFormIndex);
+        form.decode(request);
+        int seconds = alarmConfig.selftest_seconds ? alarmConfig.selftest_seconds : DEFAULT_SELFTEST_SECONDS;
+        seconds = form.get(0, seconds);
+
+        SchedulerCommand cmd = {};
+        cmd.type = CMD_SELF_TEST;
+        cmd.seconds = seconds;
+        xQueueSend(schedulerQueue, &cmd, 0);
+
+        sendUpdated(request);
+    } else {
+        request.send(405, "text/plain", "Method not allowed");
+    }
+}
+
+// Sets the duration of the boot self-test (0 skips it)
+void handleSetSelfTest(HttpRequest& request) {
+    if (request.method() == HTTP_POST) {
+        FormDecoder form(selftestSetFormIndex);
+        form.decode(request);
+        int seconds = form.get(0);
+
+        if (alarmConfig.selftest_seconds != seconds) {
+            alarmConfig.selftest_seconds = seconds;
+            configStore.markDirty(CONFIG_FIELD_SELFTEST);
+            publishAlarmConfig(); // New config version for /api/config
+            TRACE(TRACE_WEB_SELFTEST, seconds);
+        }
+
+        sendUpdated(request);
+    } else {
+        request.send(405, "text/plain", "Method not allowed");
+    }
+}
+// ----------------------------------------
+
+// Fields of the clock form (/settime), with their validation
+enum ClockField : uint8_t { CF_HOUR, CF_MINUTE, CF_SECOND, CF_DAY, CF_MONTH, CF_YEAR, CF_COUNT };
+
+const FormKey CLOCK_FORM[CF_COUNT] = {
+    { "h", 0, 23 }, { "m", 0, 59 }, { "s", 0, 59 },
+    { "d", 1, 31 }, { "mon", 1, 12 }, { "y", 2024, 2100 },
+};
+FormIndex clockFormIndex(CLOCK_FORM, CF_COUNT);
+
+void handleSetTime(HttpRequest& request) {
     // Handler to set the RTC time and date manually
-    if (server.method() == HTTP_POST) {
+    if (request.method() == HTTP_POST) {
         
-        // Get and validate Time
-        int new_h = constrain(server.arg("h").toInt(), 0, 23);
-        int new_m = constrain(server.arg("m").toInt(), 0, 59);
-        int new_s = constrain(server.arg("s").toInt(), 0, 59);
-        
-        // Get and validate Date
-        int new_d = constrain(server.arg("d").toInt(), 1, 31);
-        int new_mon = constrain(server.arg("mon").toInt(), 1, 12);
-        int new_y = constrain(server.arg("y").toInt(), 2024, 2100); 
-
-        // Set Time in RTC
-        RTCtime.Hours = new_h;
-        RTCtime.Minutes = new_m;
-        RTCtime.Seconds = new_s;
-        RTC.setTime(&RTCtime);
-        
-        // Set Date in RTC
-        RTCdate.Date = new_d;
-        RTCdate.Month = new_mon;
-        RTCdate.Year = new_y;
-        RTC.setDate(&RTCdate);
-        
-        Serial.printf("[Web Server] RTC Adjusted to: %02d/%02d/%04d %02d:%02d:%02d\n",
-                      new_d, new_mon, new_y, new_h, new_m, new_s);
+        FormDecoder form(clockFormIndex);
+        form.decode(request);
+        int new_h = form.get(CF_HOUR);
+        int new_m = form.get(CF_MINUTE);
+        int new_s = form.get(CF_SECOND);
+        int new_d = form.get(CF_DAY);
+        int new_mon = form.get(CF_MONTH);
+        int new_y = form.get(CF_YEAR);
 
-        server.sendHeader("Location", "/", true);
-        server.send(302, "text/plain", "");
+        // The RTC is written by the scheduler task, which owns the I2C bus
+        SchedulerCommand cmd = {};
+        cmd.type = CMD_SET_CLOCK;
+        cmd.time.Hours = new_h;
+        cmd.time.Minutes = new_m;
+        cmd.time.Seconds = new_s;
+        cmd.date.Date = new_d;
+        cmd.date.Month = new_mon;
+        cmd.date.Year = new_y;
+        if (xQueueSend(schedulerQueue, &cmd, pdMS_TO_TICKS(SCHEDULER_QUEUE_WAIT_MS)) != pdTRUE) {
+            request.send(503, "text/plain", "Clock could not be set, try again");
+            return;
+        }
+
+        TRACE(TRACE_WEB_DATE, new_d, new_mon, new_y);
+        TRACE(TRACE_WEB_TIME, new_h, new_m, new_s);
+
+        sendUpdated(request);
     } else {
-        server.send(405, "text/plain", "Method not allowed");
+        request.send(405, "text/plain", "Method not allowed");
+    }
+}
+
+void handleNotFound(HttpRequest& request) {
+    request.send(404, "text/plain", "404: Not found");
+}
+
+// --- CONFIG EXPORT/IMPORT (see config_codec.h) ---
+// GET /api/config/export returns the whole configuration in the compact
+// format; POST /api/config/import takes it back as the request body, on
+// this unit or another one.
+
+// The export of one config version; rewritten only when the version
+// changes, so a response still being sent from it stays intact
+uint8_t configExport[CONFIG_CODEC_MAX_SIZE];
+size_t configExportLength = 0;
+uint32_t configExportVersion = 0;
+
+uint8_t configImport[CONFIG_CODEC_MAX_SIZE];
+size_t configImportLength = 0;
+HttpRequest* configImporter = nullptr; // Connection uploading into configImport
+
+void handleConfigExport(HttpRequest& request) {
+    uint32_t version = configSnapshot.version();
+    char etag[24];
+    snprintf(etag, sizeof(etag), "\"%08lx-%lu\"", (unsigned long)bootId, (unsigned long)version);
+    if (sendNotModified(request, etag)) return;
+
+    if (configExportLength == 0 || configExportVersion != version) {
+        configExportLength = configEncode(alarmConfig, CONFIG_FIELD_ALL, configExport, sizeof(configExport));
+        configExportVersion = version;
     }
+    request.sendHeader("Content-Disposition", "attachment; filename=\"grave-config.bin\"");
+    request.sendStatic(200, "application/octet-stream", configExport, configExportLength);
 }
 
-void handleNotFound() {
-    server.send(404, "text/plain", "404: Not found");
+void handleConfigImportBody(HttpRequest& request, HttpUploadEvent event, const uint8_t* data, size_t len) {
+    switch (event) {
+        case HTTP_UPLOAD_START:
+            if (configImporter) {
+                request.send(409, "text/plain", "Another import is in progress");
+            } else if (request.contentLength() > sizeof(configImport)) {
+                request.send(413, "text/plain", "Not a configuration export");
+            } else {
+                configImporter = &request;
+                configImportLength = 0;
+            }
+            break;
+
+        case HTTP_UPLOAD_DATA:
+            memcpy(configImport + configImportLength, data, len); // Bounded by the length checked at the start
+            configImportLength += len;
+            break;
+
+        case HTTP_UPLOAD_ABORTED:
+            if (configImporter == &request) configImporter = nullptr;
+            break;
+    }
 }
 
+void handleConfigImport(HttpRequest& request) {
+    configImporter = nullptr;
+    uint32_t before = configCrc;
+    uint8_t fields = configDecode(configImport, configImportLength, alarmConfig);
+    if (!fields) {
+        request.send(400, "text/plain", "Invalid configuration file");
+        return;
+    }
+    bool changed = fleetConfigCrc(alarmConfig) != before;
+    if (changed) {
+        configStore.markDirty(fields);
+        publishAlarmConfig();
+    }
+    TRACE(TRACE_CONFIG_IMPORT, fields, configImportLength, changed);
+    sendUpdated(request);
+}
+
+// --- FIRMWARE UPDATE (see ota.h) ---
+// POST /update with the raw image as the body and its SHA-256 (hex) in
+// X-Firmware-SHA256. The scheduler keeps the outputs and the player going
+// while the image is written; the restart into it waits until every output
+// is off, unless the request has ?now=1.
+#define OTA_RESTART_DELAY_MS 1000 // Lets the answer reach the client
+
+OtaUpdate otaUpdate; // Network task only
+bool otaRestartPending = false;
+bool otaRestartNow = false;
+bool otaRestartArmed = false;
+unsigned long otaRestartAt = 0;
+volatile bool firmware_trial = false; // New image not yet confirmed (cleared by the scheduler)
+bool server_started = false;
+
+void handleUpdateBody(HttpRequest& request, HttpUploadEvent event, const uint8_t* data, size_t len) {
+    switch (event) {
+        case HTTP_UPLOAD_START: {
+            uint8_t hash[OTA_HASH_SIZE];
+            if (otaUpdate.isActive() || otaRestartPending) {
+                request.send(409, "text/plain", "Another update is in progress");
+            } else if (firmware_trial) {
+                request.send(409, "text/plain", "The running firmware is still on trial");
+            } else if (!otaParseHash(request.header("X-Firmware-SHA256"), hash)) {
+                request.send(400, "text/plain", "X-Firmware-SHA256 missing or malformed");
+            } else if (!otaUpdate.begin(request.contentLength(), hash)) {
+                request.send(400, "text/plain", otaUpdate.error());
+            } else {
+                TRACE(TRACE_OTA_START, request.contentLength());
+            }
+            break;
+        }
+
+        case HTTP_UPLOAD_DATA:
+            if (!otaUpdate.write(data, len)) {
+                TRACE(TRACE_OTA_FAILED, otaUpdate.written());
+                request.send(500, "text/plain", otaUpdate.error());
+            }
+            break;
+
+        case HTTP_UPLOAD_ABORTED:
+            TRACE(TRACE_OTA_FAILED, otaUpdate.written());
+            otaUpdate.abort();
+            break;
+    }
+}
+
+void handleUpdate(HttpRequest& request) {
+    size_t written = otaUpdate.written();
+    if (!otaUpdate.end()) {
+        TRACE(TRACE_OTA_FAILED, written);
+        request.send(400, "text/plain", otaUpdate.error());
+        return;
+    }
+    TRACE(TRACE_OTA_DONE, written);
+    otaRestartPending = true;
+    otaRestartNow = request.argInt("now") != 0;
+    request.send(200, "text/plain", otaRestartNow ? "Firmware updated, restarting"
+                                                  : "Firmware updated, restarting once the outputs are off");
+}
+
+// Restarts into a new image once nothing is playing
+void pollFirmwareUpdate() {
+    if (!otaRestartPending) return;
+    if (!otaRestartArmed) {
+        ControllerStatus status;
+        statusSnapshot.read(status);
+        if (!otaRestartNow && (status.alarm_active || status.selftest_active)) return;
+        otaRestartArmed = true;
+        otaRestartAt = millis() + OTA_RESTART_DELAY_MS;
+    }
+    if ((long)(millis() - otaRestartAt) < 0) return;
+    if (configStore.hasPendingChanges()) configStore.flush(alarmConfig);
+    history.flush();
+    esp_restart();
+}
+
+// The boot self-test is the health check of a new image: once it is over,
+// the RTC, the web server and the MP3 card must all be there (scheduler task)
+void checkFirmwareHealth() {
+    // Runs once the boot self-test is over, which lasts long enough for
+    // the MP3 module to answer the card query; no answer counts as no card
+    bool healthy = server_started && RTCdate.Month >= 1 && RTCdate.Month <= 12 &&
+                   RTCdate.Date >= 1 && RTCdate.Date <= 31 && mp3.cardKnown() && mp3.cardPresent();
+    firmware_trial = false;
+    TRACE(TRACE_OTA_HEALTH, healthy);
+    firmwareConfirm(healthy);
+}
+
+// --- SCHEDULER TASK ---
+
+// Publishes time and output state for the web handlers
+void publishStatus() {
+    ControllerStatus status;
+    status.time = RTCtime;
+    status.date = RTCdate;
+    status.alarm_active = is_alarm_active;
+    status.zones_active = active_zones;
+    status.volume = player_volume;
+    status.selftest_active = selftest_running;
+    statusSnapshot.publish(status);
+}
+
+bool rtcReadingValid(const rtc_time_type& time, const rtc_date_type& date) {
+    return time.Hours < 24 && time.Minutes < 60 && time.Seconds < 60 && date.Month >= 1 && date.Month <= 12 &&
+           date.Date >= 1 && date.Date <= 31 && date.Year >= 2000 && date.Year <= 2099;
+}
+
+// Reads the RTC (two I2C transactions). A bus left stuck by a device
+// (failed reads come back as garbage) is recovered and read again once.
+bool readRtc(rtc_time_type& time, rtc_date_type& date) {
+    for (int attempt = 0; attempt < 2; attempt++) {
+        {
+            ScopedLatency timing(metricI2c);
+            RTC.getTime(&time);
+            RTC.getDate(&date);
+        }
+        if (rtcReadingValid(time, date)) return true;
+        TRACE(TRACE_RTC_INVALID, date.Month, time.Hours);
+        if (attempt == 0) i2cRecoverBus(Wire, Board::i2c_sda, Board::i2c_scl);
+    }
+    return false;
+}
+
+// Resyncs the software clock with a plain RTC read
+void resyncClock() {
+    rtc_time_type time;
+    rtc_date_type date;
+    if (!readRtc(time, date)) {
+        softClock.skipResync();
+        return;
+    }
+
+    int32_t correction = softClock.resync(time, date);
+    if (correction == 0) return;
+    if (!softClock.isDisciplined()) {
+        TRACE(TRACE_CLOCK_RESYNC, correction);
+        return;
+    }
+
+    // The clock follows NTP or the fleet: the RTC is the one brought in line
+    // (to the second, the most it keeps)
+    softClock.now(time, date);
+    {
+        ScopedLatency timing(metricI2c);
+        RTC.setTime(&time);
+        RTC.setDate(&date);
+    }
+    TRACE(TRACE_CLOCK_RTC_SET, correction);
+}
+
+// Anchors the software clock on an RTC seconds edge (boot only, takes up to 1 s)
+void anchorClockOnEdge() {
+    rtc_time_type time;
+    rtc_date_type date;
+    if (!readRtc(time, date)) {
+        softClock.anchor(time, date); // Clamped; set the clock from the page
+        return;
+    }
+    int8_t seconds = time.Seconds;
+    unsigned long started = millis();
+    while (time.Seconds == seconds && millis() - started < 1100) {
+        delay(5);
+        RTC.getTime(&time);
+    }
+    RTC.getDate(&date);
+    softClock.anchor(time, date);
+}
+
+// System timer microseconds from now until the scheduler has to look
+// again. A transition that needs the player ahead of time (see
+// transitionLead) gets an earlier wake-up; once within that lead, the player
+// is prepared right away.
+int64_t nextWakeDelayUs() {
+    int64_t now_us = softClock.nowMicros();
+    WakeInputs inputs;
+    inputs.resync_at_us = now_us + (int64_t)softClock.msUntilResync() * 1000;
+    inputs.rate_ppb = softClock.rate();
+    inputs.lead = selftest_running ? nullptr : transitionLead;
+    inputs.prepared = player_prepared;
+    inputs.selftest_us = selftest_running ? (int64_t)selfTestRemainingMs() * 1000 : -1;
+
+    WakePlan plan = planWake(activeSchedule, now_us, inputs);
+    if (plan.prepare) {
+        prepareTransition(plan.prepare_minute);
+        player_prepared = plan.prepare;
+    }
+    return plan.timer_us;
+}
+
+// Runs in the esp_timer task
+void onWakeTimer(void* arg) {
+    SchedulerCommand cmd = {};
+    cmd.type = CMD_WAKE;
+    xQueueSend(schedulerQueue, &cmd, 0); // A full queue wakes the scheduler anyway
+}
+
+// Arms the wake-up timer for a delay in system timer time. Returns the delay.
+int64_t armWakeTimer(int64_t delay_us) {
+    esp_timer_stop(wakeTimer); // Fails harmlessly when it is not armed
+    esp_timer_start_once(wakeTimer, delay_us);
+    return delay_us;
+}
+
+// Picks up a configuration published by the network task, if any
+void refreshActiveConfig() {
+    if (configSnapshot.version() == activeConfigVersion) return;
+
+    activeConfigVersion = configSnapshot.read(activeConfig);
+    activeSchedule.load(activeConfig);
+    cancelPreparedTransition();
+    // Volume and track changes are applied by the checkAlarmState() that follows
+}
+
+void handleSchedulerCommand(const SchedulerCommand& cmd) {
+    switch (cmd.type) {
+        case CMD_CONFIG_CHANGED:
+            softClock.now(RTCtime, RTCdate);
+            refreshActiveConfig();
+            checkAlarmState(); // Apply new periods right away
+            break;
+
+        case CMD_SET_CLOCK:
+            RTCtime = cmd.time;
+            RTCdate = cmd.date;
+            RTCdate.WeekDay = weekdayOf(scheduleDateOf(cmd.date));
+            {
+                ScopedLatency timing(metricI2c);
+                RTC.setTime(&RTCtime);
+                RTC.setDate(&RTCdate);
+            }
+            softClock.anchor(RTCtime, RTCdate);
+            if (cmd.external) softClock.step(cmd.micros);
+            history.record(HISTORY_CLOCK_SET, softClock.nowSeconds());
+            cancelPreparedTransition();
+            checkAlarmState();
+            break;
+
+        case CMD_CLOCK_ADJUSTED:
+            softClock.now(RTCtime, RTCdate);
+            cancelPreparedTransition();
+            checkAlarmState();
+            break;
+
+        case CMD_SELF_TEST:
+            startSelfTest(cmd.seconds);
+            break;
+
+        case CMD_WAKE:
+            AtomS3.update(); 
+
+            // Get current time (software clock, resynced from the RTC when due) and check alarm state
+            if (softClock.msUntilResync() == 0) resyncClock();
+            softClock.now(RTCtime, RTCdate);
+            refreshActiveConfig();
+            if (selftest_running && selfTestRemainingMs() == 0) finishSelfTest();
+            checkAlarmState(); 
+            break;
+    }
+#if POWER_SAVE_ENABLED
+    power.setBusy(is_alarm_active || selftest_running); // No light sleep while the outputs are on
+#endif
+    if (firmware_trial && !selftest_running) checkFirmwareHealth();
+    publishStatus();
+}
+
+// Sleeps until the next transition or clock resync, then evaluates the
+// periods. Commands from the web handlers and the fleet wake it up early;
+// the timer is rearmed after each one.
+void schedulerTask(void* arg) {
+    traceRegisterTask();
+    unsigned long wake_at_us = micros(); // Timer deadline, for the lateness metric
+    onWakeTimer(nullptr); // First evaluation right away
+
+    for (;;) {
+        SchedulerCommand cmd;
+        supervisorWaiting();
+        xQueueReceive(schedulerQueue, &cmd, portMAX_DELAY);
+        supervisorWorking();
+        if (cmd.type == CMD_WAKE) {
+            long late_us = (long)(micros() - wake_at_us);
+            metricTickLateness.record(late_us > 0 ? late_us : 0);
+        }
+        handleSchedulerCommand(cmd);
+        wake_at_us = micros() + armWakeTimer(nextWakeDelayUs());
+    }
+}
+
+#if POWER_SAVE_ENABLED
+// --- POWER SAVING (see power.h) ---
+unsigned long apAwakeUntil = 0; // Network task only
+
+// Someone may need the access point: just booted, button pressed, outputs on, or a client on it
+bool accessPointWanted() {
+    if ((long)(millis() - apAwakeUntil) < 0) return true;
+    if (ap_up && WiFi.softAPgetStationNum() > 0) return true;
+    ControllerStatus status;
+    statusSnapshot.read(status);
+    return status.alarm_active || status.selftest_active;
+}
+
+void setAccessPoint(bool up) {
+    if (up == ap_up) return;
+    ap_up = up;
+    if (up) {
+        WiFi.mode(sta_ssid[0] ? WIFI_AP_STA : WIFI_AP);
+        WiFi.softAPConfig(AP_IP, AP_GATEWAY, AP_SUBNET);
+        WiFi.softAP(ap_ssid, ap_password);
+    } else {
+        WiFi.softAPdisconnect(true); // Radio off, or station only
+        if (sta_ssid[0]) WiFi.setSleep(true); // Modem sleep, which the access point prevents
+    }
+    TRACE(TRACE_POWER_AP, up);
+}
+
+void pollPower() {
+    if (power.buttonPressed()) apAwakeUntil = millis() + POWER_AP_AWAKE_MS;
+    setAccessPoint(accessPointWanted());
+}
+#endif
+
+// --- NETWORK TASK ---
+void networkTask(void* arg) {
+    traceRegisterTask();
+#if POWER_SAVE_ENABLED
+    apAwakeUntil = millis() + POWER_AP_AWAKE_MS;
+#endif
+    for (;;) {
+        supervisorWorking(); // Heartbeat: the loop never waits longer than a poll
+        server.wakeOn(fleet.fd());
+#if POWER_SAVE_ENABLED
+        pollPower();
+        server.poll(ap_up ? NETWORK_POLL_MS : POWER_IDLE_POLL_MS); // Longer sleeps with the radio mostly off
+#else
+        server.poll(NETWORK_POLL_MS); // Sleeps in select() until a socket is ready
+#endif
+        pollFleet(); // First, so clock exchanges are timestamped as soon as they arrive
+        configStore.poll(alarmConfig);
+        pollHistory();
+        pollEvents();
+        pollFirmwareUpdate();
+    }
+}
+
+#if BENCH_ENABLED
+// Runs at the end of setup, before the tasks start, on a synthetic
+// configuration with MAX_PERIODS periods (see bench.h)
+void runBenchmarks() {
+    static AlarmData saved;
+    saved = alarmConfig;
+    benchCore(alarmConfig);
+
+    rtc_time_type time;
+    rtc_date_type date;
+    softClock.now(time, date);
+    benchPages(server, scheduleDateOf(date));
+
+    alarmConfig = saved;
+    pageSchedule.load(alarmConfig);
+}
+#endif
+
 // --- Main Functions (Setup and Loop) ---
 
 void setup() {
     Serial.begin(115200); 
+    traceBegin();
     
     AtomS3.begin(true); 
     AtomS3.dis.setBrightness(100);
     
-    Wire.begin(I2C_SDA_PIN, I2C_SCL_PIN);
+    Wire.begin(Board::i2c_sda, Board::i2c_scl);
+    Wire.setTimeOut(I2C_TIMEOUT_MS);
     
     Serial.println("M5Atom S3 RTC Controller starting...");
     RTC.begin(); 
     
     // MP3 Player Configuration
-    mp3 = YX5300_ESP32(Serial1, MP3_RX_PIN, MP3_TX_PIN);
-    mp3.enableDebugging();
+    mp3.begin(Board::mp3Serial(), Board::mp3_rx, Board::mp3_tx, MP3_PRIORITY, MP3_CORE, MP3_STACK_SIZE);
     
-    // Define the pin as output and the initial state as INACTIVE (HIGH)
-    pinMode(OUTPUT_PIN, OUTPUT);
-    digitalWrite(OUTPUT_PIN, HIGH); 
+    // Outputs start INACTIVE (relays off)...
+    zoneOutputs.begin();
+    firmware_trial = firmwareOnTrial();
+    if (firmware_trial) Serial.println("[OTA] New firmware on trial until the boot self-test is over.");
 
-    if (!EEPROM.begin(EEPROM_SIZE)) {
-        Serial.println("FATAL ERROR: Failed to initialize EEPROM.");
-        while(true); 
+    // ...unless this is a reset while they were on: back on right away, and
+    // the scheduler takes over from there (a new image always runs the self-test)
+    ZoneMask restored_zones = 0;
+    bool restored = !firmware_trial && supervisorRestoreState(restored_zones);
+    if (restored) {
+        restored_zones &= (1 << MAX_ZONES) - 1;
+        for (int zone = 0; zone < MAX_ZONES; zone++) zoneOutputs.setAt(zone, restored_zones & (1 << zone));
+        active_zones = restored_zones;
+        is_alarm_active = restored_zones != 0;
+    }
+#if POWER_SAVE_ENABLED
+    power.begin(Board::button);
+#endif
+
+    if (!configStore.begin()) {
+        // The schedule still runs, from defaults; changes are not saved
+        Serial.println("ERROR: Failed to initialize NVS. Running without saving the configuration.");
     }
     
-    loadAlarmConfig();
+    configStore.load(alarmConfig);
     
     // NEW: Set the initial MP3 Player volume
     mp3.setVolume(alarmConfig.volume);
+    player_volume = alarmConfig.volume;
     Serial.printf("[MP3] Initial MP3 volume set to: %d\n", alarmConfig.volume);
     
-    
-    // ------------------------------------------------------------------
-    // --- INITIALIZATION TEST BLOCK (10 SECONDS) ---
-    // ------------------------------------------------------------------
-    Serial.println("\n[TEST] STARTING 10-SECOND TEST (Amplifier/MP3)...");
-    
-    // 1. Activate Amplifier (Relay ON)
-    digitalWrite(OUTPUT_PIN, LOW); 
-    
-    // 2. Play MP3 File (Track 1 - grave.mp3)
-    mp3.playTrackInLoop(GRAVE_MP3_TRACK_NUM); 
-    
-    // 3. BLUE LED to indicate TEST MODE
-    setLEDColor(0x0000FF); 
-    AtomS3.dis.show(); // FORCES the LED update before blocking delay
-    
-    // 4. Wait for 10 seconds (This is a blocking operation)
-    delay(10000); 
-    
-    // 5. Deactivate Amplifier (Relay OFF)
-    digitalWrite(OUTPUT_PIN, HIGH); 
-    
-    // 6. Stop MP3
-    mp3.stop(); 
-    
-    // 7. Clear LED (set to OFF) after the test
-    setLEDColor(0x000000); 
-    AtomS3.dis.show(); // FORCES the LED update before proceeding
-    
-    Serial.println("[TEST] 10-second test concluded. Entering Normal Operation mode.");
-    // ------------------------------------------------------------------
-
-    setupAPMode(); 
+    uint8_t mac[6];
+    WiFi.macAddress(mac);
+    fleetUnitId = (uint32_t)mac[2] << 24 | (uint32_t)mac[3] << 16 | mac[4] << 8 | mac[5];
+    timeSync.begin(fleetUnitId);
+    if (sta_ssid[0]) {
+        setupStationMode();
+    } else {
+        setupAPMode();
+    }
     
     // --- WEB SERVER ROUTES ---
     server.on("/", HTTP_GET, handleRoot);     
     server.on("/set", HTTP_POST, handleSet);   
     server.on("/settime", HTTP_POST, handleSetTime); 
     server.on("/setvolume", HTTP_POST, handleSetVolume); 
+    server.on("/setzone", HTTP_POST, handleSetZone);
+    server.on("/setplaylist", HTTP_POST, handleSetPlaylist);
+    server.on("/selftest", HTTP_POST, handleSelfTest);
+    server.on("/setselftest", HTTP_POST, handleSetSelfTest);
+    server.on("/api/status", HTTP_GET, handleApiStatus);
+    server.on("/api/config", HTTP_GET, handleApiConfig);
+    server.on("/api/config/export", HTTP_GET, handleConfigExport);
+    server.on("/api/history", HTTP_GET, handleApiHistory);
+    server.onUpload("/api/config/import", handleConfigImportBody, handleConfigImport);
+    server.on("/metrics", HTTP_GET, handleMetrics);
+    server.on("/trace", HTTP_GET, handleTrace);
+    server.on("/fleet/push", HTTP_POST, handleFleetPush);
+    server.onUpload("/update", handleUpdateBody, handleUpdate);
+    for (const StaticAsset& asset : STATIC_ASSETS) {
+        server.on(asset.url, HTTP_GET, handleStaticAsset);
+    }
     server.onNotFound(handleNotFound);        
-    server.begin();
+
+    server.on("/events", HTTP_GET, handleEvents);
+    bootId = esp_random();
+    server_started = server.begin(80);
+    if (!server_started) {
+        Serial.println("ERROR: Failed to start the Web Server.");
+    }
     
     Serial.println("Web Server started in AP Mode.");
     Serial.printf("Access http://%s\n", AP_IP.toString().c_str());
     
-    RTC.getTime(&RTCtime);
-    RTC.getDate(&RTCdate);
-    
-    // The initial alarm state check is now handled by the loop() function
-    // checkAlarmState(); 
-}
+    anchorClockOnEdge();
+    softClock.now(RTCtime, RTCdate);
+    history.begin();
+    history.record(HISTORY_BOOT, softClock.nowSeconds());
 
-void loop() {
-    server.handleClient();
-    
-    unsigned long currentMillis = millis();
+    // --- TASKS ---
+    configSnapshot.begin();
+    statusSnapshot.begin();
+    schedulerQueue = xQueueCreate(SCHEDULER_QUEUE_LENGTH, sizeof(SchedulerCommand));
+    esp_timer_create_args_t wake_timer = {};
+    wake_timer.callback = onWakeTimer;
+    wake_timer.name = "scheduler_wake";
+    esp_timer_create(&wake_timer, &wakeTimer);
 
-    if (currentMillis - previousMillis >= interval) {
-        previousMillis = currentMillis;
-        
-        AtomS3.update(); 
-        
-        // Get current time from RTC and check alarm state
-        RTC.getTime(&RTCtime);
-        RTC.getDate(&RTCdate); 
-        checkAlarmState(); 
+    // Compiles the loaded configuration and hands it to the scheduler
+    publishAlarmConfig();
+    activeConfigVersion = configSnapshot.read(activeConfig);
+    activeSchedule.load(activeConfig);
+    publishStatus();
+
+#if BENCH_ENABLED
+    runBenchmarks();
+#endif
+
+    // The self-test runs in the scheduler task, while the web server is already up.
+    // A new image on trial always runs it, for at least the default time, before its health check.
+    if ((alarmConfig.selftest_seconds > 0 || firmware_trial) && !restored) {
+        SchedulerCommand cmd = {};
+        cmd.type = CMD_SELF_TEST;
+        cmd.seconds = alarmConfig.selftest_seconds;
+        if (firmware_trial) cmd.seconds = max(cmd.seconds, (uint8_t)DEFAULT_SELFTEST_SECONDS);
+        xQueueSend(schedulerQueue, &cmd, 0);
     }
+
+    xTaskCreatePinnedToCore(schedulerTask, "scheduler", SCHEDULER_STACK_SIZE, nullptr,
+                            SCHEDULER_PRIORITY, &schedulerTaskHandle, SCHEDULER_CORE);
+    xTaskCreatePinnedToCore(networkTask, "network", NETWORK_STACK_SIZE, nullptr,
+                            NETWORK_PRIORITY, &networkTaskHandle, NETWORK_CORE);
+    metricsRegisterTask("scheduler", schedulerTaskHandle);
+    metricsRegisterTask("network", networkTaskHandle);
+    metricsRegisterTask("mp3", mp3.taskHandle());
+    supervisorWatch(schedulerTaskHandle, "scheduler", SCHEDULER_STALL_MS);
+    supervisorWatch(networkTaskHandle, "network", NETWORK_STALL_MS);
+    supervisorWatch(mp3.taskHandle(), "mp3", MP3_STALL_MS);
+    supervisorBegin(SUPERVISOR_PRIORITY, SUPERVISOR_CORE, SUPERVISOR_STACK_SIZE);
+    traceStartDrain(TRACE_PRIORITY, TRACE_CORE, TRACE_STACK_SIZE);
     
-    delay(1); 
+    // The initial alarm state check is handled by the scheduler task
+}
+
+void loop() {
+    // All work happens in the scheduler and network tasks
+    vTaskDelete(nullptr);
 }
@@ -0,0 +1,205 @@
+/*
+ * Event history in flash.
+ */
+#include "history.h"
+#include "crc32.h"
+
+#define RECORDS_PER_SECTOR ((uint32_t)(SPI_FLASH_SEC_SIZE / sizeof(HistoryRecord)))
+
+static_assert(sizeof(HistoryRecord) == 16, "Records must tile the flash sectors");
+
+static uint16_t recordCheck(const HistoryRecord& record) {
+    return (uint16_t)crc32(&record, offsetof(HistoryRecord, check));
+}
+
+const char* historyEventName(uint8_t type) {
+    switch (type) {
+        case HISTORY_BOOT: return "boot";
+        case HISTORY_ZONE_ON: return "zone_on";
+        case HISTORY_ZONE_OFF: return "zone_off";
+        case HISTORY_SELFTEST: return "selftest";
+        case HISTORY_CLOCK_SET: return "clock_set";
+        case HISTORY_CONFIG: return "config";
+        default: return "unknown";
+    }
+}
+
+bool EventHistory::begin() {
+    partition_ = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, HISTORY_PARTITION);
+    if (!partition_) {
+        partition_ = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                              HISTORY_FALLBACK_PARTITION);
+    }
+    if (!partition_ || partition_->size < 2 * SPI_FLASH_SEC_SIZE) {
+        partition_ = nullptr;
+        Serial.println("[HISTORY] No data partition: event history disabled.");
+        return false;
+    }
+    sectors_ = partition_->size / SPI_FLASH_SEC_SIZE;
+    slots_ = sectors_ * RECORDS_PER_SECTOR;
+    findEnd();
+    Serial.printf("[HISTORY] %lu events held in '%s' (room for %lu).\n",
+                  (unsigned long)(written_ - first()), partition_->label, (unsigned long)slots_);
+    return true;
+}
+
+// --- FLASH ---
+
+bool EventHistory::readSlot(uint32_t slot, HistoryRecord& out) {
+    if (esp_partition_read(partition_, slot * sizeof(HistoryRecord), &out, sizeof(out)) != ESP_OK) return false;
+    return out.seq != HISTORY_FREE && out.check == recordCheck(out);
+}
+
+bool EventHistory::isBlank(uint32_t slot) {
+    uint32_t words[sizeof(HistoryRecord) / 4];
+    if (esp_partition_read(partition_, slot * sizeof(HistoryRecord), words, sizeof(words)) != ESP_OK) return false;
+    for (uint32_t word : words) {
+        if (word != 0xFFFFFFFF) return false;
+    }
+    return true;
+}
+
+// The newest sector is the one whose first record has the highest sequence
+// number; the ring continues after its last complete record
+void EventHistory::findEnd() {
+    uint32_t newest = HISTORY_FREE;
+    uint32_t head = 0;
+    HistoryRecord record;
+    for (uint32_t s = 0; s < sectors_; s++) {
+        uint32_t slot = s * RECORDS_PER_SECTOR;
+        if (!readSlot(slot, record) || record.seq % slots_ != slot) continue;
+        if (newest == HISTORY_FREE || record.seq > newest) {
+            newest = record.seq;
+            head = s;
+        }
+    }
+    if (newest == HISTORY_FREE) {
+        written_ = 0;
+        return;
+    }
+
+    uint32_t next = newest + 1;
+    for (uint32_t i = 1; i < RECORDS_PER_SECTOR; i++) {
+        uint32_t slot = head * RECORDS_PER_SECTOR + i;
+        if (readSlot(slot, record) && record.seq == newest + i) {
+            next = newest + i + 1;
+        } else if (isBlank(slot)) {
+            break;
+        }
+    }
+    // A record cut short by a reset cannot be written again: its slot is skipped
+    while (next % RECORDS_PER_SECTOR != 0 && !isBlank(next % slots_)) next++;
+    written_ = next;
+}
+
+// --- QUEUE ---
+
+void EventHistory::record(uint8_t type, uint32_t time, uint8_t zone, uint8_t volume,
+                          uint8_t track, uint8_t playlist) {
+    if (!partition_) return;
+    HistoryRecord record = {};
+    record.time = time;
+    record.type = type;
+    record.zone = zone;
+    record.volume = volume;
+    record.track = track;
+    record.playlist = playlist;
+
+    portENTER_CRITICAL(&lock_);
+    if (queued_ < HISTORY_BATCH) {
+        if (queued_ == 0) first_queued_ms_ = millis();
+        record.seq = written_ + queued_;
+        record.check = recordCheck(record);
+        queue_[queued_++] = record;
+    } else {
+        dropped_++;
+    }
+    portEXIT_CRITICAL(&lock_);
+}
+
+void EventHistory::poll() {
+    portENTER_CRITICAL(&lock_);
+    bool due = queued_ >= HISTORY_BATCH / 2 || (queued_ && millis() - first_queued_ms_ >= HISTORY_FLUSH_MS);
+    portEXIT_CRITICAL(&lock_);
+    if (due) flush();
+}
+
+void EventHistory::flush() {
+    if (!partition_) return;
+    static HistoryRecord batch[HISTORY_BATCH];
+    portENTER_CRITICAL(&lock_);
+    uint8_t count = queued_;
+    memcpy(batch, queue_, count * sizeof(HistoryRecord));
+    portEXIT_CRITICAL(&lock_);
+    if (!count) return;
+
+    // One write per sector touched; a sector is erased when the ring enters it
+    for (uint8_t i = 0; i < count;) {
+        uint32_t slot = (written_ + i) % slots_;
+        uint32_t in_sector = slot % RECORDS_PER_SECTOR;
+        if (in_sector == 0) {
+            esp_partition_erase_range(partition_, slot * sizeof(HistoryRecord), SPI_FLASH_SEC_SIZE);
+        }
+        uint32_t run = min((uint32_t)(count - i), RECORDS_PER_SECTOR - in_sector);
+        esp_partition_write(partition_, slot * sizeof(HistoryRecord), &batch[i], run * sizeof(HistoryRecord));
+        i += run;
+    }
+
+    // Events queued during the writes move to the front
+    portENTER_CRITICAL(&lock_);
+    queued_ -= count;
+    memmove(queue_, queue_ + count, queued_ * sizeof(HistoryRecord));
+    written_ += count;
+    if (queued_) first_queued_ms_ = millis();
+    portEXIT_CRITICAL(&lock_);
+}
+
+// --- READING ---
+
+// Entering a sector drops what it held a lap ago
+uint32_t EventHistory::first() const {
+    if (written_ == 0) return 0;
+    uint32_t head = (written_ - 1) / RECORDS_PER_SECTOR; // Counted from the first sector ever written
+    return head + 1 > sectors_ ? (head + 1 - sectors_) * RECORDS_PER_SECTOR : 0;
+}
+
+uint32_t EventHistory::next() const {
+    portENTER_CRITICAL(&lock_);
+    uint32_t next = written_ + queued_;
+    portEXIT_CRITICAL(&lock_);
+    return next;
+}
+
+bool EventHistory::read(uint32_t seq, HistoryRecord& out) {
+    if (!partition_ || seq < first()) return false;
+    if (seq < written_) return readSlot(seq % slots_, out) && out.seq == seq;
+
+    portENTER_CRITICAL(&lock_);
+    bool queued = seq - written_ < queued_;
+    if (queued) out = queue_[seq - written_];
+    portEXIT_CRITICAL(&lock_);
+    return queued;
+}
+
+// Binary search for the last sector starting before `time`, then a scan of
+// it. Clock corrections can make times go back a little; the result is then
+// approximate around them.
+uint32_t EventHistory::seek(uint32_t time) {
+    uint32_t lo = first() / RECORDS_PER_SECTOR;
+    uint32_t hi = (written_ + RECORDS_PER_SECTOR - 1) / RECORDS_PER_SECTOR;
+    HistoryRecord record;
+    while (hi - lo > 1) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (read(mid * RECORDS_PER_SECTOR, record) && record.time < time) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    uint32_t end = next();
+    for (uint32_t seq = max(lo * RECORDS_PER_SECTOR, first()); seq < end; seq++) {
+        if (read(seq, record) && record.time >= time) return seq;
+    }
+    return end;
+}
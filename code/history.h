@@ -0,0 +1,103 @@
+/*
+ * Event history in flash: when each zone went on and off, with what it
+ * played, kept for months (GET /api/history).
+ *
+ * Events are fixed-size records in a data partition used as a ring of
+ * 4 KB sectors. A record's place in the partition follows from its
+ * sequence number, so any record, and any page, is found without
+ * searching; a day is found by a binary search over the first record of
+ * each sector. Writing into a new sector erases it, dropping the oldest
+ * sector's records, so every sector is erased once per lap of the ring and
+ * wear is spread evenly. At ~20 events a day, the default scheme's 1.3 MB
+ * SPIFFS partition holds over ten years.
+ *
+ * The tasks only queue events in RAM. They are written in batches, at the
+ * latest HISTORY_FLUSH_MS after the first one, so flash is written about
+ * once per transition or less, never from the scheduler. A power cut loses
+ * at most the events of that last minute.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <esp_partition.h>
+
+#define HISTORY_PARTITION "history"         // Data partition used if the partition table has one...
+#define HISTORY_FALLBACK_PARTITION "spiffs" // ...else the SPIFFS partition, unused by this firmware
+#define HISTORY_BATCH 32                    // Events queued in RAM (more are dropped until the next write)
+#define HISTORY_FLUSH_MS 60000UL            // Queued events are written after this long at most
+#define HISTORY_PAGE_RECORDS 100            // Default page of /api/history...
+#define HISTORY_MAX_PAGE 500                // ...and the largest
+
+enum HistoryEvent : uint8_t {
+  HISTORY_BOOT = 1,
+  HISTORY_ZONE_ON = 2,
+  HISTORY_ZONE_OFF = 3,
+  HISTORY_SELFTEST = 4,  // Every output on for the self-test (volume, track of zone 1)
+  HISTORY_CLOCK_SET = 5, // Recorded at the new time
+  HISTORY_CONFIG = 6     // Configuration changed (page, import or fleet)
+};
+
+// One event (16 bytes, written as is)
+struct HistoryRecord {
+  uint32_t seq;     // HISTORY_FREE: slot not written yet
+  uint32_t time;    // Seconds since 2000-01-01, local time (see SoftClock)
+  uint8_t type;     // HistoryEvent
+  uint8_t zone;     // 1-based, 0 = no zone
+  uint8_t volume;   // 0-30
+  uint8_t track;
+  uint8_t playlist; // 1-7, 0 = the zone's track
+  uint8_t reserved;
+  uint16_t check;   // Of the fields above: tells complete records from ones cut short by a reset
+};
+
+#define HISTORY_FREE 0xFFFFFFFF
+
+// Name used in /api/history
+const char* historyEventName(uint8_t type);
+
+class EventHistory {
+public:
+    // Finds the partition and the end of the ring. Without a partition,
+    // events are discarded.
+    bool begin();
+    bool isAvailable() const { return partition_ != nullptr; }
+
+    // Queues an event; any task, never touches flash
+    void record(uint8_t type, uint32_t time, uint8_t zone = 0, uint8_t volume = 0,
+                uint8_t track = 0, uint8_t playlist = 0);
+
+    // Writes the queued events once they are due; call regularly (network task)
+    void poll();
+
+    // Writes them now (before a restart)
+    void flush();
+
+    // Sequence numbers held, in flash or queued: first() to next() - 1
+    uint32_t first() const;
+    uint32_t next() const;
+    uint32_t capacity() const { return slots_; }
+    uint32_t dropped() const { return dropped_; }
+
+    // Reads a record; false if it is no longer held or was never
+    // completely written. Same task as poll().
+    bool read(uint32_t seq, HistoryRecord& out);
+
+    // First record at or after `time` (seconds as in HistoryRecord)
+    uint32_t seek(uint32_t time);
+
+private:
+    bool readSlot(uint32_t slot, HistoryRecord& out);
+    bool isBlank(uint32_t slot);
+    void findEnd();
+
+    const esp_partition_t* partition_ = nullptr;
+    uint32_t sectors_ = 0;
+    uint32_t slots_ = 0;
+
+    mutable portMUX_TYPE lock_ = portMUX_INITIALIZER_UNLOCKED; // The queue
+    HistoryRecord queue_[HISTORY_BATCH];
+    uint8_t queued_ = 0;
+    uint32_t written_ = 0; // Records in flash, and sequence number of queue_[0]
+    uint32_t dropped_ = 0;
+    unsigned long first_queued_ms_ = 0;
+};
@@ -0,0 +1,102 @@
+/*
+ * Streaming HTML renderer for the GRAVE Controller web interface.
+ */
+#include "html_stream.h"
+
+size_t PageStream::read(char* out, size_t max_len) {
+    size_t copied = 0;
+
+    while (copied < max_len) {
+        // 1. Drain the formatted text of the current piece
+        if (piece_pos_ < piece_len_) {
+            size_t n = min(piece_len_ - piece_pos_, max_len - copied);
+            memcpy(out + copied, piece_ + piece_pos_, n);
+            piece_pos_ += n;
+            copied += n;
+            continue;
+        }
+
+        // 2. Then the flash block queued with it, if any
+        if (flash_left_ > 0) {
+            size_t n = min(flash_left_, max_len - copied);
+            memcpy_P(out + copied, flash_, n);
+            flash_ += n;
+            flash_left_ -= n;
+            copied += n;
+            continue;
+        }
+
+        // 3. Current piece fully read: render the next one
+        if (finished_) break;
+        piece_len_ = 0;
+        piece_pos_ = 0;
+        if (!renderNext()) {
+            finished_ = true;
+        }
+    }
+
+    return copied;
+}
+
+void PageStream::emit(const char* text) {
+    size_t room = PAGE_PIECE_SIZE - 1 - piece_len_;
+    size_t n = min(strlen(text), room);
+    memcpy(piece_ + piece_len_, text, n);
+    piece_len_ += n;
+    piece_[piece_len_] = '\0';
+}
+
+void PageStream::emitf(const char* format, ...) {
+    size_t room = PAGE_PIECE_SIZE - piece_len_;
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(piece_ + piece_len_, room, format, args);
+    va_end(args);
+
+    if (n > 0) {
+        piece_len_ += min((size_t)n, room - 1);
+    }
+}
+
+void PageStream::emit_P(PGM_P text) {
+    flash_ = text;
+    flash_left_ = strlen_P(text);
+}
+
+// --- PAGE CACHE ---
+
+bool PageCache::fill(PageStream& stream, uint32_t key) {
+    if (readers_ > 0) return false;
+    valid_ = false;
+    length_ = 0;
+
+    size_t n;
+    while (length_ < size_ - 1 && (n = stream.read(buffer_ + length_, size_ - 1 - length_)) > 0) {
+        length_ += n;
+    }
+    char more;
+    if (length_ == size_ - 1 && stream.read(&more, 1) > 0) {
+        length_ = 0; // Too large: streams render it themselves
+        return false;
+    }
+
+    buffer_[length_] = '\0';
+    key_ = key;
+    valid_ = true;
+    return true;
+}
+
+// Streams reading the text keep it: it is only overwritten by fill()
+void PageCache::invalidate() {
+    valid_ = false;
+}
+
+const char* PageCache::acquire(uint32_t key) {
+    if (!holds(key)) return nullptr;
+    readers_++;
+    return buffer_;
+}
+
+void PageCache::release() {
+    if (readers_ > 0) readers_--;
+}
@@ -0,0 +1,78 @@
+/*
+ * Streaming HTML renderer for the GRAVE Controller web interface.
+ *
+ * A page is produced one small piece at a time instead of being built as a
+ * single Arduino String. Static blocks are read straight from flash
+ * (PROGMEM) and dynamic fragments are formatted into a fixed scratch
+ * buffer, so the RAM used by a page load does not depend on its size.
+ */
+#pragma once
+
+#include <Arduino.h>
+
+// Size of the scratch buffer used for one formatted fragment.
+#define PAGE_PIECE_SIZE 384
+
+class PageStream {
+public:
+    virtual ~PageStream() {}
+
+    // Copies up to max_len bytes of the page into out.
+    // Returns the number of bytes copied; 0 means the page is complete.
+    size_t read(char* out, size_t max_len);
+
+protected:
+    // Renders the next piece of the page with emit(), emitf() or emit_P().
+    // Called again each time the previous piece has been fully read.
+    // Returns false when there is nothing left to render.
+    virtual bool renderNext() = 0;
+
+    // Appends text to the current piece (truncated to PAGE_PIECE_SIZE).
+    void emit(const char* text);
+    void emitf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+    // Queues a flash-resident block (or a RAM one that outlives the stream,
+    // see PageCache). It is streamed without being copied to the scratch
+    // buffer and is sent after any text emitted in the same piece.
+    void emit_P(PGM_P text);
+
+private:
+    char piece_[PAGE_PIECE_SIZE];
+    size_t piece_len_ = 0;
+    size_t piece_pos_ = 0;
+    PGM_P flash_ = nullptr;
+    size_t flash_left_ = 0;
+    bool finished_ = false;
+};
+
+// Output of a stream kept in RAM, for a part of a page that changes less
+// often than it is requested. A later stream queues it with emit_P(), so
+// it is sent without being rendered again. The key says what it was
+// rendered from (a configuration version); filled and read from one task.
+class PageCache {
+public:
+    PageCache(char* buffer, size_t size) : buffer_(buffer), size_(size) {}
+
+    // Renders all of `stream` under `key`. Returns false, and holds
+    // nothing, if it does not fit; also false while a stream is reading
+    // the current text, which is then kept.
+    bool fill(PageStream& stream, uint32_t key);
+
+    bool holds(uint32_t key) const { return valid_ && key_ == key; }
+    void invalidate();
+
+    // The text for `key` (NUL-terminated), or nullptr. A stream that uses
+    // it calls release() when it is destroyed.
+    const char* acquire(uint32_t key);
+    void release();
+
+    size_t length() const { return valid_ ? length_ : 0; }
+
+private:
+    char* buffer_;
+    size_t size_;
+    size_t length_ = 0;
+    uint32_t key_ = 0;
+    bool valid_ = false;
+    int readers_ = 0;
+};
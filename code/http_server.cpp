@@ -0,0 +1,676 @@
+/*
+ * Event-driven HTTP server for the GRAVE Controller web interface.
+ */
+#include "http_server.h"
+#include <lwip/sockets.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+
+#define HTTP_LISTEN_BACKLOG 4
+#define CHUNK_HEAD_SIZE 6 // "xxxx\r\n"
+
+static const char* statusText(int code) {
+    switch (code) {
+        case 200: return "OK";
+        case 204: return "No Content";
+        case 302: return "Found";
+        case 304: return "Not Modified";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 409: return "Conflict";
+        case 413: return "Payload Too Large";
+        case 429: return "Too Many Requests";
+        case 500: return "Internal Server Error";
+        case 503: return "Service Unavailable";
+        default: return "";
+    }
+}
+
+static void setNonBlocking(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Decodes '+' and %XX in place
+static void urlDecode(char* text) {
+    char* out = text;
+    for (char* c = text; *c; c++) {
+        if (*c == '+') {
+            *out++ = ' ';
+        } else if (*c == '%' && hexValue(c[1]) >= 0 && hexValue(c[2]) >= 0) {
+            *out++ = (char)(hexValue(c[1]) << 4 | hexValue(c[2]));
+            c += 2;
+        } else {
+            *out++ = *c;
+        }
+    }
+    *out = '\0';
+}
+
+// Content-Length: digits only (trailing blanks allowed), no sign, and
+// nothing that does not fit a size_t. Returns false if malformed.
+static bool parseLength(const char* text, size_t& out) {
+    size_t value = 0;
+    const char* c = text;
+    for (; *c >= '0' && *c <= '9'; c++) {
+        size_t digit = *c - '0';
+        if (value > (SIZE_MAX - digit) / 10) return false;
+        value = value * 10 + digit;
+    }
+    if (c == text) return false;
+    while (*c == ' ' || *c == '\t') c++;
+    if (*c) return false;
+    out = value;
+    return true;
+}
+
+// --- REQUEST: PARSING ---
+
+const char* HttpRequest::arg(const char* name) const {
+    for (int i = 0; i < num_args_; i++) {
+        if (strcmp(arg_names_[i], name) == 0) return arg_values_[i];
+    }
+    return nullptr;
+}
+
+long HttpRequest::argInt(const char* name) const {
+    const char* value = arg(name);
+    return value ? atol(value) : 0;
+}
+
+const char* HttpRequest::header(const char* name) const {
+    for (int i = 0; i < num_headers_; i++) {
+        if (strcasecmp(header_names_[i], name) == 0) return header_values_[i];
+    }
+    return nullptr;
+}
+
+void HttpRequest::parseArgs(char* text) {
+    while (text && *text && num_args_ < HTTP_MAX_ARGS) {
+        char* next = strchr(text, '&');
+        if (next) *next++ = '\0';
+
+        char* value = strchr(text, '=');
+        if (value) {
+            *value++ = '\0';
+        } else {
+            value = text + strlen(text); // "flag" without a value
+        }
+        urlDecode(text);
+        urlDecode(value);
+        arg_names_[num_args_] = text;
+        arg_values_[num_args_] = value;
+        num_args_++;
+        text = next;
+    }
+}
+
+bool HttpRequest::parse() {
+    if (header_len_ == 0) {
+        char* end = strstr(in_, "\r\n\r\n");
+        if (!end) {
+            if (in_len_ >= HTTP_REQUEST_SIZE - 1) {
+                keep_alive_ = false;
+                send(413, "text/plain", "Request too large");
+                return true;
+            }
+            return false;
+        }
+        header_len_ = end - in_ + 4;
+        *end = '\0';
+
+        // Request line: METHOD SP target SP version
+        char* line_end = strstr(in_, "\r\n");
+        if (line_end) *line_end = '\0';
+        char* target = strchr(in_, ' ');
+        char* version = target ? strchr(target + 1, ' ') : nullptr;
+        if (!target || !version) {
+            keep_alive_ = false;
+            send(400, "text/plain", "Bad request");
+            return true;
+        }
+        *target++ = '\0';
+        *version++ = '\0';
+        method_ = strcmp(in_, "GET") == 0 ? HTTP_GET : strcmp(in_, "POST") == 0 ? HTTP_POST : HTTP_OTHER;
+        path_ = target;
+        keep_alive_ = strcmp(version, "HTTP/1.1") == 0;
+
+        // Header lines
+        char* line = line_end ? line_end + 2 : nullptr;
+        while (line && *line) {
+            char* next = strstr(line, "\r\n");
+            if (next) {
+                *next = '\0';
+                next += 2;
+            }
+            char* colon = strchr(line, ':');
+            if (colon && num_headers_ < HTTP_MAX_HEADERS) {
+                *colon++ = '\0';
+                while (*colon == ' ') colon++;
+                header_names_[num_headers_] = line;
+                header_values_[num_headers_] = colon;
+                num_headers_++;
+            }
+            line = next;
+        }
+
+        const char* connection = header("Connection");
+        if (connection) {
+            if (strcasecmp(connection, "close") == 0) keep_alive_ = false;
+            if (strcasecmp(connection, "keep-alive") == 0) keep_alive_ = true;
+        }
+        const char* length = header("Content-Length");
+        body_len_ = 0;
+        if (length && !parseLength(length, body_len_)) {
+            keep_alive_ = false; // The body cannot be framed
+            send(400, "text/plain", "Bad Content-Length");
+            return true;
+        }
+
+        // Admission: nothing else is done for a request over its client's rate
+        uint32_t retry = server_->admit(*this);
+        if (retry) {
+            char seconds[12];
+            snprintf(seconds, sizeof(seconds), "%lu", (unsigned long)retry);
+            keep_alive_ = false; // Its body, if any, is not read
+            sendHeader("Retry-After", seconds);
+            send(429, "text/plain", "Too many requests");
+            return true;
+        }
+
+        // Query string now; a urlencoded form body once it is in
+        char* query = strchr((char*)path_, '?');
+        if (query) {
+            *query++ = '\0';
+            parseArgs(query);
+        }
+
+        upload_ = method_ == HTTP_POST ? server_->uploadRoute(path_) : nullptr;
+        if (upload_ && body_len_ > SIZE_MAX - HTTP_REQUEST_SIZE) {
+            // Streamed, so any length that leaves the offsets room to count
+            keep_alive_ = false;
+            send(413, "text/plain", "Request too large");
+            return true;
+        }
+        if (upload_) {
+            keep_alive_ = false; // Whatever follows the body is not read
+            state_ = UPLOADING;
+            upload_(*this, HTTP_UPLOAD_START, nullptr, 0);
+            if (responded_) return true;
+        } else if (body_len_ > HTTP_REQUEST_SIZE - 1 - header_len_) { // header_len_ < HTTP_REQUEST_SIZE
+            keep_alive_ = false;
+            send(413, "text/plain", "Request too large");
+            return true;
+        }
+        sendContinue();
+    }
+
+    if (upload_) return consumeUpload();
+    if (in_len_ - header_len_ < body_len_) return false; // Body still arriving
+    next_byte_ = in_[header_len_ + body_len_]; // First byte of a pipelined request, if any
+
+    if (body_len_ > 0) {
+        in_[header_len_ + body_len_] = '\0';
+        parseArgs(in_ + header_len_);
+    }
+    return true;
+}
+
+// Clients that wait for "100 Continue" before sending a body (curl does for
+// uploads) get it once the request is accepted; a full socket buffer only
+// costs them their wait, so it is not retried
+void HttpRequest::sendContinue() {
+    const char* expect = header("Expect");
+    if (!expect || strcasecmp(expect, "100-continue") != 0) return;
+    if (body_len_ == 0 || in_len_ - header_len_ >= body_len_) return;
+    static const char CONTINUE[] = "HTTP/1.1 100 Continue\r\n\r\n";
+    ::send(fd_, CONTINUE, sizeof(CONTINUE) - 1, MSG_DONTWAIT);
+}
+
+// Returns true once the whole body was handed over, or the handler answered
+bool HttpRequest::consumeUpload() {
+    size_t len = min(in_len_ - header_len_, body_len_ - upload_received_);
+    if (len > 0) {
+        upload_received_ += len;
+        upload_(*this, HTTP_UPLOAD_DATA, (const uint8_t*)in_ + header_len_, len);
+    }
+    in_len_ = header_len_; // The next piece is read to the same place, after the headers
+    return responded_ || upload_received_ == body_len_;
+}
+
+// --- REQUEST: RESPONSE ---
+
+void HttpRequest::sendHeader(const char* name, const char* value) {
+    size_t room = HTTP_HEADER_SIZE - extra_headers_len_;
+    int n = snprintf(extra_headers_ + extra_headers_len_, room, "%s: %s\r\n", name, value);
+    if (n > 0 && (size_t)n < room) extra_headers_len_ += n;
+}
+
+void HttpRequest::startResponse(int code, const char* content_type, BodyType body) {
+    int n = snprintf(out_, HTTP_RESPONSE_SIZE, "HTTP/1.1 %d %s\r\nConnection: %s\r\n",
+                     code, statusText(code), keep_alive_ ? "keep-alive" : "close");
+    if (content_type && *content_type) {
+        n += snprintf(out_ + n, HTTP_RESPONSE_SIZE - n, "Content-Type: %s\r\n", content_type);
+    }
+    if (body == CHUNKED) {
+        n += snprintf(out_ + n, HTTP_RESPONSE_SIZE - n, "Transfer-Encoding: chunked\r\n");
+    }
+    out_len_ = n;
+    queue(extra_headers_, extra_headers_len_);
+    body_ = body;
+    responded_ = true;
+    // Content-Length and the blank line are added by the callers
+}
+
+bool HttpRequest::queue(const char* data, size_t len) {
+    if (out_len_ + len > HTTP_RESPONSE_SIZE) return false;
+    memcpy(out_ + out_len_, data, len);
+    out_len_ += len;
+    return true;
+}
+
+void HttpRequest::send(int code, const char* content_type, const char* body) {
+    send(code, content_type, body, strlen(body));
+}
+
+void HttpRequest::send(int code, const char* content_type, const char* body, size_t len) {
+    startResponse(code, content_type, BUFFERED);
+    char length[32] = "\r\n";
+    if (code != 204 && code != 304) snprintf(length, sizeof(length), "Content-Length: %u\r\n\r\n", (unsigned)len);
+    if (!queue(length, strlen(length)) || !queue(body, len)) {
+        extra_headers_len_ = 0;
+        keep_alive_ = false;
+        send(500, "text/plain", "Response too large");
+    }
+}
+
+void HttpRequest::sendStatic(int code, const char* content_type, const uint8_t* data, size_t len) {
+    startResponse(code, content_type, STATIC);
+    char length[32];
+    snprintf(length, sizeof(length), "Content-Length: %u\r\n\r\n", (unsigned)len);
+    queue(length, strlen(length));
+    static_data_ = data;
+    static_left_ = len;
+}
+
+void HttpRequest::beginEvents() {
+    static const char EVENT_HEADERS[] =
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: text/event-stream\r\n"
+        "Cache-Control: no-cache\r\n"
+        "Connection: keep-alive\r\n"
+        "\r\n"
+        "retry: 3000\n\n"; // Browser reconnect delay
+    out_len_ = 0;
+    queue(EVENT_HEADERS, sizeof(EVENT_HEADERS) - 1);
+    responded_ = true;
+    state_ = EVENTS;
+}
+
+// Puts the next piece of the page in out_, as one chunk
+bool HttpRequest::fillChunk() {
+    // Room is kept for the chunk's CRLF and the final "0\r\n\r\n"
+    size_t n = stream_->read(out_ + CHUNK_HEAD_SIZE, HTTP_RESPONSE_SIZE - CHUNK_HEAD_SIZE - 2 - 5);
+    out_pos_ = 0;
+    out_len_ = 0;
+    if (n > 0) {
+        snprintf(out_, CHUNK_HEAD_SIZE, "%04x", (unsigned)n);
+        out_[4] = '\r';
+        out_[5] = '\n';
+        out_len_ = CHUNK_HEAD_SIZE + n;
+        queue("\r\n", 2);
+        return true;
+    }
+    queue("0\r\n\r\n", 5);
+    finishStream();
+    return false;
+}
+
+void HttpRequest::finishStream() {
+    if (stream_) stream_->~PageStream();
+    stream_ = nullptr;
+    stream_done_ = true;
+}
+
+// --- REQUEST: CONNECTION ---
+
+void HttpRequest::reset() {
+    fd_ = -1;
+    state_ = IDLE;
+    resetForNextRequest();
+}
+
+void HttpRequest::resetForNextRequest() {
+    // What the client sent after the request just answered (pipelining)
+    // becomes the start of the next one
+    size_t used = header_len_ + body_len_;
+    size_t left = 0;
+    if (state_ == WRITING && keep_alive_ && header_len_ > 0 && !upload_ && used < in_len_) {
+        left = in_len_ - used;
+        memmove(in_, in_ + used, left);
+        in_[0] = next_byte_; // parse() wrote the body's terminator over it
+    }
+
+    finishStream();
+    if (fd_ >= 0) state_ = READING;
+    responded_ = false;
+    in_len_ = left;
+    in_[left] = '\0';
+    header_len_ = 0;
+    body_len_ = 0;
+    num_headers_ = 0;
+    num_args_ = 0;
+    upload_ = nullptr;
+    upload_received_ = 0;
+    path_ = "";
+    extra_headers_len_ = 0;
+    out_len_ = 0;
+    out_pos_ = 0;
+    body_ = NONE;
+    static_data_ = nullptr;
+    static_left_ = 0;
+    stream_done_ = false;
+    last_activity_ = millis();
+}
+
+void HttpRequest::close() {
+    if (state_ == UPLOADING && !responded_) upload_(*this, HTTP_UPLOAD_ABORTED, nullptr, 0);
+    if (fd_ >= 0) ::close(fd_);
+    reset();
+}
+
+// Reads what arrived; returns true when a complete request is ready
+bool HttpRequest::readable() {
+    char* dest = in_ + in_len_;
+    size_t room = HTTP_REQUEST_SIZE - 1 - in_len_;
+    char discard[64];
+    bool reading = state_ == READING || state_ == UPLOADING;
+    if (!reading) {
+        dest = discard; // Event streams do not expect anything from the client
+        room = sizeof(discard);
+    }
+
+    int n = recv(fd_, dest, room, MSG_DONTWAIT);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+        close();
+        return false;
+    }
+    if (n < 0 || !reading) return false;
+
+    in_len_ += n;
+    in_[in_len_] = '\0';
+    last_activity_ = millis();
+    return parse();
+}
+
+// Sends pending output; returns false if the connection was closed
+bool HttpRequest::writable() {
+    size_t budget = HTTP_WRITE_BUDGET;
+
+    while (budget > 0) {
+        const void* data = nullptr;
+        size_t len = 0;
+        if (out_pos_ < out_len_) {
+            data = out_ + out_pos_;
+            len = out_len_ - out_pos_;
+        } else if (state_ == EVENTS) {
+            out_pos_ = out_len_ = 0;
+            return true;
+        } else if (body_ == STATIC && static_left_ > 0) {
+            data = static_data_;
+            len = static_left_;
+        } else if (body_ == CHUNKED && !stream_done_) {
+            fillChunk();
+            continue;
+        } else {
+            // Response complete
+            if (!keep_alive_) {
+                close();
+                return false;
+            }
+            resetForNextRequest();
+            return true;
+        }
+
+        int n = ::send(fd_, data, min(len, budget), MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+            close();
+            return false;
+        }
+        if (n == 0) return true;
+
+        if (out_pos_ < out_len_) {
+            out_pos_ += n;
+        } else {
+            static_data_ += n;
+            static_left_ -= n;
+        }
+        budget -= n;
+        last_activity_ = millis();
+    }
+    return true;
+}
+
+// --- SERVER ---
+
+bool HttpServer::begin(uint16_t port) {
+    for (HttpRequest& c : connections_) {
+        c.server_ = this;
+        c.reset();
+    }
+
+    listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd_ < 0) return false;
+
+    int on = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(listen_fd_, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(listen_fd_, HTTP_LISTEN_BACKLOG) < 0) {
+        ::close(listen_fd_);
+        listen_fd_ = -1;
+        return false;
+    }
+    setNonBlocking(listen_fd_);
+    return true;
+}
+
+HttpServer::Route* HttpServer::addRoute(const char* path, HttpMethod method, HttpHandler handler) {
+    if (num_routes_ >= HTTP_MAX_ROUTES) return nullptr;
+    Route& route = routes_[num_routes_++];
+    route.path = path;
+    route.method = method;
+    route.handler = handler;
+    route.upload = nullptr;
+    return &route;
+}
+
+void HttpServer::on(const char* path, HttpMethod method, HttpHandler handler) {
+    addRoute(path, method, handler);
+}
+
+void HttpServer::onUpload(const char* path, HttpBodyHandler body, HttpHandler handler) {
+    Route* route = addRoute(path, HTTP_POST, handler);
+    if (route) route->upload = body;
+}
+
+HttpBodyHandler HttpServer::uploadRoute(const char* path) const {
+    for (int i = 0; i < num_routes_; i++) {
+        if (routes_[i].upload && strcmp(routes_[i].path, path) == 0) return routes_[i].upload;
+    }
+    return nullptr;
+}
+
+void HttpServer::refuse(int fd, const char* response, size_t len) {
+    ::send(fd, response, len, MSG_DONTWAIT);
+    ::close(fd);
+    refused_++;
+}
+
+void HttpServer::accept() {
+    static const char BUSY[] = "HTTP/1.1 503 Service Unavailable\r\nConnection: close\r\nContent-Length: 0\r\n\r\n";
+    static const char TOO_MANY[] = "HTTP/1.1 429 Too Many Requests\r\nConnection: close\r\n"
+                                   "Retry-After: 1\r\nContent-Length: 0\r\n\r\n";
+    for (;;) {
+        struct sockaddr_in addr = {};
+        socklen_t addr_len = sizeof(addr);
+        int fd = ::accept(listen_fd_, (struct sockaddr*)&addr, &addr_len);
+        if (fd < 0) return;
+        uint32_t client = addr.sin_addr.s_addr;
+
+        HttpRequest* slot = nullptr;
+        int held = 0;
+        for (HttpRequest& c : connections_) {
+            if (c.fd_ < 0) {
+                if (!slot) slot = &c;
+            } else if (c.client_ == client) {
+                held++;
+            }
+        }
+        if (held >= HTTP_MAX_CLIENT_CONNECTIONS) {
+            refuse(fd, TOO_MANY, sizeof(TOO_MANY) - 1);
+            continue;
+        }
+        if (!slot) {
+            refuse(fd, BUSY, sizeof(BUSY) - 1);
+            continue;
+        }
+
+        setNonBlocking(fd);
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        slot->fd_ = fd;
+        slot->client_ = client;
+        slot->resetForNextRequest();
+    }
+}
+
+void HttpServer::dispatch(HttpRequest& request) {
+    if (!request.responded_) {
+        unsigned long started = micros();
+        LatencyStat* stats = &unrouted_stats_;
+        bool path_found = false;
+        for (int i = 0; i < num_routes_; i++) {
+            Route& route = routes_[i];
+            if (strcmp(route.path, request.path_) != 0) continue;
+            path_found = true;
+            if (route.method == HTTP_OTHER || route.method == request.method_) {
+                route.handler(request);
+                stats = &route.stats;
+                break;
+            }
+        }
+        if (!request.responded_) {
+            if (path_found) {
+                request.send(405, "text/plain", "Method not allowed");
+            } else if (not_found_) {
+                not_found_(request);
+            }
+        }
+        if (!request.responded_) request.send(500, "text/plain", "No response");
+        stats->record(micros() - started);
+    }
+
+    if (request.state_ == HttpRequest::READING || request.state_ == HttpRequest::UPLOADING) {
+        request.state_ = HttpRequest::WRITING;
+    }
+    request.writable(); // Most responses go out right away
+}
+
+void HttpServer::poll(uint32_t timeout_ms) {
+    if (listen_fd_ < 0) {
+        delay(timeout_ms);
+        return;
+    }
+
+    fd_set readable, writable;
+    FD_ZERO(&readable);
+    FD_ZERO(&writable);
+    FD_SET(listen_fd_, &readable);
+    int max_fd = listen_fd_;
+    if (wake_fd_ >= 0) {
+        FD_SET(wake_fd_, &readable);
+        max_fd = max(max_fd, wake_fd_);
+    }
+
+    for (HttpRequest& c : connections_) {
+        if (c.fd_ < 0) continue;
+        if (c.state_ == HttpRequest::READING || c.state_ == HttpRequest::UPLOADING ||
+            c.state_ == HttpRequest::EVENTS) {
+            FD_SET(c.fd_, &readable);
+        }
+        if (c.state_ == HttpRequest::WRITING || c.out_pos_ < c.out_len_) FD_SET(c.fd_, &writable);
+        max_fd = max(max_fd, c.fd_);
+    }
+
+    struct timeval tv;
+    tv.tv_sec = timeout_ms / 1000;
+    tv.tv_usec = (timeout_ms % 1000) * 1000;
+    if (select(max_fd + 1, &readable, &writable, nullptr, &tv) < 0) return;
+
+    if (FD_ISSET(listen_fd_, &readable)) accept();
+
+    for (HttpRequest& c : connections_) {
+        int fd = c.fd_;
+        if (fd < 0) continue;
+        if (FD_ISSET(fd, &readable) && c.readable()) dispatch(c);
+        if (c.fd_ == fd && FD_ISSET(fd, &writable)) c.writable();
+
+        // Pipelined requests already in the buffer: the socket may not
+        // become readable again for them
+        while (c.fd_ == fd && c.state_ == HttpRequest::READING && c.in_len_ > 0 && c.parse()) dispatch(c);
+
+        // Idle keep-alive connections and stalled clients are closed. The
+        // handlers above may have just updated last_activity_: signed.
+        if (c.fd_ == fd && c.state_ != HttpRequest::EVENTS &&
+            (long)(millis() - c.last_activity_) > HTTP_IDLE_TIMEOUT_MS) {
+            c.close();
+        }
+    }
+}
+
+void HttpServer::broadcastEvent(const char* name, const char* data) {
+    for (HttpRequest& c : connections_) {
+        if (c.fd_ < 0 || c.state_ != HttpRequest::EVENTS) continue;
+
+        // Compacts what is still unsent, then appends the event
+        memmove(c.out_, c.out_ + c.out_pos_, c.out_len_ - c.out_pos_);
+        c.out_len_ -= c.out_pos_;
+        c.out_pos_ = 0;
+        size_t room = HTTP_RESPONSE_SIZE - c.out_len_;
+        int n = snprintf(c.out_ + c.out_len_, room, "event: %s\ndata: %s\n\n", name, data);
+        if (n < 0 || (size_t)n >= room) {
+            c.close(); // Client is not keeping up
+            continue;
+        }
+        c.out_len_ += n;
+    }
+}
+
+int HttpServer::eventClients() const {
+    int n = 0;
+    for (const HttpRequest& c : connections_) {
+        if (c.fd_ >= 0 && c.state_ == HttpRequest::EVENTS) n++;
+    }
+    return n;
+}
+
+int HttpServer::activeConnections() const {
+    int n = 0;
+    for (const HttpRequest& c : connections_) {
+        if (c.fd_ >= 0) n++;
+    }
+    return n;
+}
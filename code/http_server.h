@@ -0,0 +1,226 @@
+/*
+ * Event-driven HTTP server for the GRAVE Controller web interface.
+ *
+ * All connections are served from one task with non-blocking lwIP sockets
+ * and select(): a connection only gets attention when its socket is readable
+ * or writable, so a slow client on a weak link never holds up the others.
+ * Each connection slot has fixed buffers for the request and the response;
+ * nothing is allocated per request.
+ *
+ * Handlers run when a request is complete and must answer right away:
+ * small bodies are copied into the slot, flash-resident bodies are sent in
+ * place, and pages (PageStream) are rendered piece by piece, with chunked
+ * encoding, as the client takes them. Connections can also be turned into
+ * Server-Sent Events streams. Upload routes take bodies of any length,
+ * passed to their body handler piece by piece as they arrive.
+ *
+ * Requests are admitted per client (see RateLimiter) once their headers are
+ * in: one over its client's rate is answered 429 without reaching a handler.
+ * A client can hold at most HTTP_MAX_CLIENT_CONNECTIONS of the slots, so
+ * the others always find one.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <new>
+#include "html_stream.h"
+#include "metrics.h"
+#include "rate_limit.h"
+
+#define HTTP_MAX_CONNECTIONS 6
+#define HTTP_MAX_CLIENT_CONNECTIONS 4 // Per client address
+#define HTTP_REQUEST_SIZE 2048    // Request line, headers and form body
+#define HTTP_RESPONSE_SIZE 1024   // Response staging (headers, body or one chunk)
+#define HTTP_HEADER_SIZE 256      // Extra headers set by the handler
+#define HTTP_STREAM_SIZE 512      // Storage for the PageStream of a response
+#define HTTP_MAX_HEADERS 20
+#define HTTP_MAX_ARGS 32
+#define HTTP_MAX_ROUTES 24
+#define HTTP_IDLE_TIMEOUT_MS 10000 // Closes connections without progress
+#define HTTP_WRITE_BUDGET 2048     // Bytes sent per connection per poll, for fairness
+
+enum HttpMethod : uint8_t { HTTP_GET, HTTP_POST, HTTP_OTHER };
+
+// Calls to the body handler of an upload route
+enum HttpUploadEvent : uint8_t {
+  HTTP_UPLOAD_START,  // Headers in (length in contentLength()), no data yet
+  HTTP_UPLOAD_DATA,   // The next piece of the body
+  HTTP_UPLOAD_ABORTED // Connection lost before the end of the body
+};
+
+class HttpServer;
+class HttpRequest;
+
+// Body handler of an upload route. Answering from it (an error) ends the
+// upload: the rest of the body is not read, and the connection closes once
+// the answer is sent.
+typedef void (*HttpBodyHandler)(HttpRequest& request, HttpUploadEvent event, const uint8_t* data, size_t len);
+
+// One connection slot: the request being read and the response being sent
+class HttpRequest {
+public:
+    HttpMethod method() const { return method_; }
+    const char* path() const { return path_; }
+
+    // Query string and urlencoded form arguments (nullptr if absent)
+    const char* arg(const char* name) const;
+    bool hasArg(const char* name) const { return arg(name) != nullptr; }
+    long argInt(const char* name) const;
+    int args() const { return num_args_; }
+    const char* argName(int i) const { return arg_names_[i]; }
+    const char* argValue(int i) const { return arg_values_[i]; }
+
+    // Request headers (nullptr if absent)
+    const char* header(const char* name) const;
+
+    size_t contentLength() const { return body_len_; }
+
+    // Adds a header to the response; call before send*()
+    void sendHeader(const char* name, const char* value);
+
+    // Body copied into the connection buffer
+    void send(int code, const char* content_type = "text/plain", const char* body = "");
+    void send(int code, const char* content_type, const char* body, size_t len);
+
+    // Body sent straight from flash (must outlive the response)
+    void sendStatic(int code, const char* content_type, const uint8_t* data, size_t len);
+
+    // Body rendered by a PageStream of type T, built in the connection's
+    // stream storage from args
+    template <typename T, typename... Args>
+    void sendStream(int code, const char* content_type, Args&&... args) {
+        static_assert(sizeof(T) <= HTTP_STREAM_SIZE, "PageStream too large for HTTP_STREAM_SIZE");
+        stream_ = new (stream_storage_) T(static_cast<Args&&>(args)...);
+        startResponse(code, content_type, CHUNKED);
+        queue("\r\n", 2); // End of the headers; the chunks follow
+    }
+
+    // Keeps the connection open as a text/event-stream (see HttpServer::broadcastEvent)
+    void beginEvents();
+
+private:
+    friend class HttpServer;
+
+    enum State : uint8_t { IDLE, READING, UPLOADING, WRITING, EVENTS };
+    enum BodyType : uint8_t { NONE, BUFFERED, STATIC, CHUNKED };
+
+    void reset();
+    void close();
+    void resetForNextRequest();
+    bool parse(); // true when a complete request was parsed (or rejected)
+    bool consumeUpload(); // Hands what arrived of an upload body to its handler
+    void sendContinue();
+    void parseArgs(char* text);
+    bool readable();
+    bool writable(); // false once the connection is closed
+    bool fillChunk();
+    void startResponse(int code, const char* content_type, BodyType body);
+    bool queue(const char* data, size_t len);
+    void finishStream();
+
+    HttpServer* server_ = nullptr;
+    int fd_ = -1;
+    uint32_t client_ = 0; // IPv4 address
+    State state_ = IDLE;
+    bool keep_alive_ = false;
+    bool responded_ = false;
+    unsigned long last_activity_ = 0;
+
+    // Request
+    char in_[HTTP_REQUEST_SIZE];
+    size_t in_len_ = 0;
+    size_t header_len_ = 0; // Including the blank line, once found
+    size_t body_len_ = 0;
+    char next_byte_ = '\0';
+    HttpMethod method_ = HTTP_GET;
+    const char* path_ = "";
+    const char* header_names_[HTTP_MAX_HEADERS];
+    const char* header_values_[HTTP_MAX_HEADERS];
+    uint8_t num_headers_ = 0;
+    const char* arg_names_[HTTP_MAX_ARGS];
+    const char* arg_values_[HTTP_MAX_ARGS];
+    uint8_t num_args_ = 0;
+    HttpBodyHandler upload_ = nullptr;
+    size_t upload_received_ = 0;
+
+    // Response
+    char extra_headers_[HTTP_HEADER_SIZE];
+    size_t extra_headers_len_ = 0;
+    char out_[HTTP_RESPONSE_SIZE];
+    size_t out_len_ = 0;
+    size_t out_pos_ = 0;
+    BodyType body_ = NONE;
+    const uint8_t* static_data_ = nullptr;
+    size_t static_left_ = 0;
+    PageStream* stream_ = nullptr;
+    bool stream_done_ = false;
+    alignas(8) uint8_t stream_storage_[HTTP_STREAM_SIZE];
+};
+
+typedef void (*HttpHandler)(HttpRequest& request);
+
+class HttpServer {
+public:
+    bool begin(uint16_t port);
+
+    // Exact path match; HTTP_OTHER matches any method
+    void on(const char* path, HttpMethod method, HttpHandler handler);
+    void onNotFound(HttpHandler handler) { not_found_ = handler; }
+
+    // POST route whose body goes to `body` as it arrives, in pieces of up to
+    // HTTP_REQUEST_SIZE less the headers; `handler` answers once it is all in
+    void onUpload(const char* path, HttpBodyHandler body, HttpHandler handler);
+
+    // Serves the connections ready within timeout_ms; call in a loop
+    void poll(uint32_t timeout_ms);
+
+    // poll() also returns as soon as this socket (not read here) is
+    // readable; -1 = none
+    void wakeOn(int fd) { wake_fd_ = fd; }
+
+    // Sends "event: <name>" with one line of data to every event stream.
+    // A stream without room for it is closed.
+    void broadcastEvent(const char* name, const char* data);
+    int eventClients() const;
+
+    int activeConnections() const;
+
+    // Requests answered 429, and connections refused (all slots taken, or
+    // the client's share)
+    uint32_t rateLimited() const { return limiter_.rejected(); }
+    uint32_t refusedConnections() const { return refused_; }
+
+    // Handler time per route, and for requests that matched none
+    int routeCount() const { return num_routes_; }
+    const char* routePath(int i) const { return routes_[i].path; }
+    const LatencyStat& routeStats(int i) const { return routes_[i].stats; }
+    const LatencyStat& unroutedStats() const { return unrouted_stats_; }
+
+private:
+    friend class HttpRequest;
+
+    void accept();
+    void refuse(int fd, const char* response, size_t len);
+    uint32_t admit(const HttpRequest& request) { return limiter_.admit(request.client_, request.method_ == HTTP_POST); }
+    void dispatch(HttpRequest& request);
+    HttpBodyHandler uploadRoute(const char* path) const;
+
+    struct Route {
+        const char* path;
+        HttpMethod method;
+        HttpHandler handler;
+        HttpBodyHandler upload;
+        LatencyStat stats;
+    };
+    Route* addRoute(const char* path, HttpMethod method, HttpHandler handler);
+
+    int listen_fd_ = -1;
+    int wake_fd_ = -1;
+    Route routes_[HTTP_MAX_ROUTES];
+    int num_routes_ = 0;
+    HttpHandler not_found_ = nullptr;
+    LatencyStat unrouted_stats_;
+    RateLimiter limiter_;
+    uint32_t refused_ = 0;
+    HttpRequest connections_[HTTP_MAX_CONNECTIONS];
+};
@@ -0,0 +1,101 @@
+/*
+ * Minimal JSON serializer writing into a caller-provided buffer.
+ */
+#include "json_writer.h"
+#include <stdarg.h>
+
+JsonWriter::JsonWriter(char* buffer, size_t size) : buffer_(buffer), size_(size) {
+    if (size_ > 0) buffer_[0] = '\0';
+}
+
+void JsonWriter::append(const char* text, size_t len) {
+    if (overflow_) return;
+    if (len_ + len >= size_) {
+        overflow_ = true;
+        return;
+    }
+    memcpy(buffer_ + len_, text, len);
+    len_ += len;
+    buffer_[len_] = '\0';
+}
+
+void JsonWriter::appendf(const char* format, ...) {
+    if (overflow_) return;
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(buffer_ + len_, size_ - len_, format, args);
+    va_end(args);
+    if (written < 0 || len_ + written >= size_) {
+        overflow_ = true;
+        buffer_[len_] = '\0';
+        return;
+    }
+    len_ += written;
+}
+
+// Comma before every value but the first of its level, then the key
+void JsonWriter::separator(const char* key) {
+    uint8_t bit = 1 << depth_;
+    if (has_items_ & bit) append(",", 1);
+    has_items_ |= bit;
+    if (key && depth_ > 0) {
+        appendf("\"%s\":", key);
+    }
+}
+
+void JsonWriter::open(const char* key, char bracket) {
+    if (depth_ >= JSON_MAX_DEPTH - 1) {
+        overflow_ = true;
+        return;
+    }
+    separator(key);
+    append(&bracket, 1);
+    depth_++;
+    has_items_ &= ~(1 << depth_);
+}
+
+void JsonWriter::close(char bracket) {
+    if (depth_ == 0) return;
+    depth_--;
+    append(&bracket, 1);
+}
+
+void JsonWriter::beginObject(const char* key) { open(key, '{'); }
+void JsonWriter::endObject() { close('}'); }
+void JsonWriter::beginArray(const char* key) { open(key, '['); }
+void JsonWriter::endArray() { close(']'); }
+
+void JsonWriter::addNumber(const char* key, long value) {
+    separator(key);
+    appendf("%ld", value);
+}
+
+void JsonWriter::addBool(const char* key, bool value) {
+    separator(key);
+    if (value) {
+        append("true", 4);
+    } else {
+        append("false", 5);
+    }
+}
+
+void JsonWriter::addNull(const char* key) {
+    separator(key);
+    append("null", 4);
+}
+
+void JsonWriter::addString(const char* key, const char* value) {
+    separator(key);
+    append("\"", 1);
+    for (const char* c = value; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            char escaped[2] = { '\\', *c };
+            append(escaped, 2);
+        } else if ((uint8_t)*c < 0x20) {
+            appendf("\\u%04x", (uint8_t)*c);
+        } else {
+            append(c, 1);
+        }
+    }
+    append("\"", 1);
+}
@@ -0,0 +1,46 @@
+/*
+ * Minimal JSON serializer writing into a caller-provided buffer.
+ *
+ * No heap allocation: the document is built in place and the writer only
+ * remembers, per nesting level, whether a separator is needed. If the buffer
+ * is too small the output is cut and ok() returns false.
+ */
+#pragma once
+
+#include <Arduino.h>
+
+#define JSON_MAX_DEPTH 8
+
+class JsonWriter {
+public:
+    JsonWriter(char* buffer, size_t size);
+
+    // key is ignored (pass nullptr) inside arrays and for the root value
+    void beginObject(const char* key = nullptr);
+    void endObject();
+    void beginArray(const char* key = nullptr);
+    void endArray();
+
+    void addNumber(const char* key, long value);
+    void addBool(const char* key, bool value);
+    void addString(const char* key, const char* value);
+    void addNull(const char* key);
+
+    bool ok() const { return !overflow_ && depth_ == 0; }
+    size_t length() const { return len_; }
+    const char* c_str() const { return buffer_; }
+
+private:
+    void separator(const char* key);
+    void open(const char* key, char bracket);
+    void close(char bracket);
+    void append(const char* text, size_t len);
+    void appendf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+    char* buffer_;
+    size_t size_;
+    size_t len_ = 0;
+    bool overflow_ = false;
+    uint8_t depth_ = 0;
+    uint8_t has_items_ = 0; // Bit per nesting level: a value was already written
+};
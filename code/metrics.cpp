@@ -0,0 +1,129 @@
+/*
+ * Runtime instrumentation for the GRAVE Controller.
+ */
+#include "metrics.h"
+#include "http_server.h"
+#include <esp_heap_caps.h>
+
+LatencyStat metricAlarmCheck;
+LatencyStat metricI2c;
+LatencyStat metricUart;
+LatencyStat metricTickLateness;
+
+static portMUX_TYPE metrics_lock = portMUX_INITIALIZER_UNLOCKED;
+
+struct TaskEntry {
+  const char* name;
+  TaskHandle_t task;
+};
+static TaskEntry tasks[METRICS_MAX_TASKS];
+static int num_tasks = 0;
+
+void LatencyStat::record(uint32_t us) {
+    portENTER_CRITICAL(&metrics_lock);
+    count_++;
+    sum_us_ += us;
+    if (us > max_us_) max_us_ = us;
+    portEXIT_CRITICAL(&metrics_lock);
+}
+
+void LatencyStat::read(uint32_t& count, uint64_t& sum_us, uint32_t& max_us) const {
+    portENTER_CRITICAL(&metrics_lock);
+    count = count_;
+    sum_us = sum_us_;
+    max_us = max_us_;
+    portEXIT_CRITICAL(&metrics_lock);
+}
+
+void metricsRegisterTask(const char* name, TaskHandle_t task) {
+    if (num_tasks < METRICS_MAX_TASKS && task) tasks[num_tasks++] = { name, task };
+}
+
+// --- /metrics ---
+
+void MetricsPage::emitStat(const char* name, const char* labels, const LatencyStat& stat) {
+    uint32_t count;
+    uint64_t sum_us;
+    uint32_t max_us;
+    stat.read(count, sum_us, max_us);
+    emitf("grave_%s_us_count%s %lu\n"
+          "grave_%s_us_sum%s %llu\n"
+          "grave_%s_us_max%s %lu\n",
+          name, labels, (unsigned long)count,
+          name, labels, (unsigned long long)sum_us,
+          name, labels, (unsigned long)max_us);
+}
+
+bool MetricsPage::renderNext() {
+    switch (section_) {
+        case MEMORY:
+            emitf("# TYPE grave_uptime_seconds counter\n"
+                  "grave_uptime_seconds %lu\n"
+                  "# TYPE grave_heap_free_bytes gauge\n"
+                  "grave_heap_free_bytes %lu\n"
+                  "# TYPE grave_heap_largest_free_block_bytes gauge\n"
+                  "grave_heap_largest_free_block_bytes %lu\n"
+                  "# TYPE grave_heap_min_free_bytes gauge\n"
+                  "grave_heap_min_free_bytes %lu\n",
+                  millis() / 1000,
+                  (unsigned long)esp_get_free_heap_size(),
+                  (unsigned long)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT),
+                  (unsigned long)esp_get_minimum_free_heap_size());
+            section_ = TASKS;
+            return true;
+
+        case TASKS:
+            if (row_ < num_tasks) {
+                if (row_ == 0) emit("# TYPE grave_task_stack_min_free_bytes gauge\n");
+                emitf("grave_task_stack_min_free_bytes{task=\"%s\"} %lu\n", tasks[row_].name,
+                      (unsigned long)uxTaskGetStackHighWaterMark(tasks[row_].task));
+                row_++;
+                return true;
+            }
+            section_ = LATENCIES;
+            row_ = 0;
+            // fall through
+
+        case LATENCIES:
+            switch (row_++) {
+                case 0: emitStat("alarm_check_duration", "", metricAlarmCheck); return true;
+                case 1: emitStat("scheduler_lateness", "", metricTickLateness); return true;
+                case 2: emitStat("i2c_duration", "", metricI2c); return true;
+                case 3: emitStat("uart_duration", "", metricUart); return true;
+            }
+            section_ = HTTP;
+            row_ = 0;
+            // fall through
+
+        case HTTP:
+            emitf("# TYPE grave_http_connections gauge\n"
+                  "grave_http_connections %d\n"
+                  "# TYPE grave_http_event_clients gauge\n"
+                  "grave_http_event_clients %d\n"
+                  "# TYPE grave_http_rate_limited_total counter\n"
+                  "grave_http_rate_limited_total %lu\n"
+                  "# TYPE grave_http_refused_connections_total counter\n"
+                  "grave_http_refused_connections_total %lu\n",
+                  server_.activeConnections(), server_.eventClients(),
+                  (unsigned long)server_.rateLimited(), (unsigned long)server_.refusedConnections());
+            section_ = ROUTES;
+            return true;
+
+        case ROUTES: {
+            // Handler time per route; requests that matched no route are path="*"
+            if (row_ > server_.routeCount()) break;
+            const char* path = row_ < server_.routeCount() ? server_.routePath(row_) : "*";
+            const LatencyStat& stat = row_ < server_.routeCount() ? server_.routeStats(row_) : server_.unroutedStats();
+            char labels[64];
+            snprintf(labels, sizeof(labels), "{path=\"%s\"}", path);
+            emitStat("http_handler_duration", labels, stat);
+            row_++;
+            return true;
+        }
+
+        case DONE:
+            break;
+    }
+    section_ = DONE;
+    return false;
+}
@@ -0,0 +1,67 @@
+/*
+ * Runtime instrumentation for the GRAVE Controller.
+ *
+ * Durations are accumulated in LatencyStat counters (count, sum and maximum
+ * in microseconds) by the code being measured; memory and stack figures are
+ * sampled when /metrics is read. MetricsPage renders everything in the
+ * Prometheus text format through PageStream, so reading it allocates
+ * nothing.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include "html_stream.h"
+
+#define METRICS_MAX_TASKS 4
+
+// Count, sum and maximum of a duration. record() may be called from any
+// task; a short critical section keeps the 64-bit sum consistent.
+class LatencyStat {
+public:
+    void record(uint32_t us);
+    void read(uint32_t& count, uint64_t& sum_us, uint32_t& max_us) const;
+
+private:
+    uint32_t count_ = 0;
+    uint64_t sum_us_ = 0;
+    uint32_t max_us_ = 0;
+};
+
+// Records the lifetime of the object into a LatencyStat
+class ScopedLatency {
+public:
+    explicit ScopedLatency(LatencyStat& stat) : stat_(stat), start_(micros()) {}
+    ~ScopedLatency() { stat_.record(micros() - start_); }
+
+private:
+    LatencyStat& stat_;
+    unsigned long start_;
+};
+
+extern LatencyStat metricAlarmCheck;   // checkAlarmState()
+extern LatencyStat metricI2c;          // RTC reads and writes
+extern LatencyStat metricUart;         // MP3 command frames
+extern LatencyStat metricTickLateness; // Scheduler wake-ups past their deadline
+
+// Tasks whose stack high-water mark is reported
+void metricsRegisterTask(const char* name, TaskHandle_t task);
+
+class HttpServer;
+
+// /metrics body: one group of samples per piece
+class MetricsPage : public PageStream {
+public:
+    explicit MetricsPage(const HttpServer& server) : server_(server) {}
+
+protected:
+    bool renderNext() override;
+
+private:
+    enum Section : uint8_t { MEMORY, TASKS, LATENCIES, HTTP, ROUTES, DONE };
+
+    void emitStat(const char* name, const char* labels, const LatencyStat& stat);
+
+    const HttpServer& server_;
+    Section section_ = MEMORY;
+    int row_ = 0;
+};
@@ -0,0 +1,347 @@
+/*
+ * YX5300 MP3 player driver with an asynchronous command queue.
+ */
+#include "mp3_queue.h"
+#include "metrics.h"
+#include "trace.h"
+#include "supervisor.h"
+
+// Frame: 7E FF 06 <cmd> <feedback> <param1> <param2> <checksum hi> <checksum lo> EF
+#define FRAME_START 0x7E
+#define FRAME_VERSION 0xFF
+#define FRAME_LENGTH 0x06
+#define FRAME_END 0xEF
+
+// Commands
+#define CMD_PLAY_TRACK 0x03 // Play a track once (param2 = track)
+#define CMD_PLAY_LOOP 0x08 // Loop a single track (param2 = track)
+#define CMD_VOLUME 0x06
+#define CMD_SELECT_DEVICE 0x09
+#define CMD_WAKE_UP 0x0B
+#define CMD_STOP 0x16
+#define CMD_QUERY_FILES 0x48 // Number of tracks on the card
+#define DEVICE_TF_CARD 0x02
+
+// Module reports
+#define RSP_CARD_INSERTED 0x3A
+#define RSP_CARD_REMOVED 0x3B
+#define RSP_TRACK_FINISHED 0x3D
+#define RSP_INIT 0x3F
+#define RSP_ERROR 0x40
+#define RSP_ACK 0x41
+#define RSP_VOLUME 0x43
+#define RSP_FILES 0x48
+
+// --- PUBLIC INTERFACE ---
+
+void Mp3Queue::begin(HardwareSerial& serial, int rx_pin, int tx_pin,
+                     UBaseType_t priority, BaseType_t core, uint32_t stack_size) {
+    serial_ = &serial;
+    serial_->begin(MP3_BAUD_RATE, SERIAL_8N1, rx_pin, tx_pin);
+    xTaskCreatePinnedToCore(taskEntry, "mp3", stack_size, this, priority, &task_, core);
+    // Incoming bytes wake the task instead of it polling the UART
+    serial_->onReceive([this]() { wake(); });
+}
+
+void Mp3Queue::playLoop(uint8_t track) {
+    if (track == 0) {
+        stop();
+        return;
+    }
+    Mp3Track single = { track, MP3_VOLUME_DEFAULT };
+    playList(&single, 1);
+}
+
+void Mp3Queue::playList(const Mp3Track* tracks, uint8_t count, uint16_t fade_in_ms) {
+    count = min(count, (uint8_t)MP3_PLAYLIST_SIZE);
+    portENTER_CRITICAL(&lock_);
+    bool same = count == want_count_ &&
+                (count == 0 || memcmp(want_tracks_, tracks, count * sizeof(Mp3Track)) == 0);
+    if (!same) {
+        if (count) memcpy(want_tracks_, tracks, count * sizeof(Mp3Track));
+        want_count_ = count;
+        want_seq_++;
+    }
+    want_fade_in_ms_ = fade_in_ms;
+    portEXIT_CRITICAL(&lock_);
+    if (!same) wake();
+}
+
+void Mp3Queue::stop() {
+    playList(nullptr, 0);
+}
+
+void Mp3Queue::setVolume(uint8_t volume, uint16_t fade_ms) {
+    portENTER_CRITICAL(&lock_);
+    want_volume_ = min(volume, (uint8_t)30);
+    want_fade_ms_ = fade_ms;
+    portEXIT_CRITICAL(&lock_);
+    wake();
+}
+
+void Mp3Queue::prepare(uint8_t volume) {
+    portENTER_CRITICAL(&lock_);
+    want_prepare_ = true;
+    prepare_volume_ = min(volume, (uint8_t)30);
+    portEXIT_CRITICAL(&lock_);
+    wake();
+}
+
+void Mp3Queue::wake() {
+    if (task_) xTaskNotifyGive(task_);
+}
+
+// --- QUEUE TASK ---
+
+void Mp3Queue::taskEntry(void* arg) {
+    static_cast<Mp3Queue*>(arg)->run();
+}
+
+void Mp3Queue::run() {
+    traceRegisterTask();
+    vTaskDelay(pdMS_TO_TICKS(MP3_STARTUP_DELAY_MS));
+    last_send_ms_ = millis() - MP3_COMMAND_GAP_MS;
+
+    for (;;) {
+        receive();
+
+        // Sleeps until a new request or incoming bytes, or until the
+        // pacing gap has passed if a command is still waiting
+        TickType_t wait = portMAX_DELAY;
+        unsigned long since_send = millis() - last_send_ms_;
+        if (since_send >= MP3_COMMAND_GAP_MS) {
+            uint32_t next_ms = sendPending();
+            if (next_ms) wait = pdMS_TO_TICKS(next_ms);
+        } else {
+            wait = pdMS_TO_TICKS(MP3_COMMAND_GAP_MS - since_send) + 1;
+        }
+        supervisorWaiting();
+        ulTaskNotifyTake(pdTRUE, wait);
+        supervisorWorking();
+    }
+}
+
+static int trackVolume(const Mp3Track& track, uint8_t volume) {
+    return track.volume == MP3_VOLUME_DEFAULT ? volume : min(track.volume, (uint8_t)30);
+}
+
+uint32_t Mp3Queue::sendPending() {
+    Mp3Track tracks[MP3_PLAYLIST_SIZE];
+    portENTER_CRITICAL(&lock_);
+    uint8_t count = want_count_;
+    memcpy(tracks, want_tracks_, sizeof(tracks));
+    uint32_t seq = want_seq_;
+    uint16_t fade_in_ms = want_fade_in_ms_;
+    uint8_t volume = want_volume_;
+    uint16_t fade_ms = want_fade_ms_;
+    if (want_prepare_) {
+        want_prepare_ = false;
+        prepare_step_ = 1;
+    }
+    uint8_t prepare_volume = prepare_volume_;
+    portEXIT_CRITICAL(&lock_);
+
+    unsigned long now = millis();
+    if (!device_selected_) {
+        sendCommand(CMD_SELECT_DEVICE, 0, DEVICE_TF_CARD);
+        device_selected_ = true;
+        return MP3_COMMAND_GAP_MS;
+    }
+    if (!card_queried_) {
+        // After a reset the module does not announce itself: ask for the card
+        sendCommand(CMD_QUERY_FILES, 0, 0);
+        card_queried_ = true;
+        return MP3_COMMAND_GAP_MS;
+    }
+
+    // New track sequence, or stop
+    if (!sequence_started_ || seq != sent_seq_) {
+        if (count == 0) {
+            sent_seq_ = seq;
+            sequence_started_ = true;
+            if (sent_track_ != 0) {
+                TRACE(TRACE_MP3_STOP);
+                sendCommand(CMD_STOP, 0, 0);
+                sent_track_ = 0;
+                return MP3_COMMAND_GAP_MS;
+            }
+        } else {
+            // Volume goes first, so a track starts at the right level (silent when fading in)
+            int level = trackVolume(tracks[0], volume);
+            int start_level = fade_in_ms ? 0 : level;
+            if (sent_volume_ != start_level) {
+                fade_target_ = start_level;
+                return sendVolume(start_level, now);
+            }
+            startTrack(tracks[0], count == 1);
+            sent_seq_ = seq;
+            sequence_started_ = true;
+            play_index_ = 0;
+            track_finished_ = false;
+            beginRamp(level, fade_in_ms);
+            return MP3_COMMAND_GAP_MS;
+        }
+    }
+
+    // Next playlist entry, once the module reported the end of the current one
+    if (track_finished_ && count > 1) {
+        uint8_t next = (play_index_ + 1) % count;
+        int level = trackVolume(tracks[next], volume);
+        if (sent_volume_ != level) {
+            fade_target_ = level;
+            return sendVolume(level, now);
+        }
+        startTrack(tracks[next], false);
+        play_index_ = next;
+        track_finished_ = false;
+        return MP3_COMMAND_GAP_MS;
+    }
+
+    // Ahead of playback: wake the module, then set the starting volume
+    if (prepare_step_ != 0) {
+        if (sent_track_ != 0) {
+            prepare_step_ = 0; // Already playing
+        } else if (prepare_step_ == 1) {
+            TRACE(TRACE_MP3_PREPARE, prepare_volume);
+            sendCommand(CMD_WAKE_UP, 0, 0);
+            prepare_step_ = 2;
+            return MP3_COMMAND_GAP_MS;
+        } else {
+            prepare_step_ = 0;
+            if (sent_volume_ != prepare_volume) return sendVolume(prepare_volume, now);
+        }
+    }
+
+    // Volume changes and fades while playing; a stopped module gets its
+    // volume when playback starts
+    if (sent_track_ > 0 && play_index_ < count) {
+        int level = trackVolume(tracks[play_index_], volume);
+        if (level != fade_target_) beginRamp(level, fade_ms);
+        if (sent_volume_ != level) {
+            if (fade_step_ms_ && sent_volume_ >= 0) {
+                unsigned long since = now - last_volume_ms_;
+                if (since < fade_step_ms_) return fade_step_ms_ - since;
+                int step = min(fade_increment_, abs(level - sent_volume_));
+                level = sent_volume_ + (level > sent_volume_ ? step : -step);
+            }
+            return sendVolume(level, now);
+        }
+    }
+    return 0;
+}
+
+uint32_t Mp3Queue::sendVolume(int level, unsigned long now) {
+    sendCommand(CMD_VOLUME, 0, level);
+    sent_volume_ = level;
+    last_volume_ms_ = now;
+    return MP3_COMMAND_GAP_MS;
+}
+
+// Steps from the current volume to `level` over ms (0 = in one command)
+void Mp3Queue::beginRamp(int level, uint32_t ms) {
+    fade_target_ = level;
+    fade_step_ms_ = 0;
+    int distance = sent_volume_ >= 0 ? abs(level - sent_volume_) : 0;
+    if (!ms || !distance) return;
+
+    // At most one command per gap: short fades take bigger steps
+    uint32_t commands = max(1UL, min((unsigned long)distance, (unsigned long)(ms / MP3_COMMAND_GAP_MS)));
+    fade_increment_ = (distance + commands - 1) / commands;
+    fade_step_ms_ = ms / commands;
+    TRACE(TRACE_MP3_FADE, sent_volume_, level, ms);
+}
+
+void Mp3Queue::startTrack(const Mp3Track& track, bool loop) {
+    if (loop) {
+        TRACE(TRACE_MP3_PLAY, track.track);
+        sendCommand(CMD_PLAY_LOOP, 0, track.track);
+    } else {
+        TRACE(TRACE_MP3_PLAY_ONCE, track.track);
+        sendCommand(CMD_PLAY_TRACK, 0, track.track);
+    }
+    sent_track_ = track.track;
+    looping_ = loop;
+    track_started_ms_ = millis();
+}
+
+void Mp3Queue::sendCommand(uint8_t command, uint8_t param1, uint8_t param2) {
+    uint8_t frame[MP3_FRAME_SIZE] = { FRAME_START, FRAME_VERSION, FRAME_LENGTH, command, 0, param1, param2, 0, 0, FRAME_END };
+    uint16_t checksum = 0;
+    for (int i = 1; i <= 6; i++) checksum += frame[i];
+    checksum = -checksum;
+    frame[7] = checksum >> 8;
+    frame[8] = checksum & 0xFF;
+
+    {
+        ScopedLatency timing(metricUart);
+        serial_->write(frame, sizeof(frame));
+    }
+    last_send_ms_ = millis();
+    frames_sent_++;
+}
+
+void Mp3Queue::receive() {
+    while (serial_->available() > 0) {
+        uint8_t b = serial_->read();
+
+        // Resynchronizes on the start byte after a malformed frame
+        if (rx_len_ == 0 && b != FRAME_START) continue;
+        rx_frame_[rx_len_++] = b;
+        if (rx_len_ < MP3_FRAME_SIZE) continue;
+        rx_len_ = 0;
+
+        if (rx_frame_[MP3_FRAME_SIZE - 1] == FRAME_END) handleFrame(rx_frame_);
+    }
+}
+
+void Mp3Queue::handleFrame(const uint8_t* frame) {
+    uint16_t checksum = 0;
+    for (int i = 1; i <= 6; i++) checksum += frame[i];
+    if ((uint16_t)-checksum != (uint16_t)(frame[7] << 8 | frame[8])) return;
+
+    frames_received_++;
+    uint8_t param = frame[6];
+
+    switch (frame[3]) {
+        case RSP_CARD_INSERTED:
+            TRACE(TRACE_MP3_CARD_IN);
+            card_present_ = true;
+            card_known_ = true;
+            // The module forgets its state; send everything again
+            device_selected_ = false;
+            sequence_started_ = false;
+            sent_track_ = -1;
+            sent_volume_ = -1;
+            fade_target_ = -1;
+            break;
+        case RSP_CARD_REMOVED:
+            TRACE(TRACE_MP3_CARD_OUT);
+            card_present_ = false;
+            card_known_ = true;
+            break;
+        case RSP_INIT:
+            card_present_ = param & DEVICE_TF_CARD;
+            card_known_ = true;
+            break;
+        case RSP_FILES:
+            card_present_ = (frame[5] << 8 | param) > 0;
+            card_known_ = true;
+            break;
+        case RSP_ERROR:
+            TRACE(TRACE_MP3_ERROR, param);
+            last_error_ = param;
+            break;
+        case RSP_VOLUME:
+            sent_volume_ = param;
+            break;
+        case RSP_TRACK_FINISHED:
+            // Reports sooner than the guard time after a start repeat the previous one
+            if (sent_track_ > 0 && !looping_ && millis() - track_started_ms_ >= MP3_FINISH_GUARD_MS) {
+                track_finished_ = true;
+            }
+            break;
+        case RSP_ACK:
+        default:
+            break;
+    }
+}
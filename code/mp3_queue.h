@@ -0,0 +1,124 @@
+/*
+ * YX5300 MP3 player driver with an asynchronous command queue.
+ *
+ * Callers only record the state they want (a track in loop, a playlist or
+ * stopped, and a volume); a dedicated task brings the module to that state.
+ * Requests are coalesced: the task compares the desired state with what it
+ * last sent, so twenty volume changes in a row end up as one command with
+ * the latest value. Commands are spaced by MP3_COMMAND_GAP_MS, as the module
+ * drops frames that arrive while it is still processing the previous one,
+ * and the status frames the module sends back (card inserted/removed,
+ * errors, acks) are parsed by the same task as they arrive.
+ *
+ * Playlists advance when the module reports the end of a track. Fades are
+ * volume steps spread over the fade time (steps of one unless that would
+ * need more than one command per gap). As the module takes a
+ * moment to wake up and each frame costs a command gap, prepare() lets the
+ * caller wake it and set its volume ahead of time, so starting playback on
+ * schedule takes a single frame.
+ *
+ * None of the public calls touch the UART, so they never block.
+ */
+#pragma once
+
+#include <Arduino.h>
+
+#define MP3_BAUD_RATE 9600
+#define MP3_COMMAND_GAP_MS 40    // Minimum time between two frames sent to the module
+#define MP3_STARTUP_DELAY_MS 500 // Module boot time before the first command
+#define MP3_FRAME_SIZE 10
+#define MP3_PLAYLIST_SIZE 8
+#define MP3_FINISH_GUARD_MS 1000 // The module can report the end of a track twice
+#define MP3_VOLUME_DEFAULT 0xFF  // Mp3Track: play at the volume given to setVolume()
+
+struct Mp3Track {
+  uint8_t track;
+  uint8_t volume; // 0-30, or MP3_VOLUME_DEFAULT
+};
+
+class Mp3Queue {
+public:
+    // Opens the UART and starts the queue task
+    void begin(HardwareSerial& serial, int rx_pin, int tx_pin,
+               UBaseType_t priority, BaseType_t core, uint32_t stack_size);
+
+    // Desired state; applied by the queue task
+    void playLoop(uint8_t track);
+    // Plays the tracks in order, each once, and starts over after the last
+    // one. A sequence different from the current one starts with a ramp from
+    // silence lasting fade_in_ms.
+    void playList(const Mp3Track* tracks, uint8_t count, uint16_t fade_in_ms = 0);
+    void stop();
+    // 0-30; with fade_ms, reached in steps spread over that time
+    void setVolume(uint8_t volume, uint16_t fade_ms = 0);
+    // While stopped: wakes the module and sets `volume` now, so that the next
+    // playback starts with a single frame (call shortly before it is due)
+    void prepare(uint8_t volume);
+
+    // Last state reported by the module. The card counts as present until
+    // a report says otherwise; cardKnown() tells whether one has arrived
+    // (the card is queried once the module is up).
+    bool cardPresent() const { return card_present_; }
+    bool cardKnown() const { return card_known_; }
+    uint8_t lastError() const { return last_error_; }
+    uint32_t framesSent() const { return frames_sent_; }
+    uint32_t framesReceived() const { return frames_received_; }
+    TaskHandle_t taskHandle() const { return task_; }
+
+private:
+    static void taskEntry(void* arg);
+    void run();
+    void wake();
+
+    // Sends at most one command. Returns the milliseconds until another one
+    // may be due (0 = nothing left to send).
+    uint32_t sendPending();
+    uint32_t sendVolume(int level, unsigned long now);
+    void beginRamp(int level, uint32_t ms);
+    void startTrack(const Mp3Track& track, bool loop);
+    void sendCommand(uint8_t command, uint8_t param1, uint8_t param2);
+    void receive();
+    void handleFrame(const uint8_t* frame);
+
+    HardwareSerial* serial_ = nullptr;
+    TaskHandle_t task_ = nullptr;
+
+    // Desired state, written by any task (protected by lock_)
+    mutable portMUX_TYPE lock_ = portMUX_INITIALIZER_UNLOCKED;
+    Mp3Track want_tracks_[MP3_PLAYLIST_SIZE];
+    uint8_t want_count_ = 0; // 0 = stopped
+    uint16_t want_fade_in_ms_ = 0;
+    uint32_t want_seq_ = 0;  // Changes with the track sequence
+    uint8_t want_volume_ = 15;
+    uint16_t want_fade_ms_ = 0;
+    bool want_prepare_ = false;
+    uint8_t prepare_volume_ = 0;
+
+    // State last sent to the module (queue task only)
+    bool device_selected_ = false;
+    bool card_queried_ = false;
+    bool sequence_started_ = false; // want_seq_ was applied as sent_seq_
+    uint32_t sent_seq_ = 0;
+    int sent_track_ = -1; // -1 = unknown, 0 = stopped
+    int sent_volume_ = -1;
+    uint8_t play_index_ = 0;      // Current entry of the sequence
+    bool looping_ = false;        // Single track in loop (no end reports expected)
+    bool track_finished_ = false; // Reported by the module: play the next entry
+    unsigned long track_started_ms_ = 0;
+    uint8_t prepare_step_ = 0;    // prepare(): 0 = idle, 1 = wake, 2 = volume
+    int fade_target_ = -1;
+    uint32_t fade_step_ms_ = 0;
+    int fade_increment_ = 1;
+    unsigned long last_volume_ms_ = 0;
+    unsigned long last_send_ms_ = 0;
+
+    // Reception
+    uint8_t rx_frame_[MP3_FRAME_SIZE];
+    size_t rx_len_ = 0;
+
+    volatile bool card_present_ = true;
+    volatile bool card_known_ = false;
+    volatile uint8_t last_error_ = 0;
+    volatile uint32_t frames_sent_ = 0;
+    volatile uint32_t frames_received_ = 0;
+};
@@ -0,0 +1,106 @@
+/*
+ * Over-the-air firmware update into the inactive app partition.
+ */
+#include "ota.h"
+
+// Arduino core hook: when true, the core leaves a new image on trial
+// instead of confirming it at startup; firmwareConfirm() does it
+extern "C" bool verifyRollbackLater() {
+    return true;
+}
+
+// --- UPDATE ---
+
+bool OtaUpdate::fail(const char* error) {
+    error_ = error;
+    abort();
+    return false;
+}
+
+bool OtaUpdate::begin(size_t size, const uint8_t* sha256) {
+    abort();
+    error_ = "";
+
+    partition_ = esp_ota_get_next_update_partition(nullptr);
+    if (!partition_) return fail("No OTA partition");
+    if (size == 0 || size > partition_->size) return fail("Image does not fit the partition");
+    if (esp_ota_begin(partition_, OTA_WITH_SEQUENTIAL_WRITES, &handle_) != ESP_OK) {
+        return fail("Could not start the update");
+    }
+
+    mbedtls_md_init(&hash_);
+    mbedtls_md_setup(&hash_, mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), 0);
+    mbedtls_md_starts(&hash_);
+    memcpy(expected_, sha256, OTA_HASH_SIZE);
+    size_ = size;
+    written_ = 0;
+    active_ = true;
+    return true;
+}
+
+bool OtaUpdate::write(const uint8_t* data, size_t len) {
+    if (!active_) return false;
+    if (written_ + len > size_) return fail("More data than announced");
+    if (esp_ota_write(handle_, data, len) != ESP_OK) return fail("Flash write failed");
+    mbedtls_md_update(&hash_, data, len);
+    written_ += len;
+    return true;
+}
+
+bool OtaUpdate::end() {
+    if (!active_) return false;
+    if (written_ != size_) return fail("Image incomplete");
+
+    uint8_t hash[OTA_HASH_SIZE];
+    mbedtls_md_finish(&hash_, hash);
+    uint8_t diff = 0;
+    for (int i = 0; i < OTA_HASH_SIZE; i++) diff |= hash[i] ^ expected_[i];
+    if (diff) return fail("SHA-256 mismatch");
+
+    // esp_ota_end() releases the handle whatever its result
+    active_ = false;
+    mbedtls_md_free(&hash_);
+    esp_err_t err = esp_ota_end(handle_);
+    if (err != ESP_OK) {
+        error_ = err == ESP_ERR_OTA_VALIDATE_FAILED ? "Not a valid image" : "Could not finish the update";
+        return false;
+    }
+    if (esp_ota_set_boot_partition(partition_) != ESP_OK) {
+        error_ = "Could not select the new image";
+        return false;
+    }
+    return true;
+}
+
+void OtaUpdate::abort() {
+    if (!active_) return;
+    active_ = false;
+    esp_ota_abort(handle_);
+    mbedtls_md_free(&hash_);
+}
+
+// --- BOOT TRIAL ---
+
+bool firmwareOnTrial() {
+    esp_ota_img_states_t state;
+    return esp_ota_get_state_partition(esp_ota_get_running_partition(), &state) == ESP_OK &&
+           state == ESP_OTA_IMG_PENDING_VERIFY;
+}
+
+void firmwareConfirm(bool healthy) {
+    if (healthy) {
+        esp_ota_mark_app_valid_cancel_rollback();
+    } else {
+        esp_ota_mark_app_invalid_rollback_and_reboot(); // Does not return when there is an image to go back to
+    }
+}
+
+bool otaParseHash(const char* hex, uint8_t* out) {
+    if (!hex || strlen(hex) != OTA_HASH_SIZE * 2) return false;
+    for (int i = 0; i < OTA_HASH_SIZE; i++) {
+        char digits[3] = { hex[2 * i], hex[2 * i + 1], '\0' };
+        if (!isxdigit((unsigned char)digits[0]) || !isxdigit((unsigned char)digits[1])) return false;
+        out[i] = strtoul(digits, nullptr, 16);
+    }
+    return true;
+}
@@ -0,0 +1,64 @@
+/*
+ * Over-the-air firmware update into the inactive app partition.
+ *
+ * The image is written as it arrives over HTTP (see HttpServer::onUpload),
+ * one piece at a time, together with its SHA-256. Nothing beyond the
+ * connection buffer is held in RAM. The flash is erased sector by sector
+ * ahead of the writes, so no single call stalls for the whole erase. When
+ * the last byte is in, the image has to match the hash sent with it and
+ * pass the SDK's own image check (and its signature check, with secure
+ * boot). Only then does it become the boot partition.
+ *
+ * The new image boots on trial. The SDK's rollback is held back (see
+ * verifyRollbackLater() in ota.cpp) until the firmware has run its boot
+ * self-test. firmwareConfirm() then keeps the image, or marks it invalid
+ * and reboots into the previous one. If the image crashes or resets before
+ * that, the bootloader goes back to the previous image by itself.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <esp_ota_ops.h>
+#include <mbedtls/md.h>
+
+#define OTA_HASH_SIZE 32 // SHA-256
+
+class OtaUpdate {
+public:
+    // Starts an image of `size` bytes that must hash to `sha256`. Any update
+    // in progress is abandoned.
+    bool begin(size_t size, const uint8_t* sha256);
+    bool write(const uint8_t* data, size_t len);
+
+    // Checks the hash and the image, and boots it on the next restart
+    bool end();
+    void abort();
+
+    bool isActive() const { return active_; }
+    size_t written() const { return written_; }
+    size_t size() const { return size_; }
+
+    // Why the last call failed
+    const char* error() const { return error_; }
+
+private:
+    bool fail(const char* error);
+
+    const esp_partition_t* partition_ = nullptr;
+    esp_ota_handle_t handle_ = 0;
+    mbedtls_md_context_t hash_;
+    uint8_t expected_[OTA_HASH_SIZE];
+    size_t size_ = 0;
+    size_t written_ = 0;
+    bool active_ = false;
+    const char* error_ = "";
+};
+
+// This boot runs an image that still has to pass its health check
+bool firmwareOnTrial();
+
+// Ends the trial: keeps the running image, or rolls back and reboots
+void firmwareConfirm(bool healthy);
+
+// Parses 64 hex digits; false if malformed
+bool otaParseHash(const char* hex, uint8_t* out);
@@ -0,0 +1,497 @@
+/*
+ * Pages of the GRAVE Controller web interface.
+ */
+#include "pages.h"
+#include "json_writer.h"
+#include "ui_assets.h"
+
+// Static page blocks, kept in flash and streamed as-is
+// (UI strings remain in Portuguese for consistency)
+const char PAGE_HEAD[] PROGMEM =
+    "<!DOCTYPE html><html><head><title>GRAVE Controller</title><meta charset='UTF-8'><meta name='viewport' content='width=device-width, initial-scale=1'>"
+    "<link rel='stylesheet' href='" ASSET_STYLE_URL "'><script src='" ASSET_APP_URL "' defer></script>"
+    "</head><body><h1>GRAVE Controller</h1>"
+    "<div><h2>Estado Atual</h2>";
+
+const char PAGE_VOLUME_OPEN[] PROGMEM =
+    "<div><h2>Controle de Volume do MP3</h2>"
+    "<p>Ajuste o volume (0-30). O volume atual é: <strong id='volume-cfg'>";
+
+const char PAGE_VOLUME_FORM[] PROGMEM =
+    "<form action='/setvolume' method='POST' style='grid-template-columns: 1fr;'>"
+    "<label for='volume'>Nível de Volume:</label>"
+    "<input type='range' id='volume' name='v' min='0' max='30' value='";
+
+const char PAGE_VOLUME_CLOSE[] PROGMEM =
+    "' style='width: 95%; margin-top: 5px; margin-bottom: 15px;'>"
+    "<input type='submit' value='Salvar Volume' style='grid-column: 1 / -1; margin-top: 0;'>"
+    "</form></div>"
+    "<div><h2>Autoteste (Amplificador/MP3)</h2>"
+    "<form action='/setselftest' method='POST'>"
+    "<label for='selftest'>Duração no arranque (s, 0 = desligado):</label>"
+    "<input type='number' id='selftest' name='s' min='0' max='60' value='";
+
+const char PAGE_SELFTEST_CLOSE[] PROGMEM =
+    "'><input type='submit' value='Salvar Duração'></form>"
+    "<form action='/selftest' method='POST' style='grid-template-columns: 1fr; margin-top: 10px;'>"
+    "<input type='submit' value='Testar Agora' style='background: #6c757d;'></form></div>"
+    "<div><h2>Zonas (Faixa/Volume do MP3)</h2>"
+    "<p style='font-size: 0.85em;'>Cada zona tem a sua saída e a sua faixa. O leitor MP3 toca uma faixa de cada vez: "
+    "a da zona ativa de número mais baixo. Volume vazio = volume geral.</p>";
+
+const char PAGE_PLAYLISTS_OPEN[] PROGMEM =
+    "</div><div><h2>Listas de Reprodução</h2>"
+    "<p style='font-size: 0.85em;'>Um período pode tocar uma lista em vez da faixa da zona. "
+    "Faixas separadas por vírgulas, cada uma com volume opcional (ex.: 3:20, 5, 7:25). "
+    "O fade-out termina no fim do período. Lista vazia = não usada.</p>";
+
+const char PAGE_PERIODS_OPEN[] PROGMEM =
+    "</div><div><h2>Definir Períodos de Ativação</h2>";
+
+const char PAGE_TIMELINE_SCALE[] PROGMEM =
+    "<p style='display: flex; justify-content: space-between; font-size: 0.75em; margin: 2px 0 10px;'>"
+    "<span>00h</span><span>06h</span><span>12h</span><span>18h</span><span>24h</span></p>";
+
+const char PAGE_PERIOD_NOTES[] PROGMEM =
+    "<p style='grid-column: 1 / -1; font-size: 0.85em;'>* Períodos definidos como 00:00 a 00:00 serão ignorados. "
+    "Um período que termina antes de começar passa a meia-noite. "
+    "Uma exceção desliga a saída nesse horário (00:00 a 00:00 = dia inteiro). "
+    "Datas vazias = todo o ano.</p>";
+
+const char PAGE_TIME_OPEN[] PROGMEM =
+    "</form></div>"
+    "<div><h2>Ajustar Hora Local</h2>"
+    "<form action='/settime' method='POST' id='settime' style='grid-template-columns: 1fr 1fr 1fr; gap: 10px;'>"
+    "<h3>Hora</h3>"
+    "<label>Hora</label><label>Minuto</label><label>Segundo</label>";
+
+const char PAGE_DATE_LABELS[] PROGMEM =
+    "<h3>Data</h3>"
+    "<label>Dia</label><label>Mês</label><label>Ano</label>";
+
+const char PAGE_TIME_CLOSE[] PROGMEM =
+    "<input type='submit' value='Definir Hora e Data' style='margin-top: 10px;'>"
+    "</form></div>";
+
+// Follows the fleet heading and unit ID
+const char PAGE_FLEET[] PROGMEM =
+    "<p style='font-size: 0.85em;'>Com a rede do local, a hora é mantida por NTP ou pela frota; "
+    "o ajuste manual acima só é preciso sem rede. "
+    "Este botão envia períodos, volumes, zonas e listas desta unidade a todas as outras.</p>"
+    "<form action='/fleet/push' method='POST' style='grid-template-columns: 1fr;'>"
+    "<input type='submit' value='Enviar Configuração à Frota'></form></div>"
+    "</body></html>";
+
+const char PAGE_TAIL[] PROGMEM =
+    "</body></html>";
+
+static char pageCacheBuffer[PAGE_CACHE_SIZE];
+PageCache pageCache(pageCacheBuffer, sizeof(pageCacheBuffer));
+
+// Playlist tracks as edited on the page: "3:20, 5, 7" (track[:volume])
+void formatPlaylist(const Playlist& list, char* out, size_t len) {
+    size_t pos = 0;
+    out[0] = '\0';
+    for (int i = 0; i < list.length && pos < len; i++) {
+        const PlaylistEntry& entry = list.entries[i];
+        if (entry.volume == ZONE_VOLUME_MAIN) {
+            pos += snprintf(out + pos, len - pos, "%s%d", i ? ", " : "", entry.track);
+        } else {
+            pos += snprintf(out + pos, len - pos, "%s%d:%d", i ? ", " : "", entry.track, entry.volume);
+        }
+    }
+}
+
+// Parses the format above. Returns false on anything else.
+bool parsePlaylist(const char* text, Playlist& list) {
+    list.length = 0;
+    while (*text) {
+        if (*text == ' ' || *text == ',') {
+            text++;
+            continue;
+        }
+        if (list.length == PLAYLIST_LENGTH || !isdigit((unsigned char)*text)) return false;
+        char* end;
+        long track = strtol(text, &end, 10);
+        long volume = ZONE_VOLUME_MAIN;
+        if (*end == ':') {
+            if (!isdigit((unsigned char)end[1])) return false;
+            volume = strtol(end + 1, &end, 10);
+            if (volume > 30) return false;
+        }
+        if (track < 1 || track > 255 || (*end && *end != ',' && *end != ' ')) return false;
+        PlaylistEntry& entry = list.entries[list.length++];
+        entry.track = track;
+        entry.volume = volume;
+        text = end;
+    }
+    return true;
+}
+
+const char* const WEEKDAY_NAMES[7] = { "Dom", "Seg", "Ter", "Qua", "Qui", "Sex", "Sáb" };
+
+// Short description of the days a period applies to
+void formatWeekdays(uint8_t mask, char* out, size_t len) {
+    if (mask == ALL_WEEKDAYS) {
+        snprintf(out, len, "todos os dias");
+        return;
+    }
+    size_t pos = 0;
+    out[0] = '\0';
+    for (int d = 0; d < 7; d++) {
+        if (mask & (1 << d)) {
+            pos += snprintf(out + pos, len - pos, "%s%s", pos ? " " : "", WEEKDAY_NAMES[d]);
+            if (pos >= len) break;
+        }
+    }
+}
+
+bool RootPage::renderNext() {
+    switch (section_) {
+        case HEAD:
+            emit_P(PAGE_HEAD);
+            section_ = STATUS;
+            return true;
+
+        case STATUS:
+            // STATUS to PERIOD_ITEM only change with the configuration: sent
+            // from the cache when it holds this version
+            if (!config_only_) {
+                const char* cached = pageCache.acquire(configSnapshot.version());
+                if (cached) {
+                    cached_ = true;
+                    emit_P(cached);
+                    section_ = TIMELINE;
+                    return true;
+                }
+            }
+
+            // Current RTC time/date and Amplifier/MP3 state (filled in by app.js)
+            emit("<p>Hora RTC: <strong id='time'>--:--:--</strong> (Hora Local)</p>"
+                 "<p>Data RTC: <strong id='date'>--/--/----</strong></p>"
+                 "<p>AMP / MP3 Player: <strong id='output'>...</strong> (Volume: <span id='volume-now'>-</span>)</p>");
+            if (MAX_ZONES > 1) emit("<p>Zonas ativas: <strong id='zones'>-</strong></p>");
+            emit("<p>Próxima mudança: <strong id='next'>...</strong></p>"
+                 "<p style='font-size: 0.8em;' id='sync'></p>");
+            emitf("<p id='stale' data-config='%lu' hidden>Configuração alterada noutro dispositivo. "
+                  "<a href='/'>Recarregar</a></p></div>", (unsigned long)configSnapshot.version());
+            emit_P(PAGE_VOLUME_OPEN);
+            section_ = VOLUME;
+            return true;
+
+        case VOLUME:
+            emitf("%d</strong>.</p>", alarmConfig.volume);
+            emit_P(PAGE_VOLUME_FORM);
+            section_ = VOLUME_INPUT;
+            return true;
+
+        case VOLUME_INPUT:
+            emitf("%d", alarmConfig.volume);
+            emit_P(PAGE_VOLUME_CLOSE);
+            section_ = SELFTEST;
+            return true;
+
+        case SELFTEST:
+            emitf("%d", alarmConfig.selftest_seconds);
+            emit_P(PAGE_SELFTEST_CLOSE);
+            section_ = ZONE_ITEM;
+            row_ = 0;
+            return true;
+
+        case ZONE_ITEM:
+            // One small form per zone
+            if (row_ < MAX_ZONES) {
+                const ZoneSettings& zone = alarmConfig.zones[row_];
+                char volume[4] = "";
+                if (zone.volume != ZONE_VOLUME_MAIN) snprintf(volume, sizeof(volume), "%d", zone.volume);
+                emitf("<form action='/setzone' method='POST' style='grid-template-columns: 1fr 1fr 1fr;'>"
+                      "<input type='hidden' name='z' value='%d'><label>Zona %d</label>", row_, row_ + 1);
+                emitf("<label>Faixa: <input type='number' name='t' min='1' max='255' value='%d'></label>"
+                      "<label>Volume: <input type='number' name='v' min='0' max='30' value='%s'></label>"
+                      "<input type='submit' value='Salvar Zona'></form>", zone.track, volume);
+                row_++;
+                return true;
+            }
+            emit_P(PAGE_PLAYLISTS_OPEN);
+            section_ = PLAYLIST_ITEM;
+            row_ = 0;
+            return true;
+
+        case PLAYLIST_ITEM:
+            // One form per playlist, in two pieces: tracks, then fades
+            if (row_ < 2 * MAX_PLAYLISTS) {
+                int index = row_ / 2;
+                const Playlist& list = alarmConfig.playlists[index];
+                if (row_ % 2 == 0) {
+                    char tracks[PLAYLIST_LENGTH * 8];
+                    formatPlaylist(list, tracks, sizeof(tracks));
+                    emitf("<form action='/setplaylist' method='POST' style='grid-template-columns: 1fr 1fr;'>"
+                          "<input type='hidden' name='i' value='%d'><h3>Lista %d</h3>"
+                          "<label style='grid-column: 1 / -1;'>Faixas: <input type='text' name='l' value='%s' "
+                          "maxlength='64' style='width: 90%%;'></label>", index, index + 1, tracks);
+                } else {
+                    emitf("<label>Fade-in (s): <input type='number' name='fi' min='0' max='%d' value='%d'></label>"
+                          "<label>Fade-out (s): <input type='number' name='fo' min='0' max='%d' value='%d'></label>"
+                          "<input type='submit' value='Salvar Lista'></form>",
+                          MAX_FADE_SECONDS, list.fade_in_seconds, MAX_FADE_SECONDS, list.fade_out_seconds);
+                }
+                row_++;
+                return true;
+            }
+            emit_P(PAGE_PERIODS_OPEN);
+            section_ = PERIOD_SUMMARY;
+            return true;
+
+        case PERIOD_SUMMARY:
+            if (alarmConfig.num_periods == 0) {
+                emit("<p style='color:red;'>Nenhum período de alarme ativo.</p>");
+            } else {
+                emit("<p>O dispositivo será ativado durante os seguintes períodos:</p><ul>");
+            }
+            section_ = PERIOD_ITEM;
+            row_ = 0;
+            return true;
+
+        case PERIOD_ITEM:
+            if (row_ < alarmConfig.num_periods) {
+                const Period& p = alarmConfig.periods[row_];
+                char days[32];
+                formatWeekdays(p.weekdays, days, sizeof(days));
+                emitf("<li>Período %d: <strong>%02d:%02d</strong> a <strong>%02d:%02d</strong>, %s",
+                      row_ + 1, p.start / 60, p.start % 60, p.end / 60, p.end % 60, days);
+                if (p.from || p.to) {
+                    emitf(", de %02d/%02d a %02d/%02d", packedDay(p.from), packedMonth(p.from),
+                          packedDay(p.to), packedMonth(p.to));
+                }
+                if (MAX_ZONES > 1) emitf(", zona %d", periodZone(p) + 1);
+                if (periodPlaylist(p)) emitf(", lista %d", periodPlaylist(p));
+                if (p.flags & PERIOD_EXCEPTION) emit(" <em>(exceção: desligado)</em>");
+                emitf(" <a href='/?edit=%d'>Editar</a></li>", row_);
+                row_++;
+                return true;
+            }
+            section_ = TIMELINE;
+            return !config_only_;
+
+        case TIMELINE:
+            // Today's timeline drawn from the compiled schedule: one gradient stop per run
+            if (alarmConfig.num_periods > 0) emit("</ul>");
+            emit("<p>Hoje:</p><div style='height: 14px; padding: 0; border-radius: 3px; margin: 0; background: linear-gradient(90deg");
+            section_ = TIMELINE_RUN;
+            row_ = 0; // Start minute of the next run
+            return true;
+
+        case TIMELINE_RUN:
+            if (row_ < MINUTES_PER_DAY) {
+                const DayBitmap& today = pageSchedule.today();
+                int run_end = today.runEnd(row_);
+                emitf(", %s %.2f%% %.2f%%", today.test(row_) ? "#28a745" : "#ddd",
+                      row_ * 100.0f / MINUTES_PER_DAY, run_end * 100.0f / MINUTES_PER_DAY);
+                row_ = run_end;
+                return true;
+            }
+            emit(");'></div>");
+            emit_P(PAGE_TIMELINE_SCALE);
+            section_ = PERIOD_FORM;
+            return true;
+
+        case PERIOD_FORM:
+            // Editor for one period: a new one, or the one selected with ?edit=
+            emit("<form action='/set' method='POST'>");
+            if (edit_index_ >= 0) {
+                emitf("<h3>Editar Período %d</h3>", edit_index_ + 1);
+            } else {
+                emit("<h3>Novo Período</h3>");
+            }
+            emitf("<input type='hidden' name='i' value='%d'>", edit_index_);
+            section_ = PERIOD_START;
+            return true;
+
+        case PERIOD_START:
+            emit("<label>Hora Início:</label><label>Minuto Início:</label>");
+            emitf("<input type='number' name='start_h' min='0' max='23' value='%d'>", edited_.start / 60);
+            emitf("<input type='number' name='start_m' min='0' max='59' value='%d'>", edited_.start % 60);
+            section_ = PERIOD_END;
+            return true;
+
+        case PERIOD_END:
+            emit("<label>Hora Fim:</label><label>Minuto Fim:</label>");
+            emitf("<input type='number' name='end_h' min='0' max='23' value='%d'>", edited_.end / 60);
+            emitf("<input type='number' name='end_m' min='0' max='59' value='%d'>", edited_.end % 60);
+            section_ = PERIOD_DAYS;
+            row_ = 0; // Next weekday checkbox
+            return true;
+
+        case PERIOD_DAYS:
+            // Weekday checkboxes, a few per piece
+            if (row_ == 0) emit("<p style='grid-column: 1 / -1;'>");
+            for (int end = min(row_ + 3, 7); row_ < end; row_++) {
+                emitf("<label><input type='checkbox' name='w%d' value='1'%s>%s</label> ", row_,
+                      (edited_.weekdays & (1 << row_)) ? " checked" : "", WEEKDAY_NAMES[row_]);
+            }
+            if (row_ == 7) {
+                emit("</p>");
+                section_ = PERIOD_DATES;
+            }
+            return true;
+
+        case PERIOD_DATES:
+        case PERIOD_DATES_TO: {
+            // Optional date range; empty fields mean "no date limit"
+            bool is_from = section_ == PERIOD_DATES;
+            uint16_t md = is_from ? edited_.from : edited_.to;
+            char day[4] = "", month[8] = "";
+            if (md) {
+                snprintf(day, sizeof(day), "%d", packedDay(md));
+                snprintf(month, sizeof(month), "%d", packedMonth(md));
+            }
+            if (is_from) emit("<label>Desde (dia/mês):</label><label>Até (dia/mês):</label>");
+            emitf("<span><input type='number' name='%cd' min='1' max='31' value='%s' style='width: 40%%;'>"
+                  "<input type='number' name='%cm' min='1' max='12' value='%s' style='width: 40%%;'></span>",
+                  is_from ? 'f' : 't', day, is_from ? 'f' : 't', month);
+            section_ = is_from ? PERIOD_DATES_TO : PERIOD_TYPE;
+            return true;
+        }
+
+        case PERIOD_TYPE: {
+            bool exception = edited_.flags & PERIOD_EXCEPTION;
+            emit("<label>Tipo:</label><select name='x'>");
+            emitf("<option value='0'%s>Ativação</option>", exception ? "" : " selected");
+            emitf("<option value='1'%s>Exceção (desligado)</option></select>", exception ? " selected" : "");
+            section_ = PERIOD_ZONE;
+            row_ = 0;
+            return true;
+        }
+
+        case PERIOD_ZONE:
+            // Zone selector, only on boards with more than one zone
+            if (MAX_ZONES > 1) {
+                if (row_ == 0) emit("<label>Zona:</label><select name='z'>");
+                for (int end = min(row_ + 4, MAX_ZONES); row_ < end; row_++) {
+                    emitf("<option value='%d'%s>Zona %d</option>", row_,
+                          periodZone(edited_) == row_ ? " selected" : "", row_ + 1);
+                }
+                if (row_ < MAX_ZONES) return true;
+                emit("</select>");
+            }
+            section_ = PERIOD_PLAYLIST;
+            row_ = 0;
+            return true;
+
+        case PERIOD_PLAYLIST:
+            // The zone's track, or one of the playlists
+            if (row_ == 0) {
+                emitf("<label>Som:</label><select name='pl'><option value='0'%s>Faixa da zona</option>",
+                      periodPlaylist(edited_) == 0 ? " selected" : "");
+                row_ = 1;
+            }
+            for (int end = min(row_ + 4, MAX_PLAYLISTS + 1); row_ < end; row_++) {
+                emitf("<option value='%d'%s>Lista %d%s</option>", row_, periodPlaylist(edited_) == row_ ? " selected" : "",
+                      row_, alarmConfig.playlists[row_ - 1].length ? "" : " (vazia)");
+            }
+            if (row_ <= MAX_PLAYLISTS) return true;
+            emit("</select>");
+            emit_P(PAGE_PERIOD_NOTES);
+            section_ = PERIOD_SUBMIT;
+            return true;
+
+        case PERIOD_SUBMIT:
+            emit("<input type='submit' value='Salvar Período'>");
+            if (edit_index_ >= 0) {
+                emit("<input type='submit' name='del' value='Apagar Período' style='background: #dc3545;'>");
+            }
+            emit_P(PAGE_TIME_OPEN);
+            section_ = TIME_INPUTS;
+            return true;
+
+        case TIME_INPUTS:
+            // Prefilled with the controller's time by app.js
+            emit("<input type='number' name='h' min='0' max='23' required>"
+                 "<input type='number' name='m' min='0' max='59' required>"
+                 "<input type='number' name='s' min='0' max='59' required>");
+            emit_P(PAGE_DATE_LABELS);
+            section_ = DATE_INPUTS;
+            return true;
+
+        case DATE_INPUTS:
+            emit("<input type='number' name='d' min='1' max='31' required>"
+                 "<input type='number' name='mon' min='1' max='12' required>"
+                 "<input type='number' name='y' min='2024' max='2100' required>");
+            emit_P(PAGE_TIME_CLOSE);
+            section_ = FLEET;
+            return true;
+
+        case FLEET:
+            // Only with a site network
+            if (sta_ssid[0]) {
+                emitf("<div><h2>Frota (Rede do Local)</h2><p>Unidade: <strong>%08lx</strong></p>",
+                      (unsigned long)fleetUnitId);
+                emit_P(PAGE_FLEET);
+            } else {
+                emit_P(PAGE_TAIL);
+            }
+            section_ = DONE;
+            return true;
+
+        case DONE:
+        default:
+            return false;
+    }
+}
+
+bool ConfigJson::renderNext() {
+    if (row_ >= alarmConfig.num_periods + MAX_PLAYLISTS) return false;
+
+    if (row_ < 0) {
+        emitf("{\"volume\":%d,\"selftest_seconds\":%d,\"zones\":[",
+              alarmConfig.volume, alarmConfig.selftest_seconds);
+        for (int z = 0; z < MAX_ZONES; z++) {
+            const ZoneSettings& zone = alarmConfig.zones[z];
+            if (zone.volume == ZONE_VOLUME_MAIN) {
+                emitf("%s{\"track\":%d,\"volume\":null}", z ? "," : "", zone.track);
+            } else {
+                emitf("%s{\"track\":%d,\"volume\":%d}", z ? "," : "", zone.track, zone.volume);
+            }
+        }
+        emit("],\"periods\":[");
+    } else if (row_ < alarmConfig.num_periods) {
+        const Period& p = alarmConfig.periods[row_];
+        char buffer[160];
+        char text[8];
+        JsonWriter json(buffer, sizeof(buffer));
+        json.beginObject();
+        snprintf(text, sizeof(text), "%02d:%02d", p.start / 60, p.start % 60);
+        json.addString("start", text);
+        snprintf(text, sizeof(text), "%02d:%02d", p.end / 60, p.end % 60);
+        json.addString("end", text);
+        json.addNumber("days", p.weekdays);
+        if (p.from) {
+            snprintf(text, sizeof(text), "%02d-%02d", packedMonth(p.from), packedDay(p.from));
+            json.addString("from", text);
+            snprintf(text, sizeof(text), "%02d-%02d", packedMonth(p.to), packedDay(p.to));
+            json.addString("to", text);
+        }
+        json.addBool("exc", p.flags & PERIOD_EXCEPTION);
+        json.addNumber("zone", periodZone(p) + 1);
+        if (periodPlaylist(p)) json.addNumber("playlist", periodPlaylist(p));
+        json.endObject();
+        if (row_ > 0) emit(",");
+        emit(json.c_str());
+    } else {
+        int index = row_ - alarmConfig.num_periods;
+        const Playlist& list = alarmConfig.playlists[index];
+        emitf("%s{\"fade_in\":%d,\"fade_out\":%d,\"tracks\":[", index ? "," : "],\"playlists\":[",
+              list.fade_in_seconds, list.fade_out_seconds);
+        for (int i = 0; i < list.length; i++) {
+            const PlaylistEntry& entry = list.entries[i];
+            if (entry.volume == ZONE_VOLUME_MAIN) {
+                emitf("%s{\"track\":%d,\"volume\":null}", i ? "," : "", entry.track);
+            } else {
+                emitf("%s{\"track\":%d,\"volume\":%d}", i ? "," : "", entry.track, entry.volume);
+            }
+        }
+        emit(index == MAX_PLAYLISTS - 1 ? "]}]}" : "]}");
+    }
+    row_++;
+    return true;
+}
@@ -0,0 +1,85 @@
+/*
+ * Pages of the GRAVE Controller web interface.
+ *
+ * RootPage renders the main page and ConfigJson the /api/config body, both
+ * through PageStream straight from the configuration being edited. The
+ * sketch's handlers add the ETags and the page cache around them; the boot
+ * benchmarks (bench.h) read them to the end, on the device and on the host.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include "alarm_config.h"
+#include "html_stream.h"
+#include "schedule.h"
+#include "shared_state.h"
+
+
+// Configuration part of the main page, as last rendered (see RootPage). With
+// about 30 periods and every playlist filled it no longer fits, and pages
+// are then rendered in full.
+#define PAGE_CACHE_SIZE 12288
+
+extern PageCache pageCache;
+
+// Sketch state the pages read (network task)
+extern AlarmData alarmConfig;
+extern ScheduleEngine pageSchedule; // Must be updated for today
+extern Snapshot<AlarmData> configSnapshot;
+extern const char* sta_ssid;
+extern uint32_t fleetUnitId;
+
+// Main page, rendered one section (or one period row) at a time
+// The live values (time, output state) are placeholders filled in by app.js
+// from /api/status, so the HTML only changes with the configuration and the
+// day, and the browser can keep it cached between visits.
+class RootPage : public PageStream {
+public:
+    // edit_index selects the period loaded in the editor (-1 = new period).
+    // config_only renders just the configuration sections, for pageCache.
+    RootPage(int edit_index, bool config_only = false) : edit_index_(edit_index), config_only_(config_only) {
+        if (edit_index_ >= 0) edited_ = alarmConfig.periods[edit_index_];
+        if (config_only_) section_ = STATUS;
+    }
+    ~RootPage() override {
+        if (cached_) pageCache.release();
+    }
+
+protected:
+    bool renderNext() override;
+
+private:
+    enum Section {
+        HEAD, STATUS, VOLUME, VOLUME_INPUT, SELFTEST, ZONE_ITEM, PLAYLIST_ITEM, PERIOD_SUMMARY, PERIOD_ITEM,
+        TIMELINE, TIMELINE_RUN, PERIOD_FORM, PERIOD_START, PERIOD_END, PERIOD_DAYS, PERIOD_DATES,
+        PERIOD_DATES_TO, PERIOD_TYPE, PERIOD_ZONE, PERIOD_PLAYLIST, PERIOD_SUBMIT, TIME_INPUTS, DATE_INPUTS,
+        FLEET, DONE
+    };
+
+    int edit_index_;
+    bool config_only_;
+    bool cached_ = false; // Holds pageCache
+    Period edited_; // Values shown in the period editor
+    Section section_ = HEAD;
+    int row_ = 0;
+};
+
+// /api/config body: the header, then one period per piece, then one playlist per piece
+class ConfigJson : public PageStream {
+protected:
+    bool renderNext() override;
+
+private:
+    int row_ = -1; // -1 = header, then periods, then playlists
+};
+
+// Playlist tracks as edited on the page: "3:20, 5, 7" (track[:volume])
+void formatPlaylist(const Playlist& list, char* out, size_t len);
+
+// Parses the format above. Returns false on anything else.
+bool parsePlaylist(const char* text, Playlist& list);
+
+extern const char* const WEEKDAY_NAMES[7];
+
+// Short description of the days a period applies to
+void formatWeekdays(uint8_t mask, char* out, size_t len);
@@ -0,0 +1,63 @@
+/*
+ * Power saving for battery and solar powered units.
+ */
+#include "power.h"
+#include <driver/gpio.h>
+#include <esp_sleep.h>
+
+static volatile bool pressed = false;
+static uint8_t isr_pin = 0;
+
+// Level interrupt (the only kind that wakes from light sleep): disarmed until
+// buttonPressed() sees the button released
+void IRAM_ATTR PowerManager::onButton() {
+    gpio_intr_disable((gpio_num_t)isr_pin);
+    pressed = true;
+}
+
+void PowerManager::begin(uint8_t button_pin) {
+    button_pin_ = button_pin;
+    isr_pin = button_pin;
+    pinMode(button_pin, INPUT_PULLUP);
+    attachInterrupt(button_pin, onButton, ONLOW);
+    gpio_wakeup_enable((gpio_num_t)button_pin, GPIO_INTR_LOW_LEVEL);
+    esp_sleep_enable_gpio_wakeup();
+
+    esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "outputs", &lock_);
+
+    esp_pm_config_t config = {};
+    config.max_freq_mhz = POWER_CPU_MAX_MHZ;
+    config.min_freq_mhz = POWER_CPU_MIN_MHZ;
+    config.light_sleep_enable = true;
+    esp_err_t err = esp_pm_configure(&config);
+    if (err == ESP_ERR_NOT_SUPPORTED) {
+        config.light_sleep_enable = false;
+        err = esp_pm_configure(&config);
+    }
+    light_sleep_ = err == ESP_OK && config.light_sleep_enable;
+    Serial.printf("[POWER] %d-%d MHz, light sleep %s (%s)\n", POWER_CPU_MIN_MHZ, POWER_CPU_MAX_MHZ,
+                  light_sleep_ ? "on" : "off", esp_err_to_name(err));
+}
+
+void PowerManager::setBusy(bool busy) {
+    if (busy == busy_ || !lock_) return;
+    busy_ = busy;
+    if (busy) {
+        esp_pm_lock_acquire(lock_);
+    } else {
+        esp_pm_lock_release(lock_);
+    }
+}
+
+bool PowerManager::buttonPressed() {
+    if (!pressed) return false;
+    bool first = !reported_;
+    reported_ = true;
+    if (digitalRead(button_pin_) == HIGH) {
+        // Released: rearmed for the next press
+        reported_ = false;
+        pressed = false;
+        gpio_intr_enable((gpio_num_t)button_pin_);
+    }
+    return first;
+}
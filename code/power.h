@@ -0,0 +1,51 @@
+/*
+ * Power saving for battery and solar powered units (POWER_SAVE_ENABLED).
+ *
+ * The CPU scales its clock down and enters automatic light sleep whenever
+ * every task is blocked; the scheduler's wake-up timer, the button and the
+ * Wi-Fi driver wake it again. While any output is on (a period or the
+ * self-test), a PM lock keeps it out of light sleep, so the MP3 UART keeps
+ * receiving. In off-periods, status frames from the module may be missed.
+ *
+ * The radio draws most of the rest. The firmware keeps the access point up
+ * for POWER_AP_AWAKE_MS after boot and after each press of the button, during
+ * active periods and while a client is associated, and switches it off
+ * otherwise. A station on the site network then drops to modem sleep.
+ *
+ * Light sleep needs an SDK built with tickless idle. Without it,
+ * begin() falls back to frequency scaling only.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <esp_pm.h>
+
+#define POWER_SAVE_ENABLED 0
+#define POWER_CPU_MAX_MHZ 160
+#define POWER_CPU_MIN_MHZ 40                  // Crystal frequency
+#define POWER_AP_AWAKE_MS (15 * 60 * 1000UL)  // Access point window after boot or a button press
+#define POWER_IDLE_POLL_MS 500                // Network task sleep while the access point is off
+
+class PowerManager {
+public:
+    // Configures frequency scaling and light sleep. The button (active LOW)
+    // wakes the CPU and is reported by buttonPressed().
+    void begin(uint8_t button_pin);
+
+    // Keeps the CPU out of light sleep while busy (outputs on)
+    void setBusy(bool busy);
+
+    // True once for each press since the last call; call regularly
+    bool buttonPressed();
+
+    bool lightSleep() const { return light_sleep_; }
+
+private:
+    static void IRAM_ATTR onButton();
+
+    esp_pm_lock_handle_t lock_ = nullptr;
+    uint8_t button_pin_ = 0;
+    bool busy_ = false;
+    bool light_sleep_ = false;
+    bool reported_ = false;
+};
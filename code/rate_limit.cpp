@@ -0,0 +1,53 @@
+/*
+ * Request admission for the web interface: a token bucket per client.
+ */
+#include "rate_limit.h"
+
+#define TOKEN 1000
+
+// Adds the tokens earned since the last refill, up to the burst size
+static uint32_t refill(uint32_t tokens, unsigned long elapsed_ms, uint32_t per_min, uint32_t burst) {
+    uint64_t earned = (uint64_t)elapsed_ms * per_min * TOKEN / 60000;
+    return (uint32_t)min((uint64_t)tokens + earned, (uint64_t)burst * TOKEN);
+}
+
+// Seconds until `tokens` grows to one token
+static uint32_t waitFor(uint32_t tokens, uint32_t per_min) {
+    return ((TOKEN - tokens) * 60 + per_min * TOKEN - 1) / (per_min * TOKEN);
+}
+
+RateLimiter::Client* RateLimiter::find(uint32_t addr, unsigned long now) {
+    Client* idlest = &clients_[0];
+    for (int i = 0; i < num_clients_; i++) {
+        if (clients_[i].addr == addr) return &clients_[i];
+        if (now - clients_[i].updated_ms > now - idlest->updated_ms) idlest = &clients_[i];
+    }
+
+    Client* client = num_clients_ < RATE_MAX_CLIENTS ? &clients_[num_clients_++] : idlest;
+    client->addr = addr;
+    client->requests = RATE_REQUEST_BURST * TOKEN;
+    client->writes = RATE_WRITE_BURST * TOKEN;
+    client->updated_ms = now;
+    return client;
+}
+
+uint32_t RateLimiter::admit(uint32_t addr, bool write) {
+    unsigned long now = millis();
+    Client* client = find(addr, now);
+    unsigned long elapsed = now - client->updated_ms;
+    client->requests = refill(client->requests, elapsed, RATE_REQUESTS_PER_MIN, RATE_REQUEST_BURST);
+    client->writes = refill(client->writes, elapsed, RATE_WRITES_PER_MIN, RATE_WRITE_BURST);
+    client->updated_ms = now;
+
+    uint32_t wait = 0;
+    if (client->requests < TOKEN) wait = waitFor(client->requests, RATE_REQUESTS_PER_MIN);
+    if (write && client->writes < TOKEN) wait = max(wait, waitFor(client->writes, RATE_WRITES_PER_MIN));
+    if (wait) {
+        rejected_++;
+        return wait;
+    }
+
+    client->requests -= TOKEN;
+    if (write) client->writes -= TOKEN;
+    return 0;
+}
@@ -0,0 +1,46 @@
+/*
+ * Request admission for the web interface: a token bucket per client.
+ *
+ * Every request takes a token from its client's bucket, and a POST (a
+ * configuration change, an upload) also takes one from a second, slower
+ * bucket. Buckets refill at a steady rate up to their burst size, so a page
+ * load and a few edits always get through, while a client that keeps
+ * reloading or submitting is answered 429 as soon as its headers are in,
+ * before any handler runs or its body is read.
+ *
+ * Clients are told apart by IPv4 address. The table holds the last
+ * RATE_MAX_CLIENTS seen; a new client takes the slot that was idle longest,
+ * with a full bucket.
+ */
+#pragma once
+
+#include <Arduino.h>
+
+#define RATE_MAX_CLIENTS 8
+#define RATE_REQUEST_BURST 30     // Requests a client can make at once...
+#define RATE_REQUESTS_PER_MIN 120 // ...and on average
+#define RATE_WRITE_BURST 10       // Same for POSTs
+#define RATE_WRITES_PER_MIN 20
+
+class RateLimiter {
+public:
+    // Takes the tokens for a request from `client`. Returns 0 if it is
+    // admitted, else the seconds until it would be (for Retry-After).
+    uint32_t admit(uint32_t client, bool write);
+
+    uint32_t rejected() const { return rejected_; }
+
+private:
+    struct Client {
+      uint32_t addr;
+      uint32_t requests; // Tokens, in thousandths
+      uint32_t writes;
+      unsigned long updated_ms;
+    };
+
+    Client* find(uint32_t addr, unsigned long now);
+
+    Client clients_[RATE_MAX_CLIENTS] = {};
+    int num_clients_ = 0;
+    uint32_t rejected_ = 0;
+};
@@ -0,0 +1,301 @@
+/*
+ * Schedule engine.
+ */
+#include "schedule.h"
+
+// --- DAY BITMAP ---
+
+void DayBitmap::setRange(int from, int to) {
+    while (from < to && (from & 31) != 0) {
+        words_[from >> 5] |= 1UL << (from & 31);
+        from++;
+    }
+    // Whole words at once
+    while (to - from >= 32) {
+        words_[from >> 5] = 0xFFFFFFFF;
+        from += 32;
+    }
+    while (from < to) {
+        words_[from >> 5] |= 1UL << (from & 31);
+        from++;
+    }
+}
+
+void DayBitmap::clearRange(int from, int to) {
+    while (from < to && (from & 31) != 0) {
+        words_[from >> 5] &= ~(1UL << (from & 31));
+        from++;
+    }
+    while (to - from >= 32) {
+        words_[from >> 5] = 0;
+        from += 32;
+    }
+    while (from < to) {
+        words_[from >> 5] &= ~(1UL << (from & 31));
+        from++;
+    }
+}
+
+void DayBitmap::merge(const DayBitmap& mask) {
+    for (int i = 0; i < WORDS; i++) {
+        words_[i] |= mask.words_[i];
+    }
+}
+
+int DayBitmap::runEnd(int from) const {
+    int word = from >> 5;
+    // Invert the words so that we always look for the next set bit
+    uint32_t flip = test(from) ? 0xFFFFFFFF : 0;
+    uint32_t bits = (words_[word] ^ flip) & (0xFFFFFFFF << (from & 31));
+
+    while (bits == 0) {
+        if (++word == WORDS) return MINUTES_PER_DAY;
+        bits = words_[word] ^ flip;
+    }
+    return (word << 5) + __builtin_ctz(bits);
+}
+
+// --- CALENDAR HELPERS ---
+
+static bool isLeapYear(int year) {
+    return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+static int daysInMonth(int year, int month) {
+    static const uint8_t DAYS[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    return (month == 2 && isLeapYear(year)) ? 29 : DAYS[month - 1];
+}
+
+int weekdayOf(const ScheduleDate& date) {
+    // Sakamoto's method
+    static const uint8_t OFFSETS[12] = { 0, 3, 2, 5, 0, 3, 5, 1, 4, 6, 2, 4 };
+    int y = date.year - (date.month < 3 ? 1 : 0);
+    return (y + y / 4 - y / 100 + y / 400 + OFFSETS[date.month - 1] + date.day) % 7;
+}
+
+ScheduleDate nextDay(const ScheduleDate& date) {
+    ScheduleDate d = date;
+    if (++d.day > daysInMonth(d.year, d.month)) {
+        d.day = 1;
+        if (++d.month > 12) {
+            d.month = 1;
+            d.year++;
+        }
+    }
+    return d;
+}
+
+ScheduleDate previousDay(const ScheduleDate& date) {
+    ScheduleDate d = date;
+    if (--d.day < 1) {
+        if (--d.month < 1) {
+            d.month = 12;
+            d.year--;
+        }
+        d.day = daysInMonth(d.year, d.month);
+    }
+    return d;
+}
+
+// --- PERIOD RECORDS ---
+
+void sortPeriods(AlarmData& config) {
+    // Insertion sort: the list is short and already sorted except for the edited entry
+    for (int i = 1; i < config.num_periods; i++) {
+        Period p = config.periods[i];
+        int j = i - 1;
+        while (j >= 0 && (config.periods[j].start > p.start ||
+                          (config.periods[j].start == p.start && config.periods[j].end > p.end))) {
+            config.periods[j + 1] = config.periods[j];
+            j--;
+        }
+        config.periods[j + 1] = p;
+    }
+}
+
+// True if the period starts on `date` (weekday mask and date range)
+static bool startsOn(const Period& p, const ScheduleDate& date, int weekday) {
+    if (!(p.weekdays & (1 << weekday))) return false;
+    if (p.from == 0 && p.to == 0) return true;
+
+    uint16_t md = packMonthDay(date.month, date.day);
+    uint16_t from = p.from ? p.from : packMonthDay(1, 1);
+    uint16_t to = p.to ? p.to : packMonthDay(12, 31);
+
+    if (from <= to) return md >= from && md <= to;
+    return md >= from || md <= to; // Range wraps over New Year
+}
+
+// --- SCHEDULE ENGINE ---
+
+void ScheduleEngine::load(const AlarmData& config) {
+    config_ = &config;
+    dirty_ = true;
+}
+
+void ScheduleEngine::update(const ScheduleDate& today) {
+    if (!dirty_ && today == date_) return;
+
+    if (!dirty_ && today == nextDay(date_)) {
+        // Midnight: tomorrow's bitmaps are already compiled
+        memcpy(today_, tomorrow_, sizeof(today_));
+        any_today_ = any_tomorrow_;
+    } else {
+        compileDay(today, today_, any_today_);
+    }
+    compileDay(nextDay(today), tomorrow_, any_tomorrow_);
+
+    date_ = today;
+    dirty_ = false;
+}
+
+ZoneMask ScheduleEngine::activeZones(int minute) const {
+    const DayBitmap* day = today_;
+    if (minute >= MINUTES_PER_DAY) {
+        day = tomorrow_;
+        minute -= MINUTES_PER_DAY;
+    }
+    ZoneMask mask = 0;
+    for (int z = 0; z < MAX_ZONES; z++) {
+        if (day[z].test(minute)) mask |= 1 << z;
+    }
+    return mask;
+}
+
+int ScheduleEngine::periodAt(int zone, int minute) const {
+    if (config_ == nullptr || !(activeZones(minute) & (1 << zone))) return -1;
+
+    ScheduleDate date = date_;
+    if (minute >= MINUTES_PER_DAY) {
+        date = nextDay(date_);
+        minute -= MINUTES_PER_DAY;
+    }
+    ScheduleDate yesterday = previousDay(date);
+    int weekday = weekdayOf(date);
+    int yesterday_weekday = (weekday + 6) % 7;
+
+    for (int i = 0; i < config_->num_periods; i++) {
+        const Period& p = config_->periods[i];
+        if ((p.flags & PERIOD_EXCEPTION) || periodZone(p) != zone) continue;
+        if (p.start < p.end) {
+            if (minute >= p.start && minute < p.end && startsOn(p, date, weekday)) return i;
+        } else if (p.start > p.end) {
+            if (minute >= p.start && startsOn(p, date, weekday)) return i;
+            if (minute < p.end && startsOn(p, yesterday, yesterday_weekday)) return i;
+        }
+    }
+    return -1;
+}
+
+static int nextTransition(const DayBitmap& today, const DayBitmap& tomorrow, int minute) {
+    bool state = today.test(minute);
+
+    int end = today.runEnd(minute);
+    if (end < MINUTES_PER_DAY) return end - minute;
+
+    // Same state until midnight: continue into tomorrow
+    if (tomorrow.test(0) != state) return MINUTES_PER_DAY - minute;
+    end = tomorrow.runEnd(0);
+    if (end < MINUTES_PER_DAY) return MINUTES_PER_DAY - minute + end;
+
+    return -1;
+}
+
+int ScheduleEngine::minutesToNextTransition(int minute) const {
+    return nextTransition(any_today_, any_tomorrow_, minute);
+}
+
+int ScheduleEngine::minutesToNextZoneChange(int minute) const {
+    int first = -1;
+    for (int z = 0; z < MAX_ZONES; z++) {
+        int minutes = nextTransition(today_[z], tomorrow_[z], minute);
+        if (minutes >= 0 && (first < 0 || minutes < first)) first = minutes;
+    }
+    return first;
+}
+
+// Marks a period's minutes of `date` in `target`, via set or clear
+template <typename Mark>
+static void markPeriod(const Period& p, const ScheduleDate& date, int weekday,
+                       const ScheduleDate& yesterday, int yesterday_weekday, Mark mark) {
+    if (p.start < p.end) {
+        // Period within the same day
+        if (startsOn(p, date, weekday)) mark(p.start, p.end);
+    } else if (p.start > p.end) {
+        // Overnight period: evening of the start day, morning of the next one
+        if (startsOn(p, date, weekday)) mark(p.start, MINUTES_PER_DAY);
+        if (startsOn(p, yesterday, yesterday_weekday)) mark(0, p.end);
+    } else if (p.flags & PERIOD_EXCEPTION) {
+        // Whole-day exception
+        if (startsOn(p, date, weekday)) mark(0, MINUTES_PER_DAY);
+    }
+}
+
+// One sweep over the periods sets each one in its zone's bitmap; a second
+// one, only if there are exceptions, clears theirs (exceptions win over any
+// activation period of their zone).
+void ScheduleEngine::compileDay(const ScheduleDate& date, DayBitmap* zones, DayBitmap& any) const {
+    any.clear();
+    for (int z = 0; z < MAX_ZONES; z++) zones[z].clear();
+    if (config_ == nullptr) return;
+
+    ScheduleDate yesterday = previousDay(date);
+    int weekday = weekdayOf(date);
+    int yesterday_weekday = (weekday + 6) % 7;
+
+    bool has_exceptions = false;
+    for (int i = 0; i < config_->num_periods; i++) {
+        const Period& p = config_->periods[i];
+        if (p.flags & PERIOD_EXCEPTION) {
+            has_exceptions = true;
+            continue;
+        }
+        DayBitmap& target = zones[periodZone(p)];
+        markPeriod(p, date, weekday, yesterday, yesterday_weekday,
+                   [&target](int from, int to) { target.setRange(from, to); });
+    }
+
+    if (has_exceptions) {
+        for (int i = 0; i < config_->num_periods; i++) {
+            const Period& p = config_->periods[i];
+            if (!(p.flags & PERIOD_EXCEPTION)) continue;
+            DayBitmap& target = zones[periodZone(p)];
+            markPeriod(p, date, weekday, yesterday, yesterday_weekday,
+                       [&target](int from, int to) { target.clearRange(from, to); });
+        }
+    }
+
+    for (int z = 0; z < MAX_ZONES; z++) any.merge(zones[z]);
+}
+
+// --- WAKE-UP PLANNING ---
+
+WakePlan planWake(const ScheduleEngine& engine, int64_t now_us, const WakeInputs& inputs) {
+    WakePlan plan = {};
+    plan.clock_us = inputs.resync_at_us - now_us;
+
+    int64_t us_of_day = now_us % 86400000000LL;
+    int now_in_minutes = us_of_day / 60000000;
+    int minutes = engine.minutesToNextZoneChange(now_in_minutes);
+    if (minutes >= 0) {
+        int at = now_in_minutes + minutes;
+        int64_t us = (int64_t)at * 60000000 - us_of_day + TRANSITION_MARGIN_US;
+        uint32_t key = now_us / 60000000 + minutes;
+        int64_t lead = inputs.lead ? (int64_t)inputs.lead(at) * 1000 : 0;
+        if (lead && key != inputs.prepared) {
+            if (us <= lead) {
+                plan.prepare = key;
+                plan.prepare_minute = at;
+            } else {
+                us -= lead;
+            }
+        }
+        if (us < plan.clock_us) plan.clock_us = us;
+    }
+    if (inputs.selftest_us >= 0 && inputs.selftest_us < plan.clock_us) plan.clock_us = inputs.selftest_us;
+
+    // Clock time to timer time
+    plan.timer_us = plan.clock_us - plan.clock_us * inputs.rate_ppb / 1000000000LL;
+    if (plan.timer_us < 1) plan.timer_us = 1;
+    return plan;
+}
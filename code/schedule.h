@@ -0,0 +1,138 @@
+/*
+ * Schedule engine.
+ *
+ * The period records (sorted by start minute) are compiled into one bit per
+ * minute and zone for the current day and the next one, taking weekday
+ * masks, date ranges and exceptions into account. "Which zones are active
+ * now?" is then one bit test per zone and "next transition?" a bounded word
+ * scan over at most two days, no matter how many periods exist.
+ * Recompilation only happens when the configuration or the date changes.
+ * The web page draws its day timeline from the union of the zones.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include "alarm_config.h"
+
+#define MINUTES_PER_DAY 1440
+
+class DayBitmap {
+public:
+    static const int WORDS = MINUTES_PER_DAY / 32; // 45 words = 180 bytes
+
+    void clear() { memset(words_, 0, sizeof(words_)); }
+
+    bool test(int minute) const {
+        return (words_[minute >> 5] >> (minute & 31)) & 1;
+    }
+
+    // Marks minutes [from, to) as active (from <= to)
+    void setRange(int from, int to);
+
+    // Marks minutes [from, to) as inactive (from <= to)
+    void clearRange(int from, int to);
+
+    // Sets every minute that is set in mask
+    void merge(const DayBitmap& mask);
+
+    // First minute after `from` whose state differs from `from`,
+    // or MINUTES_PER_DAY if the state does not change until midnight.
+    int runEnd(int from) const;
+
+private:
+    uint32_t words_[WORDS] = {};
+};
+
+// Calendar date as read from the RTC
+struct ScheduleDate {
+    int16_t year = 2000;
+    int8_t month = 1;
+    int8_t day = 1;
+
+    bool operator==(const ScheduleDate& o) const {
+        return year == o.year && month == o.month && day == o.day;
+    }
+    bool operator!=(const ScheduleDate& o) const { return !(*this == o); }
+};
+
+int weekdayOf(const ScheduleDate& date); // 0 = Sunday, same as the RTC
+ScheduleDate nextDay(const ScheduleDate& date);
+ScheduleDate previousDay(const ScheduleDate& date);
+
+// Keeps the records ordered by start minute (then end minute)
+void sortPeriods(AlarmData& config);
+
+class ScheduleEngine {
+public:
+    // Uses the periods of config, which must outlive the engine or be
+    // loaded again after every change.
+    void load(const AlarmData& config);
+
+    // Makes `today` the current day, recompiling if the date or the
+    // configuration changed since the last call.
+    void update(const ScheduleDate& today);
+
+    // Zones with an active period at `minute` of today (or of tomorrow,
+    // as minute - MINUTES_PER_DAY)
+    ZoneMask activeZones(int minute) const;
+
+    // Index in the configuration of the first period that keeps `zone` on
+    // at `minute` (same range as activeZones), or -1. Scans the periods:
+    // meant for transitions, not for every tick.
+    int periodAt(int zone, int minute) const;
+
+    // True if any zone is active
+    bool isActive(int minute) const { return any_today_.test(minute); }
+
+    // Minutes from `minute` until "any zone active" next changes, looking at
+    // today and tomorrow. Returns -1 if it does not change within that window.
+    int minutesToNextTransition(int minute) const;
+
+    // Same, for the first change of any single zone
+    int minutesToNextZoneChange(int minute) const;
+
+    const DayBitmap& today() const { return any_today_; } // Union of the zones
+    const DayBitmap& today(int zone) const { return today_[zone]; }
+
+private:
+    void compileDay(const ScheduleDate& date, DayBitmap* zones, DayBitmap& any) const;
+
+    const AlarmData* config_ = nullptr;
+    bool dirty_ = true;
+    ScheduleDate date_;
+    DayBitmap today_[MAX_ZONES];
+    DayBitmap tomorrow_[MAX_ZONES];
+    DayBitmap any_today_;
+    DayBitmap any_tomorrow_;
+};
+
+// --- WAKE-UP PLANNING ---
+// When the scheduler task looks at the engine next, as a pure function of
+// the engine and the clock, so the benchmarks replay exactly what the
+// scheduler does.
+
+#define TRANSITION_MARGIN_US 200 // Wake just after the minute boundary
+
+// Milliseconds before the zone change at `minute` (as for activeZones) at
+// which the player needs attention, 0 if it does not
+typedef uint32_t (*TransitionLead)(int minute);
+
+struct WakeInputs {
+  int64_t resync_at_us; // Clock time of the next RTC resync
+  int32_t rate_ppb;     // Rate correction of the clock (see SoftClock::rate)
+  TransitionLead lead;  // nullptr: no early wake-ups (self-test)
+  uint32_t prepared;    // Transition already prepared, as WakePlan::prepare
+  int64_t selftest_us;  // Clock time left in the self-test, -1 if none runs
+};
+
+struct WakePlan {
+  int64_t clock_us;   // Clock time until the scheduler looks again
+  int64_t timer_us;   // The same in system timer time, at least 1
+  uint32_t prepare;   // Transition to prepare the player for now (minutes since 2000-01-01), 0 if none
+  int prepare_minute; // Its minute, as for activeZones
+};
+
+// Wakes TRANSITION_MARGIN_US after the next zone change, or for the resync
+// or the end of the self-test if earlier. A transition with a lead gets an
+// earlier wake-up; once within that lead, the plan says to prepare it now.
+WakePlan planWake(const ScheduleEngine& engine, int64_t now_us, const WakeInputs& inputs);
@@ -0,0 +1,42 @@
+/*
+ * State shared between the GRAVE Controller FreeRTOS tasks.
+ *
+ * Each Snapshot has exactly one writer task. Readers always get a complete
+ * copy of the last published value and can check the version counter,
+ * without locking, to see whether anything changed since their last copy.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+
+template <typename T>
+class Snapshot {
+public:
+    // Must be called once before the tasks that share the snapshot start.
+    void begin() { lock_ = xSemaphoreCreateMutex(); }
+
+    // Replaces the shared value and bumps the version.
+    void publish(const T& value) {
+        xSemaphoreTake(lock_, portMAX_DELAY);
+        value_ = value;
+        version_.store(version_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        xSemaphoreGive(lock_);
+    }
+
+    // Copies the current value into out. Returns the version that was copied.
+    uint32_t read(T& out) const {
+        xSemaphoreTake(lock_, portMAX_DELAY);
+        out = value_;
+        uint32_t v = version_.load(std::memory_order_relaxed);
+        xSemaphoreGive(lock_);
+        return v;
+    }
+
+    uint32_t version() const { return version_.load(std::memory_order_acquire); }
+
+private:
+    SemaphoreHandle_t lock_ = nullptr;
+    T value_;
+    std::atomic<uint32_t> version_{0};
+};
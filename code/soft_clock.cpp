@@ -0,0 +1,170 @@
+/*
+ * Software clock anchored to the Unit RTC.
+ */
+#include "soft_clock.h"
+#include <esp_timer.h>
+
+// --- CALENDAR CONVERSIONS ---
+// Days since 2000-01-01 (civil calendar, valid from year 2000 on)
+
+static int32_t daysFromCivil(int year, int month, int day) {
+    year -= month <= 2;
+    int32_t era = year / 400;
+    int32_t yoe = year - era * 400;
+    int32_t doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 730425; // 730425 = days from 0000-03-01 to 2000-01-01
+}
+
+static void civilFromDays(int32_t days, int& year, int& month, int& day) {
+    days += 730425;
+    int32_t era = days / 146097;
+    int32_t doe = days - era * 146097;
+    int32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int32_t mp = (5 * doy + 2) / 153;
+    day = doy - (153 * mp + 2) / 5 + 1;
+    month = mp < 10 ? mp + 3 : mp - 9;
+    year = yoe + era * 400 + (month <= 2);
+}
+
+uint32_t clockSecondsOf(const rtc_time_type& time, const rtc_date_type& date) {
+    int32_t days = daysFromCivil(date.Year, constrain(date.Month, 1, 12), constrain(date.Date, 1, 31));
+    if (days < 0) days = 0;
+    return days * 86400UL + time.Hours * 3600UL + time.Minutes * 60UL + time.Seconds;
+}
+
+void clockToRtc(uint32_t seconds, rtc_time_type& time, rtc_date_type& date) {
+    int32_t days = seconds / 86400UL;
+    uint32_t rest = seconds % 86400UL;
+    time.Hours = rest / 3600;
+    time.Minutes = (rest / 60) % 60;
+    time.Seconds = rest % 60;
+
+    int year, month, day;
+    civilFromDays(days, year, month, day);
+    date.Year = year;
+    date.Month = month;
+    date.Date = day;
+    date.WeekDay = (days + 6) % 7; // 2000-01-01 was a Saturday
+}
+
+// --- SOFT CLOCK ---
+
+int64_t SoftClock::at(int64_t timer) const {
+    int64_t elapsed = timer - timer_us_;
+    return base_us_ + elapsed + elapsed * rate_ppb_ / 1000000000LL;
+}
+
+void SoftClock::anchor(const rtc_time_type& time, const rtc_date_type& date) {
+    int64_t base = (int64_t)clockSecondsOf(time, date) * 1000000;
+    int64_t timer = esp_timer_get_time();
+
+    portENTER_CRITICAL(&lock_);
+    base_us_ = base;
+    timer_us_ = timer;
+    rtc_timer_us_ = timer;
+    disciplined_ = false;
+    set_ = true;
+    portEXIT_CRITICAL(&lock_);
+}
+
+int32_t SoftClock::resync(const rtc_time_type& time, const rtc_date_type& date) {
+    int64_t rtc_us = (int64_t)clockSecondsOf(time, date) * 1000000;
+    int64_t timer = esp_timer_get_time();
+    int64_t correction_us = 0;
+
+    portENTER_CRITICAL(&lock_);
+    int64_t predicted = at(timer);
+    bool disciplined = disciplined_ && timer - external_timer_us_ < (int64_t)CLOCK_HOLDOVER_MS * 1000;
+    // The RTC reading means "somewhere within [rtc_us, rtc_us + 1 s)"
+    if (!set_) {
+        correction_us = 0;
+        predicted = rtc_us;
+    } else if (predicted < rtc_us) {
+        correction_us = rtc_us - predicted;
+    } else if (predicted >= rtc_us + 1000000) {
+        correction_us = rtc_us + 999999 - predicted;
+    }
+    rtc_timer_us_ = timer;
+    if (disciplined) {
+        // The RTC is the one to correct
+        portEXIT_CRITICAL(&lock_);
+        return -correction_us / 1000;
+    }
+    disciplined_ = false;
+    base_us_ = predicted + correction_us;
+    timer_us_ = timer;
+    set_ = true;
+    last_correction_ms_ = correction_us / 1000;
+    total_correction_ms_ += last_correction_ms_;
+    portEXIT_CRITICAL(&lock_);
+
+    return correction_us / 1000;
+}
+
+void SoftClock::step(int64_t offset_us) {
+    int64_t timer = esp_timer_get_time();
+    portENTER_CRITICAL(&lock_);
+    base_us_ = at(timer) + offset_us;
+    timer_us_ = timer;
+    external_timer_us_ = timer;
+    disciplined_ = true;
+    set_ = true;
+    last_correction_ms_ = offset_us / 1000;
+    total_correction_ms_ += last_correction_ms_;
+    portEXIT_CRITICAL(&lock_);
+}
+
+void SoftClock::setRate(int32_t ppb) {
+    int64_t timer = esp_timer_get_time();
+    portENTER_CRITICAL(&lock_);
+    base_us_ = at(timer); // The new rate applies from now on
+    timer_us_ = timer;
+    rate_ppb_ = constrain(ppb, -CLOCK_MAX_RATE_PPB, CLOCK_MAX_RATE_PPB);
+    portEXIT_CRITICAL(&lock_);
+}
+
+bool SoftClock::isDisciplined() const {
+    int64_t timer = esp_timer_get_time();
+    portENTER_CRITICAL(&lock_);
+    bool disciplined = disciplined_ && timer - external_timer_us_ < (int64_t)CLOCK_HOLDOVER_MS * 1000;
+    portEXIT_CRITICAL(&lock_);
+    return disciplined;
+}
+
+int64_t SoftClock::nowMicros() const {
+    int64_t timer = esp_timer_get_time();
+    portENTER_CRITICAL(&lock_);
+    int64_t now = at(timer);
+    portEXIT_CRITICAL(&lock_);
+    return now;
+}
+
+void SoftClock::now(rtc_time_type& time, rtc_date_type& date) const {
+    clockToRtc(nowSeconds(), time, date);
+}
+
+void SoftClock::skipResync() {
+    int64_t timer = esp_timer_get_time();
+    portENTER_CRITICAL(&lock_);
+    rtc_timer_us_ = timer;
+    portEXIT_CRITICAL(&lock_);
+}
+
+int64_t SoftClock::sinceSyncUs() const {
+    int64_t timer = esp_timer_get_time();
+    portENTER_CRITICAL(&lock_);
+    int64_t since = timer - rtc_timer_us_;
+    portEXIT_CRITICAL(&lock_);
+    return since;
+}
+
+uint32_t SoftClock::secondsSinceSync() const {
+    return sinceSyncUs() / 1000000;
+}
+
+uint32_t SoftClock::msUntilResync() const {
+    int64_t since_ms = sinceSyncUs() / 1000;
+    return since_ms >= (int64_t)CLOCK_RESYNC_INTERVAL_MS ? 0 : CLOCK_RESYNC_INTERVAL_MS - since_ms;
+}
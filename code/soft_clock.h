@@ -0,0 +1,87 @@
+/*
+ * Software clock anchored to the Unit RTC.
+ *
+ * The RTC is read over I2C only when the clock is anchored or resynced;
+ * the current time is derived in between from the microsecond system timer
+ * (esp_timer_get_time()). Page renders and scheduler ticks therefore never
+ * wait on the I2C bus, and the time is known with sub-second resolution.
+ *
+ * Times are counted in seconds (or microseconds) since 2000-01-01 00:00:00
+ * local time, the range covered by the RTC.
+ *
+ * An external source (NTP, or the fleet's time leader, see time_sync.h) can
+ * discipline the clock: it is stepped to the source and its rate corrected
+ * for the drift of the system timer. While disciplined, the RTC follows
+ * the clock instead of correcting it, and takes over again once the source
+ * has been silent for CLOCK_HOLDOVER_MS.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include "Unit_RTC.h"
+
+#define CLOCK_RESYNC_INTERVAL_MS (10 * 60 * 1000UL) // Plain RTC read every 10 minutes
+#define CLOCK_HOLDOVER_MS (2 * 60 * 60 * 1000UL)    // External source lost after this (two missed hourly NTP updates)
+#define CLOCK_MAX_RATE_PPB 500000                    // Rate corrections are limited to +/-500 ppm
+
+// Calendar conversions (weekday included, 0 = Sunday)
+uint32_t clockSecondsOf(const rtc_time_type& time, const rtc_date_type& date);
+void clockToRtc(uint32_t seconds, rtc_time_type& time, rtc_date_type& date);
+
+class SoftClock {
+public:
+    // Sets the clock from an RTC reading taken right at a seconds edge
+    // (or just written to the RTC). Ends any external discipline.
+    void anchor(const rtc_time_type& time, const rtc_date_type& date);
+
+    // Checks a plain RTC reading (taken at an unknown point within its second)
+    // against the software clock. The clock is only moved when it falls
+    // outside that second; returns the correction applied, in milliseconds.
+    // While disciplined the clock is not moved, and the return value is how
+    // far the RTC is off (the caller rewrites it).
+    int32_t resync(const rtc_time_type& time, const rtc_date_type& date);
+
+    // The RTC could not be read: the clock keeps running on the timer and
+    // the next resync is an interval later
+    void skipResync();
+
+    // Moves the clock by offset_us on behalf of an external source. A zero
+    // offset still counts as confirmation from the source.
+    void step(int64_t offset_us);
+
+    // Corrects the rate of the system timer, in parts per billion (positive
+    // makes the clock run faster)
+    void setRate(int32_t ppb);
+    int32_t rate() const { return rate_ppb_; }
+
+    bool isDisciplined() const;
+
+    bool isSet() const { return set_; }
+
+    // Microseconds since 2000-01-01 00:00:00
+    int64_t nowMicros() const;
+    uint32_t nowSeconds() const { return nowMicros() / 1000000; }
+    void now(rtc_time_type& time, rtc_date_type& date) const;
+
+    uint32_t msUntilResync() const;
+
+    // Drift between the system timer and the RTC, as seen at the last resync
+    int32_t lastCorrectionMs() const { return last_correction_ms_; }
+    int32_t totalCorrectionMs() const { return total_correction_ms_; }
+    uint32_t secondsSinceSync() const;
+
+private:
+    mutable portMUX_TYPE lock_ = portMUX_INITIALIZER_UNLOCKED;
+    bool set_ = false;
+    int64_t base_us_ = 0;  // Clock time at timer_us_
+    int64_t timer_us_ = 0; // esp_timer_get_time() when base_us_ was set
+    int64_t rtc_timer_us_ = 0;      // esp_timer_get_time() at the last anchor/resync
+    int64_t external_timer_us_ = 0; // esp_timer_get_time() at the last step()
+    bool disciplined_ = false;
+    int32_t rate_ppb_ = 0;
+    int32_t last_correction_ms_ = 0;
+    int32_t total_correction_ms_ = 0;
+
+    int64_t at(int64_t timer) const; // Clock time at a timer value; call with lock_ held
+    int64_t sinceSyncUs() const;
+};
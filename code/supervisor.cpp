@@ -0,0 +1,174 @@
+/*
+ * Fault supervision: stalled tasks, a stuck I2C bus, and a fast restore of
+ * the outputs after a reset.
+ */
+#include "supervisor.h"
+#include <esp_system.h>
+#include <esp_task_wdt.h>
+#include "crc32.h"
+#include "trace.h"
+
+// --- WATCHED TASKS ---
+
+struct WatchedTask {
+  TaskHandle_t task;
+  const char* name;
+  uint32_t stall_ms;
+  uint32_t awake_since; // millis() | 1 while awake, 0 while waiting
+};
+
+static WatchedTask watched[SUPERVISOR_MAX_TASKS];
+static int num_watched = 0;
+
+static WatchedTask* currentTask() {
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    for (int i = 0; i < num_watched; i++) {
+        if (watched[i].task == self) return &watched[i];
+    }
+    return nullptr;
+}
+
+void supervisorWatch(TaskHandle_t task, const char* name, uint32_t stall_ms) {
+    if (num_watched >= SUPERVISOR_MAX_TASKS || !task) return;
+    WatchedTask& entry = watched[num_watched];
+    entry.task = task;
+    entry.name = name;
+    entry.stall_ms = stall_ms;
+    __atomic_store_n(&entry.awake_since, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&num_watched, num_watched + 1, __ATOMIC_RELEASE);
+}
+
+void supervisorWorking() {
+    WatchedTask* entry = currentTask();
+    if (entry) __atomic_store_n(&entry->awake_since, (uint32_t)millis() | 1, __ATOMIC_RELEASE);
+}
+
+void supervisorWaiting() {
+    WatchedTask* entry = currentTask();
+    if (entry) __atomic_store_n(&entry->awake_since, 0, __ATOMIC_RELEASE);
+}
+
+// --- RESTORE STATE ---
+
+#define RESTORE_MAGIC 0x52535431 // "RST1"
+
+struct RestoreState {
+  uint32_t magic;
+  uint8_t zones;
+  uint8_t restores; // Restores in a row without SUPERVISOR_STABLE_MS of uptime
+  uint16_t reserved;
+  uint32_t check;   // Of the fields above
+};
+
+RTC_NOINIT_ATTR static RestoreState restore_state; // Survives resets (not power loss)
+
+static uint32_t restoreCheck() {
+    return crc32(&restore_state, offsetof(RestoreState, check));
+}
+
+static bool restoreValid() {
+    return restore_state.magic == RESTORE_MAGIC && restore_state.check == restoreCheck();
+}
+
+void supervisorSaveState(uint8_t zones) {
+    if (!restoreValid()) {
+        memset(&restore_state, 0, sizeof(restore_state));
+        restore_state.magic = RESTORE_MAGIC;
+    }
+    restore_state.zones = zones;
+    restore_state.check = restoreCheck();
+}
+
+bool supervisorRestoreState(uint8_t& zones) {
+    esp_reset_reason_t reason = esp_reset_reason();
+    bool kept = reason == ESP_RST_SW || reason == ESP_RST_PANIC || reason == ESP_RST_INT_WDT ||
+                reason == ESP_RST_TASK_WDT || reason == ESP_RST_WDT;
+    if (!kept || !restoreValid()) {
+        memset(&restore_state, 0, sizeof(restore_state));
+        return false;
+    }
+    if (restore_state.restores >= SUPERVISOR_MAX_RESTORES) {
+        Serial.printf("[SUPERVISOR] %d resets in a row: starting from scratch.\n", restore_state.restores);
+        memset(&restore_state, 0, sizeof(restore_state));
+        return false;
+    }
+    restore_state.restores++;
+    restore_state.check = restoreCheck();
+    zones = restore_state.zones;
+    TRACE(TRACE_STATE_RESTORED, zones, reason);
+    return true;
+}
+
+// --- SUPERVISOR TASK ---
+
+static void supervisorTask(void* arg) {
+    traceRegisterTask();
+    bool on_watchdog = esp_task_wdt_add(nullptr) == ESP_OK;
+    if (!on_watchdog) Serial.println("[SUPERVISOR] Task watchdog unavailable.");
+    bool stable = false;
+
+    for (;;) {
+        vTaskDelay(pdMS_TO_TICKS(SUPERVISOR_CHECK_MS));
+        uint32_t now = millis();
+
+        int count = __atomic_load_n(&num_watched, __ATOMIC_ACQUIRE);
+        for (int i = 0; i < count; i++) {
+            uint32_t since = __atomic_load_n(&watched[i].awake_since, __ATOMIC_ACQUIRE);
+            if (!since || now - since < watched[i].stall_ms) continue;
+
+            // Stalled: the state saved for the restore is current, restart
+            Serial.printf("[SUPERVISOR] Task '%s' stalled, restarting.\n", watched[i].name);
+            TRACE(TRACE_TASK_STALLED, i, now - since);
+            vTaskDelay(pdMS_TO_TICKS(100)); // Lets the trace drain reach Serial
+            esp_restart();
+        }
+
+        if (!stable && now >= SUPERVISOR_STABLE_MS) {
+            stable = true;
+            if (restoreValid()) {
+                restore_state.restores = 0;
+                restore_state.check = restoreCheck();
+            }
+        }
+        if (on_watchdog) esp_task_wdt_reset();
+    }
+}
+
+void supervisorBegin(UBaseType_t priority, BaseType_t core, uint32_t stack_size) {
+    xTaskCreatePinnedToCore(supervisorTask, "supervisor", stack_size, nullptr, priority, nullptr, core);
+}
+
+// --- I2C BUS RECOVERY ---
+
+#define I2C_HALF_CLOCK_US 5 // 100 kHz
+
+bool i2cRecoverBus(TwoWire& wire, uint8_t sda, uint8_t scl) {
+    wire.end();
+    pinMode(sda, INPUT_PULLUP);
+    pinMode(scl, OUTPUT_OPEN_DRAIN);
+    digitalWrite(scl, HIGH);
+    delayMicroseconds(I2C_HALF_CLOCK_US);
+
+    // A device in the middle of a byte releases SDA within 9 clocks
+    int clocks = 0;
+    while (digitalRead(sda) == LOW && clocks < 9) {
+        digitalWrite(scl, LOW);
+        delayMicroseconds(I2C_HALF_CLOCK_US);
+        digitalWrite(scl, HIGH);
+        delayMicroseconds(I2C_HALF_CLOCK_US);
+        clocks++;
+    }
+
+    // STOP: SDA rises while SCL is high
+    pinMode(sda, OUTPUT_OPEN_DRAIN);
+    digitalWrite(sda, LOW);
+    delayMicroseconds(I2C_HALF_CLOCK_US);
+    digitalWrite(sda, HIGH);
+    delayMicroseconds(I2C_HALF_CLOCK_US);
+    pinMode(sda, INPUT_PULLUP);
+    bool released = digitalRead(sda) == HIGH;
+
+    wire.begin(sda, scl);
+    TRACE(TRACE_I2C_RECOVERED, clocks, released);
+    return released;
+}
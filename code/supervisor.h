@@ -0,0 +1,52 @@
+/*
+ * Fault supervision: stalled tasks, a stuck I2C bus, and a fast restore of
+ * the outputs after a reset.
+ *
+ * Each watched task reports when it goes back to its normal wait and when
+ * it wakes up. A task that has been awake longer than its limit is stalled
+ * (a hung transaction, a handler that never returns). The supervisor task
+ * then restarts the controller: a task cannot be stopped safely from
+ * outside, as it may hold the locks of the UART, I2C, NVS or network
+ * drivers. The supervisor is itself on the task watchdog, which it only
+ * feeds while every task is healthy, so a restart that does not happen
+ * becomes a watchdog reset.
+ *
+ * The zones the periods want on are kept in RTC memory, which survives
+ * resets but not power loss. After a software, panic or watchdog reset,
+ * setup() switches them back on right away and skips the boot self-test,
+ * so the outputs are off for the reset itself and a few milliseconds, not
+ * for the boot and the test. A state that keeps leading to resets is not
+ * restored more than SUPERVISOR_MAX_RESTORES times in a row.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#define SUPERVISOR_MAX_TASKS 4
+#define SUPERVISOR_CHECK_MS 500
+#define SUPERVISOR_STABLE_MS 60000 // Running this long ends a series of restores
+#define SUPERVISOR_MAX_RESTORES 3
+
+// Starts the supervisor task. Tasks added with supervisorWatch() are then
+// checked every SUPERVISOR_CHECK_MS.
+void supervisorBegin(UBaseType_t priority, BaseType_t core, uint32_t stack_size);
+void supervisorWatch(TaskHandle_t task, const char* name, uint32_t stall_ms);
+
+// Called by a watched task: it wakes up (and must wait again within its
+// limit), or it blocks in its normal wait (as long as it likes). A task
+// that never waits calls supervisorWorking() once per loop, as a heartbeat.
+void supervisorWorking();
+void supervisorWaiting();
+
+// Zones the periods want on; saved on every change (scheduler task)
+void supervisorSaveState(uint8_t zones);
+
+// After a reset that kept RTC memory, the saved zones; false after power-up
+// and other deliberate resets, or if the saved state is not valid
+bool supervisorRestoreState(uint8_t& zones);
+
+// Frees a bus whose device holds SDA low (reset in the middle of a read):
+// clocks SCL until it lets go, sends a STOP and restarts the driver.
+// Returns false if SDA is still held.
+bool i2cRecoverBus(TwoWire& wire, uint8_t sda, uint8_t scl);
@@ -0,0 +1,115 @@
+/*
+ * Clock synchronization between the units of a fleet.
+ */
+#include "time_sync.h"
+#include "soft_clock.h"
+
+void TimeSync::heard(uint32_t unit, bool ntp, uint32_t address, uint32_t now_ms) {
+    int slot = -1;
+    for (int i = 0; i < num_peers_; i++) {
+        if (peers_[i].unit == unit) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0) {
+        if (num_peers_ == SYNC_MAX_PEERS) {
+            // Replaces the peer heard from longest ago
+            slot = 0;
+            for (int i = 1; i < num_peers_; i++) {
+                if ((int32_t)(peers_[i].heard_ms - peers_[slot].heard_ms) < 0) slot = i;
+            }
+        } else {
+            slot = num_peers_++;
+        }
+    }
+    peers_[slot].unit = unit;
+    peers_[slot].ntp = ntp;
+    peers_[slot].address = address;
+    peers_[slot].heard_ms = now_ms;
+}
+
+uint32_t TimeSync::leader(uint32_t now_ms) {
+    uint32_t best = unit_id_;
+    bool best_ntp = ntp_;
+    uint32_t best_address = 0;
+    for (int i = 0; i < num_peers_; i++) {
+        const Peer& peer = peers_[i];
+        if (now_ms - peer.heard_ms >= SYNC_LEADER_TIMEOUT_MS) continue;
+        if ((peer.ntp && !best_ntp) || (peer.ntp == best_ntp && peer.unit < best)) {
+            best = peer.unit;
+            best_ntp = peer.ntp;
+            best_address = peer.address;
+        }
+    }
+    leader_address_ = best_address;
+    if (best != leader_) {
+        leader_ = best;
+        restart(); // Exchanges with the previous leader no longer count
+    }
+    return best;
+}
+
+bool TimeSync::requestDue(uint32_t now_ms, int64_t t1) {
+    if (isLeader(now_ms)) return false;
+
+    if (pending_) {
+        if (now_ms - sent_ms_ < SYNC_REPLY_TIMEOUT_MS) return false;
+        pending_ = false;
+        // The leader stopped answering: the clock is in holdover until it (or another) does
+        if (++missed_ >= SYNC_WINDOW) locked_ = false;
+    }
+    if (now_ms - sent_ms_ < (locked_ ? SYNC_INTERVAL_MS : SYNC_BURST_INTERVAL_MS)) return false;
+
+    pending_ = true;
+    pending_t1_ = t1;
+    sent_ms_ = now_ms;
+    return true;
+}
+
+bool TimeSync::reply(int64_t t1, int64_t t2, int64_t t3, int64_t t4, uint32_t now_ms, SyncCorrection& out) {
+    if (!pending_ || t1 != pending_t1_) return false; // Late, or from before a restart
+    pending_ = false;
+    missed_ = 0;
+
+    int64_t delay = (t4 - t1) - (t3 - t2);
+    if (delay < 0 || delay > SYNC_MAX_DELAY_US) return false;
+    int64_t offset = ((t2 - t1) + (t3 - t4)) / 2;
+    if (samples_ == 0 || delay < best_delay_us_) {
+        best_delay_us_ = delay;
+        best_offset_us_ = offset;
+    }
+    if (++samples_ < (locked_ ? SYNC_WINDOW : SYNC_FIRST_WINDOW)) return false;
+
+    samples_ = 0;
+    last_offset_us_ = best_offset_us_;
+    last_delay_us_ = best_delay_us_;
+    locked_ = true;
+    out = SyncCorrection();
+    out.offset_us = best_offset_us_;
+
+    // Drift: what the steps add up to over the baseline
+    int64_t now_us = t4 + best_offset_us_;
+    if (baseline_t4_ == 0) {
+        baseline_t4_ = now_us;
+        baseline_steps_ = 0;
+    } else {
+        baseline_steps_ += best_offset_us_;
+        int64_t span = now_us - baseline_t4_;
+        if (span >= (int64_t)SYNC_RATE_BASELINE_MS * 1000) {
+            int64_t rate = rate_ppb_ + baseline_steps_ * 1000000000LL / span;
+            rate_ppb_ = constrain(rate, (int64_t)-CLOCK_MAX_RATE_PPB, (int64_t)CLOCK_MAX_RATE_PPB);
+            out.rate_changed = true;
+            out.rate_ppb = rate_ppb_;
+            baseline_t4_ = now_us;
+            baseline_steps_ = 0;
+        }
+    }
+    return true;
+}
+
+void TimeSync::restart() {
+    pending_ = false;
+    samples_ = 0;
+    baseline_t4_ = 0;
+}
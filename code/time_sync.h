@@ -0,0 +1,108 @@
+/*
+ * Clock synchronization between the units of a fleet.
+ *
+ * One unit is the time leader: of the units heard from in the last
+ * SYNC_LEADER_TIMEOUT_MS (through their status beacons), one with an
+ * NTP-synced clock if there is any, and among those the lowest unit ID.
+ * Every other unit polls it with two-way exchanges, as NTP does:
+ *
+ *   t1 request sent (own clock)      t2 request received (leader's clock)
+ *   t4 reply received (own clock)    t3 reply sent (leader's clock)
+ *
+ *   offset = ((t2 - t1) + (t3 - t4)) / 2    delay = (t4 - t1) - (t3 - t2)
+ *
+ * Wi-Fi delays vary a lot between exchanges (power save, retries), and an
+ * uneven delay shows up as offset error, so of each window of SYNC_WINDOW
+ * exchanges only the fastest one is used: the clock is stepped by its
+ * offset. The steps taken over SYNC_RATE_BASELINE_MS give the drift of the
+ * system timer against the leader, which is then corrected by the soft
+ * clock's rate (see SoftClock::setRate), so the clocks also stay together
+ * between windows and after the leader is lost.
+ *
+ * This class only keeps the state; the fleet link carries the messages.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include "fleet.h"
+
+#define SYNC_INTERVAL_MS 2000       // Between exchanges once locked
+#define SYNC_BURST_INTERVAL_MS 250  // Between exchanges until the first lock
+#define SYNC_WINDOW 8               // Exchanges per offset estimate
+#define SYNC_FIRST_WINDOW 4         // Before the first lock
+#define SYNC_REPLY_TIMEOUT_MS 1000
+#define SYNC_MAX_DELAY_US 250000    // Slower exchanges are discarded
+#define SYNC_RATE_BASELINE_MS (5 * 60 * 1000UL)
+#define SYNC_MAX_PEERS 32
+#define SYNC_LEADER_TIMEOUT_MS (3 * FLEET_BEACON_MS) // Three missed status beacons
+
+// What to do with the clock once a window completes
+struct SyncCorrection {
+  int64_t offset_us = 0; // Step to apply now
+  bool rate_changed = false;
+  int32_t rate_ppb = 0;  // New rate, if rate_changed
+};
+
+class TimeSync {
+public:
+    void begin(uint32_t unit_id) { unit_id_ = unit_id; }
+
+    // Whether this unit's own clock comes from NTP
+    void setNtp(bool ntp) { ntp_ = ntp; }
+
+    // A status beacon from another unit (address in network byte order)
+    void heard(uint32_t unit, bool ntp, uint32_t address, uint32_t now_ms);
+
+    // Unit ID of the current leader (this unit's own when it leads)
+    uint32_t leader(uint32_t now_ms);
+    uint32_t leaderAddress() const { return leader_address_; }
+    bool isLeader(uint32_t now_ms) { return leader(now_ms) == unit_id_; }
+
+    // True when a request is to be sent to the leader now; t1 is the clock
+    // time it is sent at
+    bool requestDue(uint32_t now_ms, int64_t t1);
+
+    // Reply to the pending request. Returns true (with the correction to
+    // apply) when it completes a window.
+    bool reply(int64_t t1, int64_t t2, int64_t t3, int64_t t4, uint32_t now_ms, SyncCorrection& out);
+
+    // Drops the pending request and the window (the clock was moved)
+    void restart();
+
+    bool isLocked() const { return locked_; }
+    int64_t lastOffsetUs() const { return last_offset_us_; }
+    int32_t lastDelayUs() const { return last_delay_us_; }
+    int32_t ratePpb() const { return rate_ppb_; }
+
+private:
+    struct Peer {
+      uint32_t unit;
+      bool ntp;
+      uint32_t address;
+      uint32_t heard_ms;
+    };
+
+    uint32_t unit_id_ = 0;
+    bool ntp_ = false;
+    Peer peers_[SYNC_MAX_PEERS] = {};
+    int num_peers_ = 0;
+    uint32_t leader_ = 0;
+    uint32_t leader_address_ = 0;
+
+    bool locked_ = false;
+    bool pending_ = false;
+    int64_t pending_t1_ = 0;
+    uint32_t sent_ms_ = 0;
+    uint8_t missed_ = 0;
+
+    // Current window: the fastest exchange so far
+    uint8_t samples_ = 0;
+    int64_t best_offset_us_ = 0;
+    int32_t best_delay_us_ = 0;
+
+    int64_t last_offset_us_ = 0;
+    int32_t last_delay_us_ = 0;
+    int32_t rate_ppb_ = 0;
+    int64_t baseline_t4_ = 0;   // Clock time the steps are summed from (0 = not started)
+    int64_t baseline_steps_ = 0;
+};
@@ -0,0 +1,239 @@
+/*
+ * Event trace for the GRAVE Controller.
+ */
+#include "trace.h"
+
+#define TRACE_EVENT_FORMAT(id, format) format,
+static const char* const TRACE_FORMATS[TRACE_EVENT_COUNT] = { TRACE_EVENTS(TRACE_EVENT_FORMAT) };
+#undef TRACE_EVENT_FORMAT
+
+static void formatMessage(const TraceRecord& record, char* out, size_t len) {
+    if (record.event >= TRACE_EVENT_COUNT) {
+        snprintf(out, len, "[TRACE] Unknown event %u", record.event);
+        return;
+    }
+    snprintf(out, len, TRACE_FORMATS[record.event],
+             (long)record.args[0], (long)record.args[1], (long)record.args[2]);
+}
+
+void traceSerial(TraceEvent event, int32_t a, int32_t b, int32_t c) {
+    TraceRecord record = {};
+    record.event = event;
+    record.args[0] = a;
+    record.args[1] = b;
+    record.args[2] = c;
+    char line[128];
+    formatMessage(record, line, sizeof(line));
+    Serial.println(line);
+}
+
+#if !TRACE_ENABLED
+
+void traceFormat(const TraceRecord& record, char* out, size_t len) {
+    formatMessage(record, out, len);
+}
+
+bool TracePage::renderNext() {
+    if (started_) return false;
+    emit("Tracing is disabled (TRACE_ENABLED = 0).\n");
+    started_ = true;
+    return true;
+}
+
+#else
+
+// --- RINGS ---
+// A ring is written by one task only. The writer marks the slot as being
+// rewritten (seq = ~index), fills it, then publishes it (seq = index, then
+// head). Readers on other cores copy a slot and accept it only if seq was
+// the expected index both before and after the copy.
+
+#define TRACE_MAGIC 0x54524331 // "TRC1"
+
+struct TraceRing {
+  uint32_t head; // Index of the next record
+  TraceRecord records[TRACE_RING_SIZE];
+};
+
+struct TraceMemory {
+  uint32_t magic;
+  uint8_t boot;
+  TraceRing rings[TRACE_RINGS];
+};
+
+RTC_NOINIT_ATTR static TraceMemory trace_memory; // Survives resets (not power loss)
+
+#define SHARED_RING (TRACE_RINGS - 1)
+static TaskHandle_t ring_owner[SHARED_RING];
+static portMUX_TYPE trace_lock = portMUX_INITIALIZER_UNLOCKED; // Registration and the shared ring
+static uint32_t printed[TRACE_RINGS]; // Next record for Serial (drain task)
+
+void traceBegin() {
+    if (trace_memory.magic != TRACE_MAGIC) {
+        memset(&trace_memory, 0, sizeof(trace_memory));
+        trace_memory.magic = TRACE_MAGIC;
+    }
+    trace_memory.boot++;
+    for (int i = 0; i < TRACE_RINGS; i++) printed[i] = trace_memory.rings[i].head;
+}
+
+void traceRegisterTask() {
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    portENTER_CRITICAL(&trace_lock);
+    for (int i = 0; i < SHARED_RING; i++) {
+        if (ring_owner[i] == self) break;
+        if (!ring_owner[i]) {
+            ring_owner[i] = self;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&trace_lock);
+}
+
+static inline void writeRecord(TraceRing& ring, TraceEvent event, int32_t a, int32_t b, int32_t c) {
+    uint32_t index = ring.head;
+    TraceRecord& record = ring.records[index & (TRACE_RING_SIZE - 1)];
+    __atomic_store_n(&record.seq, (uint16_t)~index, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    record.time_us = micros();
+    record.event = event;
+    record.boot = trace_memory.boot;
+    record.args[0] = a;
+    record.args[1] = b;
+    record.args[2] = c;
+    __atomic_store_n(&record.seq, (uint16_t)index, __ATOMIC_RELEASE);
+    __atomic_store_n(&ring.head, index + 1, __ATOMIC_RELEASE);
+}
+
+void traceRecord(TraceEvent event, int32_t a, int32_t b, int32_t c) {
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    for (int i = 0; i < SHARED_RING; i++) {
+        if (ring_owner[i] == self) {
+            writeRecord(trace_memory.rings[i], event, a, b, c);
+            return;
+        }
+    }
+    portENTER_CRITICAL(&trace_lock);
+    writeRecord(trace_memory.rings[SHARED_RING], event, a, b, c);
+    portEXIT_CRITICAL(&trace_lock);
+}
+
+// "[seconds.millis] message", marked with the boot it comes from if not this one
+void traceFormat(const TraceRecord& record, char* out, size_t len) {
+    int n;
+    uint8_t age = trace_memory.boot - record.boot;
+    if (age) {
+        n = snprintf(out, len, "[boot -%u %6lu.%03lu] ", age,
+                     (unsigned long)(record.time_us / 1000000), (unsigned long)(record.time_us / 1000 % 1000));
+    } else {
+        n = snprintf(out, len, "[%6lu.%03lu] ",
+                     (unsigned long)(record.time_us / 1000000), (unsigned long)(record.time_us / 1000 % 1000));
+    }
+    if (n > 0 && (size_t)n < len) formatMessage(record, out + n, len - n);
+}
+
+// --- READING ---
+
+void TraceCursor::begin(bool unprinted_only) {
+    dropped_ = 0;
+    for (int i = 0; i < TRACE_RINGS; i++) {
+        uint32_t head = __atomic_load_n(&trace_memory.rings[i].head, __ATOMIC_ACQUIRE);
+        uint32_t oldest = head > TRACE_RING_SIZE ? head - TRACE_RING_SIZE : 0;
+        uint32_t start = unprinted_only ? printed[i] : oldest;
+        if (start < oldest) {
+            dropped_ += oldest - start;
+            start = oldest;
+        }
+        next_[i] = start;
+        end_[i] = head;
+    }
+}
+
+// Copies the next record of a ring, skipping those overwritten meanwhile
+bool TraceCursor::peek(int ring, TraceRecord& record) {
+    const TraceRing& r = trace_memory.rings[ring];
+    while (next_[ring] < end_[ring]) {
+        uint32_t index = next_[ring];
+        const TraceRecord& slot = r.records[index & (TRACE_RING_SIZE - 1)];
+        uint16_t before = __atomic_load_n(&slot.seq, __ATOMIC_ACQUIRE);
+        memcpy(&record, (const void*)&slot, sizeof(record));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        uint16_t after = __atomic_load_n(&slot.seq, __ATOMIC_RELAXED);
+        if (before == (uint16_t)index && after == (uint16_t)index) return true;
+        dropped_++;
+        next_[ring]++;
+    }
+    return false;
+}
+
+bool TraceCursor::next(TraceRecord& record) {
+    int best = -1;
+    uint8_t best_age = 0;
+    TraceRecord candidate;
+    for (int i = 0; i < TRACE_RINGS; i++) {
+        if (!peek(i, candidate)) continue;
+        uint8_t age = trace_memory.boot - candidate.boot;
+        // Earlier boots first, then by time (micros() wraps every ~71 minutes)
+        if (best < 0 || age > best_age ||
+            (age == best_age && (int32_t)(candidate.time_us - record.time_us) < 0)) {
+            best = i;
+            best_age = age;
+            record = candidate;
+        }
+    }
+    if (best < 0) return false;
+    next_[best]++;
+    return true;
+}
+
+void TraceCursor::markPrinted() const {
+    for (int i = 0; i < TRACE_RINGS; i++) printed[i] = next_[i];
+}
+
+// --- SERIAL OUTPUT ---
+
+static void drainTask(void* arg) {
+    char line[160];
+    for (;;) {
+        vTaskDelay(pdMS_TO_TICKS(TRACE_DRAIN_MS));
+
+        TraceCursor cursor;
+        cursor.begin(true);
+        TraceRecord record;
+        while (cursor.next(record)) {
+            traceFormat(record, line, sizeof(line));
+            Serial.println(line);
+        }
+        if (cursor.dropped()) Serial.printf("[TRACE] %lu events dropped.\n", (unsigned long)cursor.dropped());
+        cursor.markPrinted();
+    }
+}
+
+void traceStartDrain(UBaseType_t priority, BaseType_t core, uint32_t stack_size) {
+    xTaskCreatePinnedToCore(drainTask, "trace", stack_size, nullptr, priority, nullptr, core);
+}
+
+// --- /trace ---
+
+bool TracePage::renderNext() {
+    if (!started_) {
+        cursor_.begin(false);
+        started_ = true;
+    }
+    TraceRecord record;
+    if (cursor_.next(record)) {
+        char line[160];
+        traceFormat(record, line, sizeof(line));
+        emit(line);
+        emit("\n");
+        return true;
+    }
+    if (cursor_.dropped() && !reported_) {
+        emitf("[TRACE] %lu events overwritten while reading.\n", (unsigned long)cursor_.dropped());
+        reported_ = true;
+        return true;
+    }
+    return false;
+}
+
+#endif
@@ -0,0 +1,145 @@
+/*
+ * Event trace for the GRAVE Controller.
+ *
+ * Runtime log messages are recorded as fixed-size records (timestamp, event
+ * ID and up to three integer arguments) instead of being formatted and
+ * written to the UART where they happen. Each task that logs has its own
+ * single-producer ring, so recording is a handful of stores with no lock;
+ * a low-priority task later formats the records with the event's format
+ * string and prints them on Serial, and /trace shows what the rings hold.
+ *
+ * The rings live in RTC memory that is not cleared on reset, so after a
+ * crash or watchdog reset /trace still shows the last events of the
+ * previous boot.
+ *
+ * With TRACE_ENABLED set to 0, TRACE() prints straight to Serial as before.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include "html_stream.h"
+
+#define TRACE_ENABLED 1
+#define TRACE_RING_SIZE 32 // Records per ring (power of two)
+#define TRACE_RINGS 4      // Three tasks, plus one shared ring for the others
+#define TRACE_DRAIN_MS 100 // Serial output interval
+
+// Event IDs and their messages. Arguments are formatted as long.
+#define TRACE_EVENTS(X) \
+    X(TRACE_ZONE_ON, "[ALARM] Zone %ld ACTIVATED: %02ld:%02ld") \
+    X(TRACE_ZONE_OFF, "[ALARM] Zone %ld DEACTIVATED: %02ld:%02ld") \
+    X(TRACE_SELFTEST_START, "[TEST] STARTING %ld-SECOND TEST (Amplifier/MP3)...") \
+    X(TRACE_SELFTEST_END, "[TEST] Test concluded. Entering Normal Operation mode.") \
+    X(TRACE_CLOCK_RESYNC, "[CLOCK] Resynced with RTC, corrected by %ld ms.") \
+    X(TRACE_CLOCK_RTC_SET, "[CLOCK] RTC was %ld ms off the synchronized clock, rewritten.") \
+    X(TRACE_WEB_PERIODS, "[Web Server] %ld active periods defined.") \
+    X(TRACE_WEB_VOLUME, "[Web Server] MP3 volume adjusted to: %ld") \
+    X(TRACE_WEB_SELFTEST, "[Web Server] Boot self-test set to %ld s.") \
+    X(TRACE_WEB_ZONE, "[Web Server] Zone %ld set to track %ld, volume %ld (255 = main).") \
+    X(TRACE_WEB_PLAYLIST, "[Web Server] Playlist %ld set to %ld tracks.") \
+    X(TRACE_WEB_DATE, "[Web Server] RTC date adjusted to: %02ld/%02ld/%04ld") \
+    X(TRACE_WEB_TIME, "[Web Server] RTC time adjusted to: %02ld:%02ld:%02ld") \
+    X(TRACE_WIFI_UP, "[WiFi] Connected to the site network, fleet link %ld.") \
+    X(TRACE_WIFI_DOWN, "[WiFi] Site network lost.") \
+    X(TRACE_POWER_AP, "[POWER] Access point on: %ld.") \
+    X(TRACE_NTP_SYNC, "[NTP] Clock synchronized (%ld ms change).") \
+    X(TRACE_FLEET_CONFIG, "[Fleet] Fields 0x%02lx received from unit %08lx, changed: %ld.") \
+    X(TRACE_FLEET_TIME, "[Fleet] Clock set from unit %08lx (%ld ms change).") \
+    X(TRACE_FLEET_CLONE, "[Fleet] Sending fields 0x%02lx to the fleet (%ld bytes).") \
+    X(TRACE_FLEET_ACK, "[Fleet] Unit %08lx acknowledged message %ld, result %ld.") \
+    X(TRACE_FLEET_REJECTED, "[Fleet] Dropped datagram of %ld bytes (reason %ld).") \
+    X(TRACE_SYNC_STEP, "[Fleet] Clock locked to unit %08lx: stepped %ld us (delay %ld us).") \
+    X(TRACE_SYNC_RATE, "[Fleet] Clock rate corrected to %ld ppb.") \
+    X(TRACE_SYNC_LOST, "[Fleet] Time leader lost, clock in holdover.") \
+    X(TRACE_OTA_START, "[OTA] Receiving a %ld-byte image.") \
+    X(TRACE_OTA_DONE, "[OTA] Image of %ld bytes verified, restart pending.") \
+    X(TRACE_OTA_FAILED, "[OTA] Update failed after %ld bytes.") \
+    X(TRACE_OTA_HEALTH, "[OTA] New firmware health check: %ld (0 = failed, rolling back).") \
+    X(TRACE_CONFIG_IMPORT, "[Web Server] Imported fields 0x%02lx (%ld bytes), changed: %ld.") \
+    X(TRACE_STATE_RESTORED, "[SUPERVISOR] Zones 0x%02lx restored after reset (reason %ld).") \
+    X(TRACE_TASK_STALLED, "[SUPERVISOR] Task %ld stalled for %ld ms: restarting.") \
+    X(TRACE_I2C_RECOVERED, "[SUPERVISOR] I2C bus recovery: %ld clocks, bus free: %ld.") \
+    X(TRACE_RTC_INVALID, "[RTC] Invalid reading (month %ld, hour %ld): reading ignored.") \
+    X(TRACE_NVS_SAVED, "[NVS] Saved field 0x%02lx (%ld bytes).") \
+    X(TRACE_NVS_ERROR, "[NVS] ERROR saving field 0x%02lx.") \
+    X(TRACE_MP3_STOP, "[MP3] Stopping playback.") \
+    X(TRACE_MP3_PLAY, "[MP3] Playing track %ld in LOOP.") \
+    X(TRACE_MP3_PLAY_ONCE, "[MP3] Playing track %ld (playlist).") \
+    X(TRACE_MP3_FADE, "[MP3] Fading volume %ld -> %ld over %ld ms.") \
+    X(TRACE_MP3_PREPARE, "[MP3] Waking module ahead of playback, volume %ld.") \
+    X(TRACE_MP3_CARD_IN, "[MP3] SD card inserted.") \
+    X(TRACE_MP3_CARD_OUT, "[MP3] SD card removed.") \
+    X(TRACE_MP3_ERROR, "[MP3] Module error 0x%02lX.")
+
+#define TRACE_EVENT_ID(id, format) id,
+enum TraceEvent : uint8_t { TRACE_EVENTS(TRACE_EVENT_ID) TRACE_EVENT_COUNT };
+#undef TRACE_EVENT_ID
+
+struct TraceRecord {
+  uint32_t time_us;  // micros() when recorded
+  uint8_t event;
+  uint8_t boot;      // Boot counter, to tell earlier boots apart
+  uint16_t seq;      // Low bits of the record's index; see trace.cpp
+  int32_t args[3];
+};
+
+// Formats a record as one line, without the newline
+void traceFormat(const TraceRecord& record, char* out, size_t len);
+
+#if TRACE_ENABLED
+
+#define TRACE(event, ...) traceRecord(event, ##__VA_ARGS__)
+
+// Keeps the previous boot's records and starts a new boot; call first in setup
+void traceBegin();
+
+// Gives the calling task a ring of its own (call at the start of the task)
+void traceRegisterTask();
+
+void traceRecord(TraceEvent event, int32_t a = 0, int32_t b = 0, int32_t c = 0);
+
+// Starts the task that prints new records on Serial
+void traceStartDrain(UBaseType_t priority, BaseType_t core, uint32_t stack_size);
+
+// Walks the records of all rings in time order, earlier boots first
+class TraceCursor {
+public:
+    // From the records not yet printed on Serial, or from everything retained
+    void begin(bool unprinted_only);
+    bool next(TraceRecord& record);
+    uint32_t dropped() const { return dropped_; } // Overwritten before being read
+    void markPrinted() const; // Serial drain only
+
+private:
+    bool peek(int ring, TraceRecord& record);
+
+    uint32_t next_[TRACE_RINGS];
+    uint32_t end_[TRACE_RINGS];
+    uint32_t dropped_ = 0;
+};
+
+#else
+
+#define TRACE(event, ...) traceSerial(event, ##__VA_ARGS__)
+
+inline void traceBegin() {}
+inline void traceRegisterTask() {}
+inline void traceStartDrain(UBaseType_t, BaseType_t, uint32_t) {}
+
+#endif
+
+// Prints one event right away (TRACE() when tracing is compiled out)
+void traceSerial(TraceEvent event, int32_t a = 0, int32_t b = 0, int32_t c = 0);
+
+// /trace body: one record per line
+class TracePage : public PageStream {
+protected:
+    bool renderNext() override;
+
+private:
+#if TRACE_ENABLED
+    TraceCursor cursor_;
+    bool reported_ = false;
+#endif
+    bool started_ = false;
+};
@@ -0,0 +1,165 @@
+/*
+ * Web interface assets, gzip-compressed.
+ * Generated by tools/embed_assets.py from ui/ -- do not edit.
+ */
+#pragma once
+
+#include <Arduino.h>
+
+struct StaticAsset {
+  const char* url;
+  const char* content_type;
+  const uint8_t* data; // gzip
+  size_t length;
+};
+
+// style.css: 680 bytes, 373 gzipped
+#define ASSET_STYLE_URL "/s/style.8815f9c9.css"
+const uint8_t ASSET_STYLE_GZ[] PROGMEM = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x75, 0x51, 0xcb, 0x4e, 0xc3, 0x30,
+    0x10, 0xbc, 0xf7, 0x2b, 0x56, 0xaa, 0x50, 0xa5, 0x8a, 0xa8, 0x09, 0x21, 0x42, 0x24, 0xe2, 0x80,
+    0x10, 0xe2, 0xce, 0x81, 0x0b, 0xea, 0xc1, 0x8e, 0x37, 0x89, 0x85, 0x5f, 0xb2, 0x1d, 0xd2, 0x82,
+    0xfa, 0xef, 0xd8, 0x69, 0x5a, 0x5a, 0x1e, 0xb2, 0xec, 0xc3, 0xac, 0x67, 0x66, 0x77, 0x76, 0xb5,
+    0x84, 0xa7, 0xe7, 0xfb, 0x97, 0x47, 0x78, 0xd0, 0xca, 0x5b, 0x2d, 0x04, 0x5a, 0x18, 0x90, 0x02,
+    0x57, 0x1e, 0x6d, 0x43, 0x6a, 0x84, 0xe5, 0x6a, 0x46, 0x35, 0xdb, 0xc2, 0x27, 0x34, 0xe1, 0x4b,
+    0xd2, 0x10, 0xc9, 0xc5, 0xb6, 0x04, 0x47, 0x94, 0x4b, 0x1c, 0x5a, 0xde, 0x54, 0x40, 0x49, 0xfd,
+    0xd6, 0x5a, 0xdd, 0x2b, 0x56, 0xc2, 0xbc, 0x49, 0xe3, 0xa9, 0x40, 0x92, 0x4d, 0x32, 0x70, 0xe6,
+    0xbb, 0x12, 0xae, 0xd3, 0xd4, 0x6c, 0x22, 0x62, 0x5b, 0xae, 0x4a, 0x48, 0x81, 0xf4, 0x5e, 0x57,
+    0x60, 0x08, 0x63, 0x5c, 0xb5, 0x25, 0x64, 0x63, 0x79, 0x37, 0x63, 0xfc, 0x3d, 0xd8, 0x9c, 0xab,
+    0x35, 0x51, 0x5f, 0x5b, 0x86, 0x36, 0xb1, 0x84, 0xf1, 0xde, 0x95, 0x50, 0xc4, 0xdf, 0x47, 0xf2,
+    0xd5, 0x89, 0x76, 0x42, 0xb5, 0xf7, 0x5a, 0x7e, 0x2b, 0x76, 0x59, 0x10, 0xac, 0xb5, 0xd0, 0x36,
+    0x68, 0xe5, 0x79, 0x1e, 0x31, 0x73, 0x02, 0x15, 0x45, 0x11, 0xa1, 0x46, 0x5b, 0x19, 0x50, 0xc6,
+    0x9d, 0x11, 0x24, 0x0c, 0xd7, 0x5a, 0xce, 0xaa, 0xf1, 0x4d, 0x3c, 0xca, 0x80, 0x79, 0x4c, 0x02,
+    0xa5, 0x97, 0x2a, 0xd8, 0x67, 0x8d, 0x8d, 0x37, 0xd4, 0x89, 0xf9, 0x76, 0x12, 0x84, 0xa2, 0x38,
+    0x84, 0x34, 0x20, 0x6f, 0x3b, 0x5f, 0x86, 0xc6, 0x05, 0x8b, 0x45, 0xae, 0x4c, 0xef, 0x5f, 0xfd,
+    0xd6, 0xe0, 0xdd, 0x42, 0xf5, 0x92, 0xa2, 0x5d, 0xac, 0x2f, 0xc1, 0xa1, 0xc0, 0xda, 0x07, 0xce,
+    0x14, 0xd3, 0x6d, 0x7a, 0x71, 0x32, 0x57, 0xb1, 0xd7, 0x3d, 0xa5, 0xba, 0x9e, 0x4a, 0xee, 0x17,
+    0xeb, 0x40, 0x19, 0x7b, 0xdb, 0xb7, 0x14, 0x7a, 0x80, 0x15, 0x24, 0xd9, 0xaf, 0x40, 0xcf, 0x82,
+    0x4c, 0xd3, 0x1b, 0x1a, 0xb3, 0x9c, 0x26, 0x1f, 0x3a, 0xee, 0xf1, 0x90, 0x6c, 0x09, 0x4a, 0x2b,
+    0xfc, 0x3b, 0xe7, 0x71, 0x1e, 0xc7, 0x3f, 0x30, 0xa8, 0xa2, 0x1c, 0x33, 0xcd, 0xff, 0xf3, 0x9f,
+    0x96, 0xe0, 0xb5, 0x99, 0xc8, 0x3f, 0xb6, 0x32, 0x62, 0x93, 0xc9, 0x71, 0x53, 0x66, 0x03, 0x4e,
+    0x0b, 0xce, 0x60, 0x5e, 0xd7, 0xf5, 0x71, 0x86, 0x73, 0xce, 0x6e, 0xf6, 0x05, 0x54, 0xbb, 0xcd,
+    0x6e, 0xa8, 0x02, 0x00, 0x00,
+};
+
+// app.js: 4055 bytes, 1781 gzipped
+#define ASSET_APP_URL "/s/app.ec8cdb5a.js"
+const uint8_t ASSET_APP_GZ[] PROGMEM = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x9d, 0x57, 0xef, 0x4e, 0xdc, 0x46,
+    0x10, 0xff, 0xce, 0x53, 0x4c, 0x68, 0x1a, 0xdb, 0x05, 0xf6, 0x0e, 0x1a, 0xa1, 0xe8, 0x0e, 0x14,
+    0xa5, 0x84, 0x54, 0xa9, 0xd2, 0x10, 0x71, 0x24, 0xad, 0x44, 0x11, 0x59, 0xec, 0x3d, 0xec, 0xc4,
+    0xf6, 0xba, 0xbb, 0x6b, 0x2e, 0x47, 0xc2, 0xbb, 0xb4, 0xea, 0x87, 0x3e, 0x40, 0x1e, 0x81, 0x17,
+    0xeb, 0xcc, 0xac, 0x7d, 0xf6, 0xc1, 0xa9, 0x95, 0xfa, 0xe1, 0x7c, 0xf6, 0x78, 0xe6, 0xb7, 0xf3,
+    0x7f, 0xc6, 0x83, 0x01, 0xfc, 0x78, 0xfc, 0xec, 0xdd, 0x21, 0x1c, 0xe8, 0xd2, 0x19, 0x9d, 0xe7,
+    0xca, 0xc0, 0x4c, 0x5d, 0x40, 0x56, 0x3a, 0x65, 0xa6, 0x32, 0x56, 0x23, 0xc8, 0xb3, 0x2b, 0x05,
+    0xd6, 0x49, 0x57, 0x5b, 0x90, 0x65, 0x02, 0x53, 0x6d, 0x0a, 0xb0, 0xf5, 0x45, 0x91, 0x59, 0x9b,
+    0xe9, 0x52, 0xac, 0x0d, 0x06, 0x70, 0x92, 0x2a, 0xa8, 0xe4, 0xa5, 0x82, 0xcc, 0x59, 0x95, 0x4f,
+    0x41, 0x97, 0xf9, 0x1c, 0xe2, 0x54, 0x96, 0x97, 0xca, 0xc2, 0x2c, 0x73, 0x29, 0x38, 0xe4, 0x88,
+    0x75, 0x39, 0xcd, 0x2e, 0x6b, 0x23, 0x1d, 0xca, 0x41, 0x48, 0x60, 0x99, 0x85, 0x58, 0xc6, 0xa9,
+    0x4a, 0xe0, 0x62, 0x4e, 0x3c, 0x04, 0x76, 0x61, 0xf4, 0xcc, 0x2a, 0x13, 0x8d, 0xbd, 0x50, 0x6d,
+    0x8c, 0x2a, 0x1d, 0xb8, 0xac, 0x50, 0x7c, 0xbe, 0xae, 0x5d, 0x55, 0x3b, 0xd6, 0x88, 0x20, 0x91,
+    0x3a, 0x35, 0xba, 0x80, 0x81, 0xac, 0xb2, 0x41, 0x4f, 0x4d, 0x69, 0x18, 0x0c, 0x21, 0x4a, 0xf8,
+    0xa8, 0x2a, 0x07, 0x75, 0x05, 0x4e, 0x43, 0x42, 0x52, 0xfe, 0x2c, 0x18, 0xa8, 0x2b, 0x44, 0xb6,
+    0x08, 0x65, 0x94, 0x2c, 0xc4, 0x5a, 0x38, 0xad, 0xcb, 0xd8, 0xeb, 0x16, 0xc1, 0xe7, 0x35, 0x80,
+    0xc5, 0xf3, 0xc3, 0x30, 0x4b, 0x90, 0x04, 0x46, 0xb9, 0xda, 0x94, 0x90, 0xe8, 0xb8, 0x2e, 0x50,
+    0x54, 0x5c, 0x2a, 0x77, 0x98, 0x2b, 0xba, 0xfd, 0x61, 0xfe, 0x32, 0x21, 0xa6, 0x31, 0xdc, 0xf4,
+    0x05, 0x2b, 0x99, 0x84, 0x65, 0x4f, 0x32, 0x2c, 0x61, 0x0f, 0xb6, 0x87, 0xf0, 0x14, 0x82, 0x61,
+    0x00, 0x23, 0x08, 0x82, 0x08, 0x36, 0xa0, 0xbc, 0x23, 0xe5, 0xd4, 0x27, 0x87, 0x60, 0x9b, 0x70,
+    0x25, 0xf3, 0x5a, 0x91, 0xf8, 0x95, 0x34, 0xa0, 0x72, 0xd8, 0xf7, 0x9a, 0x8c, 0x21, 0x9b, 0x42,
+    0xa8, 0xf2, 0x08, 0x69, 0x82, 0x98, 0x29, 0x7a, 0xe4, 0xa4, 0x7d, 0x2f, 0x41, 0x70, 0x88, 0x47,
+    0x42, 0x71, 0xae, 0xe3, 0x8f, 0x48, 0x2f, 0xeb, 0x3c, 0x1f, 0x03, 0x3a, 0x64, 0xa2, 0x30, 0x0c,
+    0x89, 0x05, 0x3d, 0x65, 0x1f, 0x24, 0x72, 0x0e, 0xd2, 0xc1, 0x7b, 0x9b, 0x95, 0xb1, 0x7a, 0x0f,
+    0x61, 0x61, 0x37, 0x01, 0x45, 0x64, 0xce, 0x0e, 0x37, 0x51, 0x03, 0x83, 0x8e, 0xcd, 0x15, 0x1f,
+    0x1f, 0xf0, 0x6d, 0x10, 0x8d, 0xdb, 0x03, 0x38, 0xa8, 0xef, 0x94, 0xa1, 0x64, 0x40, 0x0e, 0xcf,
+    0xf9, 0x14, 0x5e, 0xd7, 0xc5, 0x85, 0x32, 0x21, 0x3f, 0x0a, 0xf4, 0xba, 0xb4, 0xca, 0x09, 0xcf,
+    0x1c, 0xa1, 0xe1, 0xc3, 0xf1, 0x5a, 0xdf, 0x62, 0x9b, 0xea, 0xd9, 0x09, 0x1e, 0xd8, 0x38, 0x1e,
+    0xd8, 0xc0, 0x07, 0xac, 0x7c, 0xd4, 0xf8, 0x6e, 0xcc, 0x74, 0x56, 0x06, 0x8f, 0x09, 0xf9, 0x9d,
+    0xb0, 0x8d, 0x35, 0x1b, 0xf0, 0xb3, 0x74, 0xa9, 0x98, 0xe6, 0x5a, 0x9b, 0x30, 0x7c, 0x8e, 0x41,
+    0x16, 0xa5, 0x9e, 0x21, 0xda, 0x16, 0x34, 0x8c, 0x64, 0x5f, 0x04, 0x03, 0x74, 0xfe, 0x70, 0x18,
+    0x45, 0xf0, 0x2d, 0x3c, 0xd9, 0x7d, 0x3c, 0x1c, 0x7a, 0x50, 0xf6, 0x77, 0x40, 0x06, 0x07, 0x9b,
+    0x1c, 0xb2, 0x1e, 0x98, 0x45, 0x99, 0xef, 0x77, 0x59, 0x66, 0x03, 0x82, 0x51, 0x80, 0xd7, 0x15,
+    0x1c, 0xbb, 0x43, 0x82, 0xa4, 0x6b, 0x9f, 0xc9, 0x7a, 0x1a, 0xfb, 0xea, 0x66, 0xc9, 0xde, 0x69,
+    0x96, 0xe7, 0x61, 0x29, 0x0b, 0xd5, 0xc5, 0x78, 0x61, 0x5e, 0x56, 0x52, 0x7e, 0xef, 0x77, 0x59,
+    0xf6, 0x7b, 0xad, 0xcc, 0x7c, 0xa2, 0x72, 0x15, 0x3b, 0x3c, 0x6e, 0xfd, 0x1b, 0xf4, 0x24, 0x57,
+    0x03, 0x33, 0x9e, 0x12, 0xca, 0x7e, 0xb0, 0x4e, 0x69, 0x84, 0x77, 0xf8, 0xb7, 0x1e, 0x9c, 0xad,
+    0x47, 0xe3, 0x85, 0x17, 0x3d, 0xdc, 0xa3, 0x47, 0x9e, 0x5d, 0xf0, 0x71, 0xb0, 0xbf, 0xbf, 0xcf,
+    0xb9, 0xb7, 0x44, 0x6b, 0x92, 0xe7, 0x9e, 0xb2, 0x78, 0xde, 0x01, 0x39, 0x31, 0xb4, 0x7d, 0x35,
+    0x49, 0x45, 0x2b, 0x48, 0x11, 0x61, 0xab, 0x3c, 0x43, 0x07, 0x8e, 0x82, 0x48, 0x14, 0xb2, 0x0a,
+    0x7d, 0xe8, 0xa3, 0x2e, 0x60, 0x09, 0xb3, 0x52, 0xe9, 0xb5, 0xac, 0x5b, 0xab, 0x58, 0xdb, 0x5c,
+    0xfd, 0x0c, 0x4d, 0x58, 0x47, 0xe0, 0x4e, 0x87, 0x67, 0xf0, 0x1d, 0x07, 0x00, 0x2d, 0x73, 0xa7,
+    0xdb, 0xf4, 0xb4, 0xeb, 0xef, 0x77, 0xce, 0x36, 0x81, 0xc3, 0x3a, 0x82, 0x5e, 0xc0, 0x6f, 0x3c,
+    0x56, 0x97, 0x50, 0xfd, 0x10, 0x93, 0x0a, 0x4d, 0x88, 0x13, 0x94, 0xe7, 0x68, 0x0d, 0xda, 0x68,
+    0x25, 0x88, 0xde, 0x51, 0x12, 0x3c, 0x39, 0xe2, 0x24, 0x05, 0x2a, 0x1b, 0x76, 0x80, 0xef, 0x7d,
+    0x89, 0x9a, 0xca, 0x3a, 0xc7, 0xbe, 0x81, 0xed, 0xa4, 0x69, 0x6b, 0x4d, 0xeb, 0x0c, 0xec, 0x52,
+    0xbb, 0x62, 0x59, 0x8e, 0x74, 0x90, 0xe2, 0xa9, 0x8e, 0x11, 0x1b, 0x42, 0xc1, 0x84, 0xed, 0x8e,
+    0x60, 0x99, 0xb0, 0x73, 0xd6, 0xe8, 0xeb, 0x89, 0x09, 0x12, 0x59, 0xd1, 0x85, 0x98, 0x2e, 0x99,
+    0xd4, 0x13, 0x9c, 0x33, 0x61, 0x78, 0x16, 0xad, 0x0c, 0xdc, 0x11, 0x77, 0x4b, 0xdb, 0x85, 0xce,
+    0x3b, 0xc2, 0x37, 0x51, 0x94, 0xb4, 0x82, 0x1a, 0xb6, 0x53, 0xd6, 0x51, 0x4f, 0x7a, 0xf6, 0xf6,
+    0xe4, 0xe8, 0xe4, 0x70, 0x72, 0x72, 0x48, 0xbd, 0xc9, 0x0a, 0x99, 0x4b, 0x53, 0x9c, 0x4b, 0x04,
+    0xbb, 0xa2, 0x92, 0x0e, 0x8e, 0x5e, 0x63, 0xaa, 0xbf, 0xc9, 0xe5, 0x9c, 0x5b, 0xd7, 0xd1, 0x8b,
+    0x17, 0xf8, 0x38, 0x71, 0xba, 0x0a, 0x96, 0x9c, 0x7c, 0xa5, 0x73, 0xcc, 0xdb, 0x2d, 0x0c, 0x07,
+    0xe3, 0xfb, 0xc7, 0x5e, 0x36, 0x5c, 0xeb, 0x52, 0x51, 0x09, 0x9f, 0x9e, 0x35, 0xa6, 0x6a, 0x03,
+    0x21, 0xbf, 0x40, 0xe2, 0x70, 0x8c, 0x7f, 0x7b, 0xf0, 0x04, 0xff, 0x36, 0x36, 0x22, 0x4e, 0x60,
+    0x2b, 0xbc, 0xc4, 0x23, 0x08, 0xb7, 0x61, 0x6f, 0x0f, 0xae, 0xb1, 0x14, 0x99, 0x22, 0xaa, 0xda,
+    0xa6, 0xe1, 0x35, 0x06, 0x6b, 0x7b, 0x49, 0x01, 0x7e, 0x89, 0x67, 0x7b, 0xa6, 0x5c, 0x95, 0x97,
+    0x38, 0x80, 0x9e, 0x36, 0x8f, 0x1f, 0x74, 0x56, 0x86, 0xf8, 0x32, 0xa0, 0x2e, 0x14, 0x94, 0xaa,
+    0x4c, 0xeb, 0x42, 0x2e, 0x1b, 0x50, 0xe2, 0x95, 0x55, 0xa7, 0x9b, 0x73, 0x3f, 0xc6, 0xf8, 0x35,
+    0x20, 0x4a, 0xb8, 0x44, 0x16, 0x9d, 0x73, 0xf2, 0xec, 0x52, 0x1a, 0x76, 0x4c, 0xa2, 0xac, 0x7f,
+    0xe0, 0x6c, 0x82, 0xdb, 0x3f, 0x2c, 0x50, 0x46, 0xdd, 0x11, 0x74, 0x0d, 0x64, 0xa7, 0x05, 0x16,
+    0xb0, 0x85, 0xca, 0xdc, 0x7e, 0xfd, 0x94, 0x15, 0x78, 0xb7, 0xf3, 0x38, 0x0d, 0x56, 0x07, 0xf5,
+    0xa0, 0xdf, 0x73, 0xc3, 0x2b, 0xff, 0xdf, 0x06, 0x98, 0x92, 0x95, 0x8f, 0xe0, 0x99, 0x6a, 0x71,
+    0x40, 0xa2, 0xdd, 0x38, 0x28, 0x2c, 0xd6, 0x89, 0x4b, 0x71, 0xe0, 0xd2, 0xa0, 0xc6, 0x4c, 0xad,
+    0x94, 0xc9, 0x34, 0xb6, 0xce, 0x02, 0x27, 0xc0, 0x85, 0xa2, 0xb1, 0x4a, 0x33, 0x81, 0x8b, 0xb4,
+    0xc3, 0x51, 0xf1, 0x47, 0xc4, 0x91, 0xb8, 0x04, 0x38, 0x87, 0x6d, 0x3d, 0xc7, 0xb7, 0x66, 0x13,
+    0x50, 0x39, 0x4a, 0x7c, 0x1e, 0x9f, 0x1c, 0x3e, 0x5d, 0xe3, 0x6f, 0x56, 0x36, 0x23, 0x9f, 0x21,
+    0xa5, 0x31, 0xe8, 0x98, 0x16, 0xe9, 0x42, 0x21, 0x9b, 0x62, 0x29, 0xa3, 0x2a, 0x5c, 0x0e, 0x9a,
+    0xda, 0xb9, 0xb7, 0x4c, 0x70, 0xed, 0x2a, 0x47, 0xa5, 0x8b, 0x1a, 0xdd, 0x9b, 0xc8, 0x6d, 0x53,
+    0xf3, 0x53, 0x06, 0x9b, 0x5a, 0x63, 0x3c, 0x3c, 0xc0, 0x86, 0xb6, 0x34, 0x8a, 0x22, 0x3f, 0x89,
+    0x44, 0x9a, 0x25, 0x89, 0xa2, 0xc1, 0x34, 0x95, 0xe8, 0x02, 0x1f, 0xe6, 0x9b, 0x4d, 0x3f, 0x06,
+    0x3a, 0xe7, 0x2a, 0x17, 0xa7, 0x61, 0xd0, 0xdb, 0x21, 0x30, 0xfe, 0x9f, 0xfd, 0x6a, 0x42, 0xf1,
+    0xd1, 0x5b, 0x16, 0x5b, 0xaf, 0x0a, 0xe0, 0x26, 0x62, 0x00, 0x41, 0x6b, 0x45, 0x4f, 0x39, 0xd3,
+    0x1b, 0xf1, 0x46, 0x7c, 0xb0, 0x18, 0x15, 0xda, 0x04, 0x56, 0x33, 0xdb, 0xce, 0x94, 0x5e, 0x67,
+    0x1d, 0x77, 0xa4, 0xae, 0x66, 0x5b, 0xa2, 0xcf, 0x4b, 0x3b, 0x2f, 0x63, 0xca, 0xdc, 0x63, 0x95,
+    0xdf, 0x7e, 0xbd, 0xcc, 0x34, 0x77, 0x3f, 0xa3, 0xcb, 0xec, 0x5a, 0x26, 0x9a, 0x56, 0x21, 0xd0,
+    0x70, 0x7c, 0x72, 0x00, 0xe9, 0xed, 0x9f, 0x4d, 0xc2, 0xf5, 0x66, 0xdf, 0x39, 0x49, 0x9f, 0xe3,
+    0xa4, 0x6c, 0x20, 0x01, 0x59, 0x2c, 0x8e, 0x51, 0x8d, 0xfd, 0xea, 0xf6, 0xef, 0xdb, 0xbf, 0xf4,
+    0x68, 0x49, 0x86, 0xe9, 0xac, 0xf0, 0x79, 0x61, 0x39, 0x8d, 0x0b, 0x1b, 0xb5, 0x65, 0xd2, 0x1a,
+    0x16, 0x4b, 0x72, 0xdb, 0x52, 0x8c, 0xee, 0xf6, 0x97, 0xc0, 0xaa, 0x02, 0xa8, 0x1a, 0xf8, 0x8c,
+    0x80, 0xbd, 0xc2, 0x5d, 0x15, 0xed, 0x7c, 0x49, 0x4b, 0x26, 0xce, 0x9c, 0xb0, 0x6d, 0xd6, 0x8b,
+    0xb0, 0xac, 0xf9, 0x28, 0xcf, 0xb2, 0x32, 0xd1, 0x33, 0x71, 0x48, 0x79, 0x36, 0xc1, 0x1c, 0x8b,
+    0x97, 0xe6, 0x64, 0xb3, 0xbd, 0xe1, 0x6e, 0xa3, 0x66, 0xd0, 0xe3, 0xc1, 0x38, 0xfa, 0x57, 0xad,
+    0xba, 0xfe, 0x49, 0xc8, 0x24, 0x61, 0xae, 0x57, 0x99, 0xc5, 0x65, 0x09, 0x77, 0x93, 0x76, 0xe2,
+    0x77, 0x06, 0xf0, 0xae, 0xb5, 0x08, 0xca, 0x4f, 0x93, 0xa3, 0xd7, 0xa2, 0x92, 0xc6, 0xaa, 0xd0,
+    0xaf, 0x30, 0x51, 0xa3, 0xfe, 0xbf, 0x82, 0x2e, 0xf2, 0xe7, 0x3e, 0x6c, 0x1b, 0xd8, 0xff, 0x07,
+    0xec, 0xd3, 0x7b, 0xb5, 0xbe, 0x4b, 0x0d, 0xe1, 0x3e, 0xbc, 0x68, 0x7b, 0x44, 0x7b, 0x0c, 0x67,
+    0x3d, 0xd6, 0xe5, 0x0b, 0xac, 0x3f, 0x4b, 0xbb, 0x32, 0x54, 0x1a, 0xcf, 0x49, 0xfc, 0xb2, 0xce,
+    0xe5, 0x30, 0xba, 0x33, 0xdc, 0x70, 0xab, 0xb6, 0x33, 0x84, 0x81, 0x9d, 0xe1, 0x63, 0xde, 0xb0,
+    0x5d, 0xb3, 0xf4, 0x7b, 0x24, 0x34, 0x7b, 0x6e, 0x71, 0x9f, 0x80, 0x2a, 0xc7, 0xcf, 0x06, 0x01,
+    0x47, 0xf4, 0x09, 0xe0, 0x7b, 0x0c, 0xa8, 0x04, 0xbf, 0x0b, 0xb0, 0x3e, 0x72, 0x2d, 0x71, 0xe5,
+    0x77, 0x6d, 0x03, 0x69, 0x3f, 0x11, 0x18, 0x29, 0x47, 0x3b, 0xa9, 0xfc, 0x17, 0x5b, 0xcf, 0x0a,
+    0xcf, 0x52, 0x9f, 0x70, 0xf7, 0x1c, 0xb0, 0x48, 0x08, 0x6e, 0x26, 0xfb, 0xa0, 0x84, 0x93, 0x06,
+    0x37, 0xf3, 0x6e, 0x05, 0x7a, 0xd0, 0x24, 0x12, 0xdb, 0x05, 0x5f, 0xbe, 0x40, 0x4b, 0x78, 0x7b,
+    0xfc, 0x6a, 0xa2, 0xa4, 0x89, 0xd3, 0x37, 0xd2, 0x48, 0x4c, 0xf0, 0xa5, 0x55, 0x53, 0x89, 0xca,
+    0x70, 0x30, 0x9e, 0xfb, 0x81, 0x1f, 0xb6, 0xeb, 0x00, 0x9d, 0x75, 0xa1, 0x93, 0x79, 0x93, 0x7a,
+    0x77, 0x40, 0x42, 0xa2, 0x91, 0x5f, 0x71, 0x29, 0x91, 0x21, 0xe9, 0x14, 0xf5, 0xb6, 0x31, 0xdc,
+    0x80, 0xd8, 0x0a, 0xcc, 0x7c, 0x6a, 0x5f, 0xbd, 0x47, 0x41, 0xeb, 0x5b, 0xc4, 0xc0, 0x42, 0x56,
+    0x95, 0x2a, 0x93, 0xf0, 0xee, 0xdb, 0xcd, 0x25, 0x7e, 0xbf, 0x38, 0x36, 0x3a, 0xf9, 0x0e, 0x46,
+    0xa7, 0xf1, 0x48, 0xd2, 0x25, 0xf5, 0xaf, 0x42, 0xb9, 0x54, 0x27, 0x58, 0xd8, 0x6f, 0x8e, 0x26,
+    0x27, 0xe8, 0x37, 0xc2, 0x1e, 0xf1, 0x75, 0x13, 0x52, 0x25, 0x13, 0x8c, 0xe6, 0x08, 0xd9, 0x82,
+    0x5f, 0xb7, 0x8e, 0x15, 0x2e, 0x99, 0x94, 0x00, 0x5b, 0xbf, 0x60, 0x02, 0x04, 0x28, 0xc2, 0x80,
+    0xd8, 0xf0, 0xda, 0x62, 0x5f, 0xdd, 0xf4, 0x16, 0xcd, 0x84, 0xdd, 0x6c, 0x84, 0x5e, 0xac, 0xeb,
+    0xd8, 0x07, 0xb9, 0x15, 0x44, 0x77, 0xc5, 0x1c, 0xe5, 0x2c, 0x76, 0x66, 0xe3, 0x42, 0x47, 0xb1,
+    0x30, 0xc2, 0x57, 0x4c, 0xaf, 0x04, 0x78, 0x19, 0xbc, 0xf3, 0x5d, 0xd1, 0x7c, 0x4f, 0x18, 0xd1,
+    0x28, 0x4e, 0xdf, 0x5e, 0x21, 0x6a, 0xee, 0x53, 0x7f, 0xab, 0x61, 0x0c, 0xa2, 0x1e, 0x04, 0xe9,
+    0x34, 0xf8, 0x6d, 0x80, 0xf5, 0xf1, 0x70, 0x20, 0x68, 0xc5, 0xe9, 0xfb, 0x27, 0xea, 0x6b, 0x0f,
+    0xfc, 0xcd, 0x43, 0x64, 0x91, 0x1a, 0x35, 0xc5, 0xe3, 0x70, 0x09, 0xec, 0x80, 0x6e, 0x78, 0x7c,
+    0xf6, 0xf0, 0xfc, 0x4e, 0xf3, 0xdf, 0xa8, 0x4b, 0x0b, 0x51, 0x3c, 0xe5, 0xe2, 0x25, 0x66, 0xe5,
+    0x3f, 0x1a, 0x71, 0x39, 0x5a, 0x44, 0x71, 0x71, 0x56, 0x73, 0xd7, 0xb9, 0x7d, 0x55, 0x97, 0x65,
+    0x14, 0x9f, 0x0a, 0x61, 0x57, 0xd4, 0x78, 0xbd, 0x89, 0x28, 0x4d, 0xff, 0x01, 0x63, 0xaa, 0xd6,
+    0x8e, 0xd7, 0x0f, 0x00, 0x00,
+};
+
+const StaticAsset STATIC_ASSETS[] = {
+  { ASSET_STYLE_URL, "text/css", ASSET_STYLE_GZ, sizeof(ASSET_STYLE_GZ) },
+  { ASSET_APP_URL, "text/javascript; charset=utf-8", ASSET_APP_GZ, sizeof(ASSET_APP_GZ) },
+};
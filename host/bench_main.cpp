@@ -0,0 +1,24 @@
+/*
+ * Host benchmark runner: benchCore() and benchPages() on this computer (see
+ * Makefile).
+ */
+#include "bench.h"
+#include "http_server.h"
+#include "pages.h"
+
+// What the sketch defines for the pages: an access point only unit
+AlarmData alarmConfig;
+ScheduleEngine pageSchedule;
+Snapshot<AlarmData> configSnapshot;
+const char* sta_ssid = "";
+uint32_t fleetUnitId = 0;
+
+int main() {
+    static HttpServer server; // Not listening: /metrics shows its empty counters
+    uint32_t failures = benchCore(alarmConfig);
+
+    ScheduleDate today;
+    today.year = 2025;
+    benchPages(server, today);
+    return failures > 0 ? 1 : 0; // Fails the make target
+}
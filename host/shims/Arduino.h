@@ -0,0 +1,67 @@
+/*
+ * Host shim: the part of the Arduino core and FreeRTOS that the
+ * hardware-free modules use, on a POSIX computer.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <algorithm>
+
+using std::min;
+using std::max;
+#define constrain(x, low, high) ((x) < (low) ? (low) : ((x) > (high) ? (high) : (x)))
+
+// Flash and RAM are one address space
+#define PROGMEM
+#define PGM_P const char*
+#define strlen_P strlen
+#define memcpy_P memcpy
+#define strncpy_P strncpy
+#define pgm_read_byte(address) (*(const uint8_t*)(address))
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+
+#define OUTPUT 0x03
+inline void pinMode(uint8_t, uint8_t) {}
+
+// Every UART prints on stdout
+class HardwareSerial {
+public:
+    int printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+    void print(const char* text) { fputs(text, stdout); }
+    void println(const char* text = "") { puts(text); }
+};
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+extern HardwareSerial Serial2;
+
+// FreeRTOS: one task, no preemption
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
+#define portTICK_PERIOD_MS 1
+#define portMAX_DELAY 0xFFFFFFFF
+void vTaskDelay(TickType_t ticks);
+
+// No other task takes a mutex or owns a stack here
+typedef void* TaskHandle_t;
+typedef void* SemaphoreHandle_t;
+inline SemaphoreHandle_t xSemaphoreCreateMutex() { return nullptr; }
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t, TickType_t) { return 1; }
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t) { return 1; }
+inline UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t) { return 0; }
+
+// Part of esp_system.h, which the Arduino core includes
+uint32_t esp_get_free_heap_size();
+uint32_t esp_get_minimum_free_heap_size();
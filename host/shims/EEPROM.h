@@ -0,0 +1,25 @@
+/*
+ * Host shim: an emulated EEPROM that was never written (reads as 0xFF).
+ */
+#pragma once
+
+#include <Arduino.h>
+
+class EEPROMClass {
+public:
+    bool begin(size_t size);
+    void end() {}
+    template <typename T> T& get(int address, T& value) {
+        memcpy(&value, data_ + address, sizeof(T));
+        return value;
+    }
+    template <typename T> const T& put(int address, const T& value) {
+        memcpy(data_ + address, &value, sizeof(T));
+        return value;
+    }
+    bool commit() { return true; }
+
+private:
+    uint8_t data_[4096];
+};
+extern EEPROMClass EEPROM;
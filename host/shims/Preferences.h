@@ -0,0 +1,19 @@
+/*
+ * Host shim: NVS namespaces in memory, empty at every start.
+ */
+#pragma once
+
+#include <Arduino.h>
+
+class Preferences {
+public:
+    bool begin(const char* name, bool read_only = false);
+    void end() {}
+    bool isKey(const char* key);
+    size_t getBytesLength(const char* key);
+    size_t getBytes(const char* key, void* data, size_t len);
+    size_t putBytes(const char* key, const void* data, size_t len);
+
+private:
+    char name_[16] = "";
+};
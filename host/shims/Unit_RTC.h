@@ -0,0 +1,20 @@
+/*
+ * Host shim: the RTC driver's date and time records (the driver itself is
+ * not used by the host build).
+ */
+#pragma once
+
+#include <Arduino.h>
+
+typedef struct {
+  int8_t Hours;
+  int8_t Minutes;
+  int8_t Seconds;
+} rtc_time_type;
+
+typedef struct {
+  int8_t Date;
+  int8_t WeekDay;
+  int8_t Month;
+  int16_t Year;
+} rtc_date_type;
@@ -0,0 +1,20 @@
+/*
+ * Host shim: heap statistics of the C++ allocations (operator new and
+ * delete are counted in host_shims.cpp) out of a nominal ESP32-S3 heap.
+ */
+#pragma once
+
+#include <stddef.h>
+
+#define MALLOC_CAP_8BIT 0x04
+#define HOST_HEAP_SIZE (320 * 1024)
+
+typedef struct {
+  size_t total_free_bytes;
+  size_t total_allocated_bytes;
+  size_t allocated_blocks;
+} multi_heap_info_t;
+
+void heap_caps_get_info(multi_heap_info_t* info, unsigned int caps);
+size_t heap_caps_get_free_size(unsigned int caps);
+size_t heap_caps_get_largest_free_block(unsigned int caps);
@@ -0,0 +1,8 @@
+/*
+ * Host shim: the microsecond system timer, from the monotonic clock.
+ */
+#pragma once
+
+#include <stdint.h>
+
+int64_t esp_timer_get_time();
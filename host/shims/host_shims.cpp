@@ -0,0 +1,139 @@
+/*
+ * Host shims: the Arduino, FreeRTOS and ESP-IDF functions behind the shim
+ * headers, and the counted heap.
+ */
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <Preferences.h>
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+#include "trace.h"
+
+// --- TIME ---
+
+static const std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+
+int64_t esp_timer_get_time() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started).count();
+}
+
+unsigned long micros() { return (unsigned long)esp_timer_get_time(); }
+unsigned long millis() { return (unsigned long)(esp_timer_get_time() / 1000); }
+void delay(unsigned long ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+void vTaskDelay(TickType_t ticks) { delay(ticks * portTICK_PERIOD_MS); }
+
+// --- SERIAL ---
+
+HardwareSerial Serial;
+HardwareSerial Serial1;
+HardwareSerial Serial2;
+
+int HardwareSerial::printf(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    int n = vprintf(format, args);
+    va_end(args);
+    return n;
+}
+
+// Trace events are dropped: the benchmarks report on Serial
+void traceRecord(TraceEvent, int32_t, int32_t, int32_t) {}
+
+// --- HEAP ---
+// Every block carries its size in front, so the totals follow delete too.
+// Not inlined, so the compiler does not pair the malloc() and free() inside
+// with the operators the standard library calls.
+
+static size_t heap_allocated = 0;
+static size_t heap_blocks = 0;
+static size_t heap_peak = 0; // Most bytes allocated at once
+static const size_t HEADER = alignof(max_align_t);
+
+__attribute__((noinline)) void* operator new(size_t size) {
+    uint8_t* block = (uint8_t*)malloc(size + HEADER);
+    if (!block) throw std::bad_alloc();
+    *(size_t*)block = size;
+    heap_allocated += size;
+    heap_blocks++;
+    heap_peak = max(heap_peak, heap_allocated);
+    return block + HEADER;
+}
+
+__attribute__((noinline)) void operator delete(void* data) noexcept {
+    if (!data) return;
+    uint8_t* block = (uint8_t*)data - HEADER;
+    heap_allocated -= *(size_t*)block;
+    heap_blocks--;
+    free(block);
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete[](void* data) noexcept { operator delete(data); }
+void operator delete(void* data, size_t) noexcept { operator delete(data); }
+void operator delete[](void* data, size_t) noexcept { operator delete(data); }
+
+void heap_caps_get_info(multi_heap_info_t* info, unsigned int) {
+    info->total_allocated_bytes = heap_allocated;
+    info->total_free_bytes = HOST_HEAP_SIZE - heap_allocated;
+    info->allocated_blocks = heap_blocks;
+}
+
+size_t heap_caps_get_free_size(unsigned int) {
+    return HOST_HEAP_SIZE - heap_allocated;
+}
+
+size_t heap_caps_get_largest_free_block(unsigned int) {
+    return HOST_HEAP_SIZE - heap_allocated;
+}
+
+uint32_t esp_get_free_heap_size() { return HOST_HEAP_SIZE - heap_allocated; }
+uint32_t esp_get_minimum_free_heap_size() { return HOST_HEAP_SIZE - heap_peak; }
+
+// --- STORAGE ---
+
+EEPROMClass EEPROM;
+
+bool EEPROMClass::begin(size_t size) {
+    if (size > sizeof(data_)) return false;
+    memset(data_, 0xFF, sizeof(data_));
+    return true;
+}
+
+static std::map<std::string, std::vector<uint8_t>> nvs; // "namespace/key"
+
+static std::string nvsKey(const char* name, const char* key) {
+    return std::string(name) + "/" + key;
+}
+
+bool Preferences::begin(const char* name, bool) {
+    snprintf(name_, sizeof(name_), "%s", name);
+    return true;
+}
+
+bool Preferences::isKey(const char* key) {
+    return nvs.count(nvsKey(name_, key)) > 0;
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+    auto entry = nvs.find(nvsKey(name_, key));
+    return entry == nvs.end() ? 0 : entry->second.size();
+}
+
+size_t Preferences::getBytes(const char* key, void* data, size_t len) {
+    auto entry = nvs.find(nvsKey(name_, key));
+    if (entry == nvs.end() || entry->second.size() > len) return 0;
+    memcpy(data, entry->second.data(), entry->second.size());
+    return entry->second.size();
+}
+
+size_t Preferences::putBytes(const char* key, const void* data, size_t len) {
+    nvs[nvsKey(name_, key)].assign((const uint8_t*)data, (const uint8_t*)data + len);
+    return len;
+}
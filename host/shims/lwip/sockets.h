@@ -0,0 +1,10 @@
+/*
+ * Host shim: lwIP's BSD socket API is the POSIX one.
+ */
+#pragma once
+
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
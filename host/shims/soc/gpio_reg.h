@@ -0,0 +1,12 @@
+/*
+ * Host shim: the GPIO output registers of the ESP32-S3; writes go nowhere.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#define GPIO_OUT_W1TS_REG 0x60004008
+#define GPIO_OUT_W1TC_REG 0x6000400C
+#define GPIO_OUT1_W1TS_REG 0x60004014
+#define GPIO_OUT1_W1TC_REG 0x60004018
+#define REG_WRITE(reg, value) ((void)(reg), (void)(value))
@@ -0,0 +1,81 @@
+#!/usr/bin/env python3
+"""Embeds the web interface assets (ui/) into code/ui_assets.h.
+
+Each asset is gzip-compressed and stored in flash as a byte array. Its URL
+contains a hash of the content, so the browser can cache it forever: any
+change produces a new URL.
+
+Run after editing a file in ui/:
+    python3 tools/embed_assets.py
+"""
+import gzip
+import hashlib
+import os
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+UI_DIR = os.path.join(ROOT, "ui")
+OUTPUT = os.path.join(ROOT, "code", "ui_assets.h")
+
+# (file, C name, content type)
+ASSETS = [
+    ("style.css", "STYLE", "text/css"),
+    ("app.js", "APP", "text/javascript; charset=utf-8"),
+]
+
+
+def c_bytes(data):
+    lines = []
+    for i in range(0, len(data), 16):
+        lines.append("    " + ", ".join("0x%02x" % b for b in data[i:i + 16]) + ",")
+    return "\n".join(lines)
+
+
+def main():
+    out = [
+        "/*",
+        " * Web interface assets, gzip-compressed.",
+        " * Generated by tools/embed_assets.py from ui/ -- do not edit.",
+        " */",
+        "#pragma once",
+        "",
+        "#include <Arduino.h>",
+        "",
+        "struct StaticAsset {",
+        "  const char* url;",
+        "  const char* content_type;",
+        "  const uint8_t* data; // gzip",
+        "  size_t length;",
+        "};",
+        "",
+    ]
+    table = []
+
+    for filename, name, content_type in ASSETS:
+        with open(os.path.join(UI_DIR, filename), "rb") as f:
+            source = f.read()
+        digest = hashlib.sha256(source).hexdigest()[:8]
+        stem, ext = os.path.splitext(filename)
+        url = "/s/%s.%s%s" % (stem, digest, ext)
+        # mtime=0 keeps the output identical between runs
+        packed = gzip.compress(source, compresslevel=9, mtime=0)
+
+        out.append("// %s: %d bytes, %d gzipped" % (filename, len(source), len(packed)))
+        out.append('#define ASSET_%s_URL "%s"' % (name, url))
+        out.append("const uint8_t ASSET_%s_GZ[] PROGMEM = {" % name)
+        out.append(c_bytes(packed))
+        out.append("};")
+        out.append("")
+        table.append('  { ASSET_%s_URL, "%s", ASSET_%s_GZ, sizeof(ASSET_%s_GZ) },'
+                     % (name, content_type, name, name))
+
+    out.append("const StaticAsset STATIC_ASSETS[] = {")
+    out.extend(table)
+    out.append("};")
+    out.append("")
+
+    with open(OUTPUT, "w", newline="\n") as f:
+        f.write("\n".join(out))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,175 @@
+#!/usr/bin/env python3
+"""Manages the GRAVE Controllers of a site over the fleet protocol.
+
+The controllers must be on the site network (sta_ssid set in
+code/grave_controller.cpp) and share the fleet key. The message layout is
+described in code/fleet.h.
+
+    python3 tools/fleet.py discover       List the units and their state
+    python3 tools/fleet.py time           Set every unit's clock from this computer
+    python3 tools/fleet.py clone <unit>   Copy one unit's configuration to all the others
+
+The key is given with --key or in the GRAVE_FLEET_KEY environment variable.
+"""
+import argparse
+import datetime
+import hashlib
+import hmac
+import os
+import socket
+import struct
+import sys
+import time
+
+PORT = 4210
+GROUP = "239.71.82.86"
+MAGIC = 0x4647
+VERSION = 1
+TAG_SIZE = 16
+MAX_TARGETS = 64
+
+DISCOVER, STATUS, CONFIG, TIME, CLONE, ACK = range(1, 7)
+
+HEADER = struct.Struct("<HBBIIHBB")  # FleetHeader
+STATUS_BODY = struct.Struct("<IIIHBBB")  # FleetStatus
+TIME_BODY = struct.Struct("<II")  # FleetTime
+ACK_BODY = struct.Struct("<IBBI")  # FleetAck
+
+STATUS_FLAGS = ((0x01, "self-test"), (0x02, "synced"), (0x04, "unsaved"),
+                (0x08, "ntp"), (0x10, "leader"), (0x20, "locked"))
+CONFIG_FIELD_ALL = 0x1F
+RESULTS = {0: "ok", 1: "malformed", 2: "busy"}
+EPOCH_2000 = datetime.datetime(2000, 1, 1)
+
+
+class Fleet:
+    def __init__(self, key, address, timeout):
+        self.key = key.encode()
+        self.address = address
+        self.timeout = timeout
+        # The units drop datagrams not newer than the last one from this
+        # sender: counting from the clock keeps each run above the previous
+        self.seq = int(time.time() * 16) & 0xFFFFFFFF
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+        self.sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_TTL, 1)
+        self.sock.bind(("", 0))
+
+    def send(self, kind, payload=b"", targets=()):
+        self.seq = (self.seq + 1) & 0xFFFFFFFF
+        header = HEADER.pack(MAGIC, VERSION, kind, 0, self.seq, len(payload), len(targets), 0)
+        body = header + b"".join(struct.pack("<I", t) for t in targets) + payload
+        tag = hmac.new(self.key, body, hashlib.sha256).digest()[:TAG_SIZE]
+        self.sock.sendto(body + tag, (self.address, PORT))
+        return self.seq
+
+    def receive(self, until):
+        """Yields (type, sender, payload, address) of the verified replies until the deadline."""
+        while True:
+            left = until - time.monotonic()
+            if left <= 0:
+                return
+            self.sock.settimeout(left)
+            try:
+                data, (address, _) = self.sock.recvfrom(2048)
+            except socket.timeout:
+                return
+            if len(data) < HEADER.size + TAG_SIZE:
+                continue
+            magic, version, kind, sender, _, length, targets, _ = HEADER.unpack_from(data)
+            tag = hmac.new(self.key, data[:-TAG_SIZE], hashlib.sha256).digest()[:TAG_SIZE]
+            if magic != MAGIC or version != VERSION or not hmac.compare_digest(tag, data[-TAG_SIZE:]):
+                continue
+            start = HEADER.size + 4 * targets
+            yield kind, sender, data[start:start + length], address
+
+    def discover(self):
+        self.send(DISCOVER)
+        units = {}
+        for kind, sender, payload, address in self.receive(time.monotonic() + self.timeout):
+            if kind == STATUS and len(payload) == STATUS_BODY.size:
+                units[sender] = (address,) + STATUS_BODY.unpack(payload)
+        return units
+
+    def command(self, kind, payload, units, retries=3):
+        """Sends to the given units, again to those that did not acknowledge. Returns {unit: result}."""
+        results = {}
+        for _ in range(retries):
+            pending = [u for u in units if u not in results]
+            if not pending:
+                break
+            seqs = set()
+            for i in range(0, len(pending), MAX_TARGETS):
+                body = payload() if callable(payload) else payload
+                seqs.add(self.send(kind, body, pending[i:i + MAX_TARGETS]))
+            for reply, sender, body, _ in self.receive(time.monotonic() + self.timeout):
+                if reply == ACK and len(body) == ACK_BODY.size:
+                    seq, _, result, _ = ACK_BODY.unpack(body)
+                    if seq in seqs:
+                        results[sender] = result
+        return results
+
+
+def print_units(units):
+    now = datetime.datetime.now()
+    print("%-8s  %-15s  %-8s  %-19s  %7s  %5s  %3s  %s" %
+          ("UNIT", "ADDRESS", "CONFIG", "CLOCK", "OFFSET", "ZONES", "VOL", "FLAGS"))
+    for unit, (address, crc, clock, uptime, periods, zones, volume, flags) in sorted(units.items()):
+        local = EPOCH_2000 + datetime.timedelta(seconds=clock)
+        names = ",".join(name for bit, name in STATUS_FLAGS if flags & bit)
+        print("%08x  %-15s  %08x  %-19s  %+6ds  %5s  %3d  %s" %
+              (unit, address, crc, local.strftime("%Y-%m-%d %H:%M:%S"), int((local - now).total_seconds()),
+               format(zones, "b"), volume, names))
+    configs = {u[1] for u in units.values()}
+    print("%d units, %d different configurations" % (len(units), len(configs)))
+
+
+def print_results(units, results):
+    for unit in units:
+        print("%08x  %s" % (unit, RESULTS.get(results[unit], "error %d" % results[unit])
+                            if unit in results else "no answer"))
+
+
+def current_time():
+    now = time.time()
+    return TIME_BODY.pack(int(now), int(now % 1 * 1000000))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--key", default=os.environ.get("GRAVE_FLEET_KEY"), help="fleet key")
+    parser.add_argument("--address", default=GROUP, help="send to this address instead of the group")
+    parser.add_argument("--timeout", type=float, default=1.5, help="seconds to wait for replies")
+    commands = parser.add_subparsers(dest="command", required=True)
+    commands.add_parser("discover")
+    commands.add_parser("time")
+    clone = commands.add_parser("clone")
+    clone.add_argument("unit", help="unit ID whose configuration is copied")
+    args = parser.parse_args()
+    if not args.key:
+        parser.error("no fleet key (--key or GRAVE_FLEET_KEY)")
+
+    fleet = Fleet(args.key, args.address, args.timeout)
+    units = fleet.discover()
+    if not units:
+        print("No units answered.")
+        return 1
+
+    if args.command == "discover":
+        print_units(units)
+    elif args.command == "time":
+        # Each retry carries the time it is sent at
+        print_results(sorted(units), fleet.command(TIME, current_time, sorted(units)))
+    elif args.command == "clone":
+        source = int(args.unit, 16)
+        if source not in units:
+            print("Unit %08x did not answer." % source)
+            return 1
+        results = fleet.command(CLONE, bytes([CONFIG_FIELD_ALL]), [source])
+        print_results([source], results)
+        time.sleep(1)
+        print_units(fleet.discover())
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
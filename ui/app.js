@@ -0,0 +1,98 @@
+// GRAVE Controller web interface: live status and form submission.
+// The page itself only changes with the configuration (and is cached by the
+// browser); the current time and output state come from /api/status and are
+// then kept up to date by the /events stream.
+(function () {
+  function $(id) { return document.getElementById(id); }
+  function pad(n) { return (n < 10 ? '0' : '') + n; }
+  function text(id, value) { var el = $(id); if (el) el.textContent = value; }
+
+  var clock = null; // Seconds of the day at `since` (ms, local timer)
+  var stale = $('stale');
+  var configVersion = stale ? Number(stale.dataset.config) : 0;
+
+  function showTime() {
+    if (!clock) return;
+    var s = (clock.seconds + Math.floor((Date.now() - clock.since) / 1000)) % 86400;
+    text('time', pad(Math.floor(s / 3600)) + ':' + pad(Math.floor(s / 60) % 60) + ':' + pad(s % 60));
+  }
+
+  function fill(name, value) {
+    var input = document.querySelector("#settime input[name='" + name + "']");
+    if (input && input.value === '') input.value = value;
+  }
+
+  function setClock(s) {
+    var t = s.time.split(':').map(Number);
+    var d = s.date.split('-').map(Number);
+    clock = { seconds: t[0] * 3600 + t[1] * 60 + t[2], since: Date.now() };
+    showTime();
+    text('date', pad(d[2]) + '/' + pad(d[1]) + '/' + d[0]);
+
+    // Clock form defaults to the controller's current time
+    fill('h', t[0]); fill('m', t[1]); fill('s', t[2]);
+    fill('d', d[2]); fill('mon', d[1]); fill('y', d[0]);
+  }
+
+  function setOutputs(s) {
+    text('output', s.selftest ? 'AUTOTESTE' : s.alarm_active ? 'ON / Play' : 'OFF / Stop');
+    text('volume-now', s.volume);
+    var zones = [];
+    for (var z = 0; z < 8; z++) if (s.zones & (1 << z)) zones.push(z + 1);
+    text('zones', zones.length ? zones.join(', ') : 'nenhuma');
+    text('next', s.next_change
+      ? (s.next_change.active ? 'ligar' : 'desligar') + ' às ' + s.next_change.at
+      : 'nenhuma nas próximas 24h');
+  }
+
+  function setConfigVersion(version) {
+    // Changed by someone else: this page's periods may be out of date.
+    // Checked a little later, as the event for our own change may arrive
+    // before the reply to the form submission.
+    setTimeout(function () {
+      if (stale && version !== configVersion) stale.hidden = false;
+    }, 1000);
+  }
+
+  fetch('/api/status', { cache: 'no-store' })
+    .then(function (r) { return r.json(); })
+    .then(function (s) {
+      setClock(s);
+      setOutputs(s);
+      text('sync', 'Relógio sincronizado com o RTC há ' + s.clock.since_sync_s +
+        ' s (correção: ' + s.clock.correction_ms + ' ms)');
+    })
+    .catch(function () { text('output', 'sem ligação'); });
+
+  setInterval(showTime, 1000);
+
+  if (window.EventSource) {
+    var events = new EventSource('/events');
+    events.addEventListener('time', function (e) { setClock(JSON.parse(e.data)); });
+    events.addEventListener('status', function (e) { setOutputs(JSON.parse(e.data)); });
+    events.addEventListener('config', function (e) { setConfigVersion(JSON.parse(e.data).version); });
+  }
+
+  // Forms are posted with fetch: the controller answers 204 and the page
+  // stays in place. Only period edits reload it, as they change the list.
+  document.addEventListener('submit', function (e) {
+    var form = e.target;
+    if (!window.fetch || !window.URLSearchParams) return;
+    e.preventDefault();
+
+    var body = new URLSearchParams(new FormData(form));
+    if (e.submitter && e.submitter.name) body.append(e.submitter.name, e.submitter.value);
+
+    fetch(form.action, { method: 'POST', body: body, headers: { 'X-Requested-With': 'fetch' } })
+      .then(function (r) {
+        if (!r.ok) return r.text().then(function (t) { alert(t || r.status); });
+        configVersion = Number(r.headers.get('X-Config-Version'));
+        if (/\/set$/.test(form.action)) {
+          location.href = '/';
+        } else if (/\/setvolume$/.test(form.action)) {
+          text('volume-cfg', form.elements.v.value);
+        }
+      })
+      .catch(function () { form.submit(); });
+  });
+})();